@@ -61,6 +61,7 @@ static int read_n_run = 0;	// read and run bytecode
 static int freshen = 0;		// freshen recompilation
 static int force = 0;		// force recompilation
 static int no_implicit_namespaces = 0;	// don't preload implicit namespaces
+static int optimize = 1;	// optimization level for -c, 0 = off
 static const char *ui_name = 0;
 #define UI_QT_NAME "qt"
 #define UI_NCURSES_NAME "ncurses"
@@ -927,6 +928,17 @@ compilefile (const char *infname, const char *outfname)
 
     YCodePtr c = parsefile (infname);
 
+    if (c != NULL && optimize > 0)
+    {
+	int removed = 0;
+	YCodePtr optimized = c->optimize (removed);
+	if (optimized != NULL)
+	{
+	    c = optimized;
+	}
+	progress ("optimized '%s': %d nodes removed\n", infname, removed);
+    }
+
     if (c != NULL )
     {
 	progress ("saving ...\n");
@@ -1120,6 +1132,7 @@ void print_help (const char *name)
     printf (opt_fmt, "-F, --Force", "force recompilation of all dependant files");
     printf (opt_fmt, "-I, --include-path", "where to find include files");
     printf (opt_fmt, "-M, --module-path", "where to find module files");
+    printf (opt_fmt, "-O0, -O1", "disable/enable optimization for -c (default -O1)");
     printf (opt_fmt, "--no-std-includes", "drop all built-in include paths");
     printf (opt_fmt, "--no-std-modules", "drop all built-in module paths");
     printf (opt_fmt, "-n, --no-std-paths", "no standard paths");
@@ -1179,6 +1192,7 @@ int main(int argc, char *argv[])
 	    {"no-std-path", 0, 0, 'n'},			// no standard pathes
 	    {"no-std-paths", 0, 0, 'n'},		// no standard pathes
 	    {"output", 1, 0, 'o'},			// output file
+	    {"optimize", 1, 0, 'O'},			// optimization level
 	    {"print", 0, 0, 'p'},			// read & print bytecode
 	    {"run", 0, 0, 'r'},				// read & run bytecode
 	    {"quiet", 0, 0, 'q'},			// no output
@@ -1190,7 +1204,7 @@ int main(int argc, char *argv[])
 	    {0, 0, 0, 0}
 	};
 
-	int c = getopt_long (argc, argv, "h?vxVnpqrtRdEcFfI:M:o:l:u:", options, &option_index);
+	int c = getopt_long (argc, argv, "h?vxVnpqrtRdEcFfI:M:o:O:l:u:", options, &option_index);
 	if (c == EOF) break;
 
 	switch (c)
@@ -1263,6 +1277,15 @@ int main(int argc, char *argv[])
 		}
 		outname = strdup (optarg);
 		break;
+	    case 'O':
+		if ((optarg[0] != '0' && optarg[0] != '1')
+		    || optarg[1] != 0)
+		{
+		    fprintf (stderr, "Bad optimization level '%s', use -O0 or -O1\n", optarg);
+		    exit (1);
+		}
+		optimize = optarg[0] - '0';
+		break;
 	    case 'd':
 		no_implicit_namespaces = 1;
 		break;
@@ -241,7 +241,7 @@ void Debugger::generateBacktrace ()
     {
         result = result 
     	  + "\n"
-    	  + ( (*it)->filename ) 
+    	  + ( *(*it)->filename ) 
           + ":" 
           + stringutil::numstring((*it)->linenumber) 
           + ": "
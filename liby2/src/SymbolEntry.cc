@@ -19,6 +19,10 @@
 /-*/
 // -*- c++ -*-
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <new>
 
 #include <string>
 using std::string;
@@ -29,6 +33,8 @@ using std::string;
 
 #include "ycp/y2log.h"
 #include "y2/SymbolEntry.h"
+#include "y2/Y2Namespace.h"
+#include "y2/Y2Function.h"
 #include "ycp/SymbolTable.h"
 #include "ycp/YCPVoid.h"
 #include "ycp/YCPCode.h"
@@ -36,8 +42,155 @@ using std::string;
 IMPL_BASE_POINTER(SymbolEntry);
 
 UstringHash* SymbolEntry::_nameHash = NULL;
+__thread SymbolEntry::FrameStack* SymbolEntry::_frames = NULL;
+__thread SymbolEntry::Binding* SymbolEntry::_bindings = NULL;
+__thread SymbolEntry::ValueStore* SymbolEntry::_store = NULL;
+unsigned long SymbolEntry::_serials = 0;
 Ustring SymbolEntry::emptyUstring = Ustring ( *( SymbolEntry::_nameHash ? SymbolEntry::_nameHash : (SymbolEntry::_nameHash = new UstringHash)), ""); 
 
+
+SymbolEntry::ValueStore::~ValueStore ()
+{
+    clear ();
+}
+
+
+void
+SymbolEntry::ValueStore::clear ()
+{
+    for (calls_t::iterator it = calls.begin (); it != calls.end (); ++it)
+    {
+	delete it->second;
+    }
+    calls.clear ();
+    values.clear ();
+}
+
+
+// bytes of memory allocated at once for frames, a chunk is
+//  retained when its frames are popped
+#define FRAME_CHUNK 16384
+
+SymbolEntry::FrameStack::FrameStack ()
+    : m_chunk (0)
+{
+}
+
+
+SymbolEntry::FrameStack::~FrameStack ()
+{
+    for (unsigned int c = 0; c < m_chunks.size (); c++)
+    {
+	free (m_chunks[c].memory);
+    }
+}
+
+
+SymbolEntry::Frame *
+SymbolEntry::FrameStack::push (unsigned int id, unsigned int size)
+{
+    size_t bytes = sizeof (Frame) + size * sizeof (YCPValue);
+
+    if (m_chunks.empty ()
+	|| m_chunks[m_chunk].used + bytes > m_chunks[m_chunk].size)
+    {
+	if (! m_chunks.empty ())
+	{
+	    m_chunk++;
+	}
+	if (m_chunk == m_chunks.size ())
+	{
+	    Chunk chunk = { 0, 0, 0 };
+	    m_chunks.push_back (chunk);
+	}
+
+	// the next chunk is unused, replace it if it is too small
+	Chunk & chunk = m_chunks[m_chunk];
+	if (chunk.size < bytes)
+	{
+	    free (chunk.memory);
+	    chunk.size = bytes > FRAME_CHUNK ? bytes : FRAME_CHUNK;
+	    chunk.memory = (char *) malloc (chunk.size);
+	}
+	chunk.used = 0;
+    }
+
+    Chunk & chunk = m_chunks[m_chunk];
+    Frame *frame = reinterpret_cast<Frame *> (chunk.memory + chunk.used);
+    chunk.used += bytes;
+
+    if (id >= m_active.size ())
+    {
+	m_active.resize (id + 1, 0);
+    }
+    frame->outer = m_active[id];
+    frame->size = size;
+    YCPValue *slots = frame->slots ();
+    for (unsigned int s = 0; s < size; s++)
+    {
+	new (slots + s) YCPValue (YCPNull ());
+    }
+    m_active[id] = frame;
+
+    return frame;
+}
+
+
+void
+SymbolEntry::FrameStack::pop (unsigned int id)
+{
+    Frame *frame = active (id);
+    if (frame == 0)
+    {
+	y2internal ("No frame to pop for %u", id);
+	return;
+    }
+
+    m_active[id] = frame->outer;
+    YCPValue *slots = frame->slots ();
+    for (unsigned int s = frame->size; s > 0; s--)
+    {
+	slots[s-1].~YCPValue ();
+    }
+
+    Chunk & chunk = m_chunks[m_chunk];
+    chunk.used = reinterpret_cast<char *> (frame) - chunk.memory;
+    if (chunk.used == 0 && m_chunk > 0)
+    {
+	m_chunk--;
+    }
+}
+
+
+static pthread_key_t frames_key;
+static pthread_once_t frames_once = PTHREAD_ONCE_INIT;
+
+static void
+deleteFrames (void *frames)
+{
+    delete (SymbolEntry::FrameStack *) frames;
+}
+
+static void
+initFramesKey ()
+{
+    pthread_key_create (&frames_key, deleteFrames);
+}
+
+
+SymbolEntry::FrameStack *
+SymbolEntry::threadFrames ()
+{
+    pthread_once (&frames_once, initFramesKey);
+    FrameStack *frames = (FrameStack *) pthread_getspecific (frames_key);
+    if (frames == 0)
+    {
+	frames = new FrameStack;
+	pthread_setspecific (frames_key, frames);
+    }
+    return frames;
+}
+
 #ifdef D_MEMUSAGE
 void __UUsage ()
 {
@@ -57,7 +210,8 @@ SymbolEntry::SymbolEntry (const Y2Namespace* name_space, unsigned int position,
     , m_category ((cat == c_filename) ? cat : (m_global ? c_unspec : cat))
     , m_type (type)
     , m_value (YCPNull())
-    , m_recurse_stack (NULL)
+    , m_serial (__sync_add_and_fetch (&_serials, 1))
+    , m_slot (~0U)
 {
 }
 
@@ -101,26 +255,46 @@ SymbolEntry::setPosition (unsigned int position)
 }
 
 
+YCPValue *
+SymbolEntry::frameSlot () const
+{
+    if (_frames == 0 || m_namespace == 0)
+	return 0;
+
+    Frame *frame = _frames->active (m_namespace->frameId ());
+    if (frame == 0 || m_slot >= frame->size)
+	return 0;
+
+    return frame->slots () + m_slot;
+}
+
+
 YCPValue
 SymbolEntry::setValue (YCPValue value)
 {
+#if DO_DEBUG
     y2debug ("SymbolEntry::setValue (%s@%p = '%s')", m_name.asString().c_str(), this, value.isNull() ? "nil" : value->toString().c_str());
+#endif
+
+    YCPValue *slot = frameSlot ();
+    YCPValue & current = slot ? *slot : (_store ? _store->values[m_serial] : m_value);
+
     if (!value.isNull()
 	&& (m_category == c_reference))
     {
 	y2debug ("C_REFERENCE");
 	if (value->isReference())
 	{
-	    return m_value = value;
+	    return current = value;
 	}
 
-	if (m_value.isNull()
-	    || !m_value->isReference())
+	if (current.isNull()
+	    || !current->isReference())
 	{
 	    y2error ("Setting uninitialized reference");
 	    return YCPNull ();
 	}
-	return m_value->asReference()->entry()->setValue (value);
+	return current->asReference()->entry()->setValue (value);
     }
     
     // use YCPVoid for nil to avoid problems with function references
@@ -129,41 +303,55 @@ SymbolEntry::setValue (YCPValue value)
 	value = YCPVoid ();
     }
 	
-    return m_value = value;
+    return current = value;
 }
 
 
 YCPValue
 SymbolEntry::value () const
 {
-    if ((m_category == c_reference)
-	&& !m_value.isNull()
-	&& m_value->isReference())
+    if (_bindings)
     {
-	y2debug ("DE-REFERENCE");
-	return m_value->asReference()->entry()->value();
+	for (const Binding *b = _bindings; b->entry; b++)
+	{
+	    if (b->entry == this)
+		return b->value;
+	}
     }
-    return m_value;
-}
 
-void
-SymbolEntry::push ()
-{
-    if (! m_recurse_stack)
+    const YCPValue *current = frameSlot ();
+    if (current == 0 && _store)
     {
-	m_recurse_stack = new valuestack_t;
+	ValueStore::values_t::const_iterator it = _store->values.find (m_serial);
+	if (it == _store->values.end ())
+	{
+	    // not set in this interpreter context
+	    return YCPNull ();
+	}
+	current = &it->second;
+    }
+    else if (current == 0)
+    {
+	current = &m_value;
+    }
+
+    if ((m_category == c_reference)
+	&& !current->isNull()
+	&& (*current)->isReference())
+    {
+	y2debug ("DE-REFERENCE");
+	return (*current)->asReference()->entry()->value();
     }
-    m_recurse_stack->push (m_value);
+    return *current;
 }
 
 void
-SymbolEntry::pop ()
+SymbolEntry::setOuterValue (const YCPValue & value)
 {
-    if (! m_recurse_stack)
-	return;
-
-    m_value = m_recurse_stack->top ();
-    m_recurse_stack->pop ();
+    if (_store)
+	_store->values[m_serial] = value;
+    else
+	m_value = value;
 }
 
 const char *
@@ -22,6 +22,8 @@
  */
 
 
+#include <pthread.h>
+
 #include <y2util/y2log.h>
 #include <ycp/SymbolTable.h>
 
@@ -34,10 +36,46 @@
 #include "Y2Function.h"
 #include "SymbolEntry.h"
 
+// guards the lazy computation of the frame slots, the code of a
+// namespace may be evaluated by several threads
+static pthread_mutex_t frameslots_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// last frame id given to a namespace
+static unsigned int frame_ids = 0;
+
+static pthread_mutex_t load_mutex;
+static pthread_once_t load_once = PTHREAD_ONCE_INIT;
+
+static void
+initLoadMutex ()
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init (&attr);
+    pthread_mutexattr_settype (&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init (&load_mutex, &attr);
+    pthread_mutexattr_destroy (&attr);
+}
+
+
+Y2Namespace::LoadLock::LoadLock ()
+{
+    pthread_once (&load_once, initLoadMutex);
+    pthread_mutex_lock (&load_mutex);
+}
+
+
+Y2Namespace::LoadLock::~LoadLock ()
+{
+    pthread_mutex_unlock (&load_mutex);
+}
+
+
 Y2Namespace::Y2Namespace ()
     : m_table (0)
     , m_symbolcount (0)
     , m_initialized (false)
+    , m_frameslots_valid (false)
+    , m_frameid (0)
 {}
 
 
@@ -137,6 +175,11 @@ Y2Namespace::addSymbol (SymbolEntryPtr sentry)
     y2debug ("addSymbol #%d:'%s'", m_symbolcount, sentry->toString().c_str());
 #endif
     m_symbols.push_back(sentry);
+    m_frameslots_valid = false;
+    if (sentry->nameSpace () == this)
+    {
+	sentry->setSlot (m_symbolcount);
+    }
     return m_symbolcount++;
 }
 
@@ -184,6 +227,7 @@ Y2Namespace::releaseSymbol (unsigned int position)
     {
 	m_symbols[position]->setNamespace (0);
 	m_symbols[position] = 0;
+	m_frameslots_valid = false;
     }
 }
 
@@ -252,28 +296,78 @@ Y2Namespace::finish ()
 
 
 void
-Y2Namespace::pushToStack ()
+Y2Namespace::computeFrameSlots ()
 {
-    for (unsigned int p = 0; p < m_symbolcount; p++)
+    pthread_mutex_lock (&frameslots_mutex);
+    if (! m_frameslots_valid)
     {
-	if ( m_symbols[p] && m_symbols[p]->isVariable() )
-        {
-            m_symbols[p]->push ();
-        }
+	m_frameslots.clear ();
+	for (unsigned int p = 0; p < m_symbolcount; p++)
+	{
+	    if ( m_symbols[p]
+		 && (m_symbols[p]->isVariable() || m_symbols[p]->isReference()) )
+	    {
+		m_frameslots.push_back (p);
+	    }
+	}
+	// publish the slots before the flag
+	__sync_synchronize ();
+	m_frameslots_valid = true;
     }
+    pthread_mutex_unlock (&frameslots_mutex);
 }
 
 
 void
-Y2Namespace::popFromStack ()
+Y2Namespace::pushFrame ()
 {
-    for (unsigned int p = 0; p < m_symbolcount; p++)
+    if (! m_frameslots_valid)
     {
-	if ( m_symbols[p] && m_symbols[p]->isVariable() )
-        {
-            m_symbols[p]->pop ();
-        }
+	computeFrameSlots ();
+    }
+
+    if (m_frameslots.empty ())
+    {
+	return;
+    }
+
+    if (m_frameid == 0)
+    {
+	// another thread may win, its id is as good
+	__sync_bool_compare_and_swap (&m_frameid, 0, __sync_add_and_fetch (&frame_ids, 1));
+    }
+
+    if (SymbolEntry::_frames == 0)
+    {
+	SymbolEntry::_frames = SymbolEntry::threadFrames ();
     }
+    SymbolEntry::_frames->push (m_frameid, m_symbolcount);
+}
+
+
+void
+Y2Namespace::popFrame (bool keep)
+{
+    if (m_frameslots.empty ())
+    {
+	return;
+    }
+
+    SymbolEntry::FrameStack *frames = SymbolEntry::_frames;
+    SymbolEntry::Frame *frame = frames->active (m_frameid);
+    if (keep && frame != 0 && frame->outer == 0)
+    {
+	YCPValue *slots = frame->slots ();
+	vector<unsigned int>::const_iterator it;
+	for (it = m_frameslots.begin (); it != m_frameslots.end (); ++it)
+	{
+	    if (! slots[*it].isNull ())
+	    {
+		m_symbols[*it]->setOuterValue (slots[*it]);
+	    }
+	}
+    }
+    frames->pop (m_frameid);
 }
 
 
@@ -295,21 +389,38 @@ Y2Namespace::createTable ()
 void
 Y2Namespace::initialize ()
 {
-    if (m_initialized)
+    SymbolEntry::ValueStore *store = SymbolEntry::_store;
+    if (store)
     {
-	// we are already initialized
-	return;
+	// the module state of an interpreter context is in its store,
+	//  so the constructor runs once per context
+	if (! store->initialized.insert (this).second)
+	{
+	    return;
+	}
+    }
+    else
+    {
+	if (m_initialized)
+	{
+	    // we are already initialized
+	    return;
+	}
+
+	// avoid recursion
+	m_initialized = true;
     }
-    
-    // avoid recursion
-    m_initialized = true;
 
     evaluate ();
     
     if (table ())
     { 
 	SymbolTable* t = table ();
-	t->disableUsage ();
+	// contexts don't track usage at all, and the table is shared
+	if (! store)
+	{
+	    t->disableUsage ();
+	}
 	if (t->find (name ().c_str ()))
 	{
 	    Y2Function* c = createFunctionCall (name (), 0);
@@ -319,7 +430,10 @@ Y2Namespace::initialize ()
 	    }
 	    delete c;
 	}
-	t->enableUsage ();
+	if (! store)
+	{
+	    t->enableUsage ();
+	}
     }
 }
 
@@ -29,9 +29,18 @@
 #include "ycp/YCPValue.h"
 #include "ycp/Type.h"
 
-#include <stack>
+#include <vector>
+#include <set>
+#include <map>
+
+#ifdef HAVE_CXX0X
+#include <unordered_map>
+#else
+#include <ext/hash_map>
+#endif
 
 class Y2Namespace;
+class Y2Function;
 
 DEFINE_BASE_POINTER (SymbolEntry);
 
@@ -100,9 +109,139 @@ protected:
 
     /*	the current (actual) value of the entry c_const  */
     YCPValue m_value;
-    
-    typedef std::stack<YCPValue> valuestack_t;
-    valuestack_t* m_recurse_stack;
+
+    /*
+     * unique and never reused number of the entry, the key of its
+     * value in a ValueStore
+     */
+    unsigned long m_serial;
+    static unsigned long _serials;
+
+    /*
+     * position in m_namespace, the slot of the entry in frames
+     */
+    unsigned int m_slot;
+
+    // the slot of a variable in the innermost active frame of its
+    //  namespace, 0 if there is none
+    YCPValue *frameSlot () const;
+
+public:
+    /*
+     * activation frame of a block or of the parameters of a function
+     * call, see Y2Namespace::pushFrame ()
+     *
+     * It has one slot per symbol of the namespace, the slot of an
+     * entry is its position there (m_slot), fixed when the code is
+     * parsed or read from bytecode. While a frame of its namespace is
+     * active, value () and setValue () of a variable use its slot in
+     * the innermost one instead of m_value.
+     */
+    struct Frame
+    {
+	Frame *outer;		// the frame of the namespace active before, 0 if none
+	unsigned int size;	// number of slots
+
+	YCPValue *slots () { return reinterpret_cast<YCPValue *> (this + 1); }
+    };
+
+    /*
+     * the frames of one thread (or one interpreter context), a stack
+     * in chunks of contiguous memory
+     */
+    class FrameStack
+    {
+    public:
+	FrameStack ();
+	~FrameStack ();
+
+	// push a frame of size slots, all nil, for the namespace with
+	//  the frame id (see Y2Namespace::frameId ())
+	Frame *push (unsigned int id, unsigned int size);
+	// pop the innermost frame of the namespace, it must be the
+	//  last one pushed
+	void pop (unsigned int id);
+
+	// the innermost active frame of the namespace, 0 if none
+	Frame *active (unsigned int id) const
+	{
+	    return id < m_active.size () ? m_active[id] : 0;
+	}
+
+    private:
+	struct Chunk
+	{
+	    char *memory;
+	    size_t size;
+	    size_t used;
+	};
+	std::vector<Chunk> m_chunks;
+	unsigned int m_chunk;		// the chunk of the top frame
+	std::vector<Frame *> m_active;	// by frame id
+
+	FrameStack (const FrameStack &);
+	FrameStack & operator= (const FrameStack &);
+    };
+
+    /*
+     * the frames in use by the current thread, those of the active
+     * interpreter context or of the thread itself (threadFrames ())
+     */
+    static __thread FrameStack* _frames;
+    static FrameStack *threadFrames ();
+
+    /*
+     * values of entries private to the current thread, used by the
+     * worker threads of parallel builtins (see YCPParallel) for their
+     * loop variables; value () of a bound entry returns the bound
+     * value instead of m_value
+     *
+     * An array terminated by an entry 0, or 0 if nothing is bound.
+     */
+    struct Binding
+    {
+	const SymbolEntry *entry;
+	YCPValue value;
+    };
+    static __thread Binding* _bindings;
+
+    /*
+     * values of all entries for one interpreter context (see
+     * YCPInterpreterContext in libycp), so several threads can run
+     * the same code, each in its own context
+     *
+     * While _store is set in a thread, value () and setValue () use
+     * the values of the store instead of m_value for entries without
+     * an active frame. An entry without a value in the store is
+     * uninitialized, as is a fresh entry. The values are kept by
+     * m_serial, an entry destroyed meanwhile leaves its value behind
+     * until the store is destroyed. The frames of the context are in
+     * the store too.
+     */
+    struct ValueStore
+    {
+#ifdef HAVE_CXX0X
+	typedef std::unordered_map<unsigned long, YCPValue> values_t;
+#else
+	typedef __gnu_cxx::hash_map<unsigned long, YCPValue> values_t;
+#endif
+	values_t values;
+	FrameStack frames;
+
+	// namespaces initialized in this store, see Y2Namespace::initialize ()
+	std::set<const Y2Namespace *> initialized;
+
+	// function calls made in this store, one per function (by
+	//  m_serial) and reused like YEFunction reuses its own call
+	typedef std::map<unsigned long, Y2Function *> calls_t;
+	calls_t calls;
+
+	~ValueStore ();
+
+	// release all values and calls
+	void clear ();
+    };
+    static __thread ValueStore* _store;
 
 public:
     // create symbol beloging to namespace (at position)
@@ -124,6 +263,9 @@ public:
     unsigned int position () const;
     void setPosition (unsigned int position);
 
+    // unique and never reused number of the entry
+    unsigned long serial () const { return m_serial; }
+
     bool isGlobal () const;
     void setGlobal (bool global);
 
@@ -147,9 +289,23 @@ public:
     void setType (constTypePtr type);
     YCPValue setValue (YCPValue value);
     YCPValue value () const;
-    
-    void push ();
-    void pop ();
+
+    // the slot of the variable for direct access (see Frame), 0 if
+    //  value () and setValue () must be used: the entry is no
+    //  variable, its namespace has no active frame or it is bound
+    //  (see _bindings)
+    YCPValue *slot () const
+    {
+	return (_bindings == 0 && m_category == c_variable) ? frameSlot () : 0;
+    }
+
+    // the frame slot of the entry, see Y2Namespace::addSymbol ()
+    void setSlot (unsigned int slot) { m_slot = slot; }
+
+    // set the value used while no frame is active, the outermost
+    //  frame of a block leaves its values there (see
+    //  Y2Namespace::popFrame ())
+    void setOuterValue (const YCPValue & value);
 
     virtual string toString (bool with_type = true) const;
 };
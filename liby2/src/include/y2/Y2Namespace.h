@@ -76,6 +76,18 @@ protected:
     
     bool m_initialized;
 
+    // positions of the variables and references in m_symbols, i.e.
+    //  the slots of a frame which hold values, computed on first use
+    vector<unsigned int> m_frameslots;
+    bool m_frameslots_valid;
+
+    // identifies the frames of this namespace in a
+    //  SymbolEntry::FrameStack, 0 until the first pushFrame ()
+    unsigned int m_frameid;
+
+    // recompute m_frameslots
+    void computeFrameSlots ();
+
 public:
     
     Y2Namespace ();
@@ -127,15 +139,40 @@ public:
      */
     virtual Y2Function* createFunctionCall (const string name, constFunctionTypePtr type) = 0;
 
-    // push all local variables to stack, uses SymbolEntry::push()
-    void pushToStack ();
+    // push a frame with a slot for each symbol on the frame stack of
+    //  the thread (SymbolEntry::_frames), the local variables use it
+    //  until popFrame (); nothing is pushed if there are no variables
+    void pushFrame ();
 
-    // pop all local variables from stack, uses SymbolEntry::pop()
-    void popFromStack ();
+    // pop the frame pushed last by pushFrame (); if keep is set and
+    //  no other frame of this namespace is active, the values of the
+    //  variables are kept in the entries (see SymbolEntry::setOuterValue ())
+    void popFrame (bool keep);
+
+    // see m_frameid
+    unsigned int frameId () const { return m_frameid; }
     
     // ensure that the namespace is initialized
+    //  (once per interpreter context, see SymbolEntry::ValueStore)
     virtual void initialize ();
 
+    /**
+     * Serializes loading code (parsing, reading bytecode, importing
+     * modules) while it is held. Loading uses process wide state,
+     * e.g. the namespace stack of Bytecode or the module list of
+     * Import, which the threads of several interpreter contexts
+     * would otherwise change at the same time. It is recursive, an
+     * import while parsing takes it again.
+     */
+    class LoadLock
+    {
+    public:
+	LoadLock ();
+	~LoadLock ();
+    private:
+	LoadLock (const LoadLock &);
+	LoadLock & operator= (const LoadLock &);
+    };
 };
 
 
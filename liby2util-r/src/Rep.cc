@@ -31,6 +31,8 @@ using namespace std;
 //
 ///////////////////////////////////////////////////////////////////
 
+int Rep::_atomic = 0;
+
 ostream & Rep::dumpOn( ostream & str ) const {
   return str << repName() << "(<-" << refCount() << ')';
 }
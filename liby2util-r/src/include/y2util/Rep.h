@@ -85,11 +85,24 @@ class Rep {
 
   public:
 
+    /**
+     * Nonzero while objects may be shared by several threads (e.g.
+     * the code trees of parallel evaluation or of interpreter contexts
+     * in libycp), the counters are then changed atomically. Change it
+     * atomically itself, and from zero only while no other thread uses
+     * Rep objects, i.e. before starting the threads and after joining
+     * them.
+     **/
+    static int _atomic;
+
     /**
      * Increment reference counter.
      **/
     void ref() const {
-      ref_to( ++_counter ); // trigger derived classes
+      if ( _atomic )
+	ref_to( __sync_add_and_fetch( &_counter, 1 ) );
+      else
+	ref_to( ++_counter ); // trigger derived classes
     }
     /**
      * Decrement reference counter and delete the object if reference
@@ -99,8 +112,9 @@ class Rep {
     void unref() const {
       if ( ! _counter )
 	throw( this );
-      if ( --_counter )
-	unref_to( _counter ); // trigger derived classes
+      unsigned counter = _atomic ? __sync_sub_and_fetch( &_counter, 1 ) : --_counter;
+      if ( counter )
+	unref_to( counter ); // trigger derived classes
       else
 	delete this;
     }
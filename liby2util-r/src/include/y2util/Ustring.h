@@ -24,6 +24,7 @@
 // MemUsage.h defines/undefines D_MEMUSAGE
 #include "y2util/MemUsage.h"
 #include <set>
+#include <pthread.h>
 
 ///////////////////////////////////////////////////////////////////
 //
@@ -47,11 +48,26 @@ class UstringHash
 
     UstringHash_type _UstringHash;
 
+    // add() may be called by several threads (e.g. libycp parsing
+    // while other threads evaluate)
+    pthread_mutex_t _mutex;
+
+  private:
+
+    UstringHash( const UstringHash & );
+    UstringHash & operator=( const UstringHash & );
+
   public:
 
+    UstringHash() { pthread_mutex_init( &_mutex, 0 ); }
+    ~UstringHash() { pthread_mutex_destroy( &_mutex ); }
+
     const std::string & add( const std::string & nstr_r )
     {
-	return *(_UstringHash.insert( nstr_r ).first);
+	pthread_mutex_lock( &_mutex );
+	const std::string & ret( *(_UstringHash.insert( nstr_r ).first) );
+	pthread_mutex_unlock( &_mutex );
+	return ret;
     }
 
     /**
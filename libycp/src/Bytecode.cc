@@ -25,10 +25,15 @@
 // provide a backward compatibility
 #define YaST_BYTECODE_HEADER "YaST bytecode "
 #define YaST_BYTECODE_MAJOR "1"
-#define YaST_BYTECODE_MINOR "4"
+#define YaST_BYTECODE_MINOR "5"
 #define YaST_BYTECODE_RELEASE "0"
 
+// files below this size are read, not mapped: for them setting up and
+//  tearing down the mapping costs more than copying the data
+#define MAP_MIN_SIZE (64*1024)
+
 #include "ycp/Bytecode.h"
+#include "ycp/ModulePrefetch.h"
 #include "YCP.h"
 #include "ycp/YCode.h"
 #include "ycp/YExpression.h"
@@ -40,10 +45,17 @@
 #include "ycp/y2log.h"
 #include "ycp/pathsearch.h"
 
+#include <algorithm>
 #include <fstream>
+#include <sstream>
 #include <errno.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 static int
 readInt (bytecodeistream & str)
@@ -54,8 +66,7 @@ readInt (bytecodeistream & str)
 
     for (;;)
     {
-	str.get (c);
-	if (!isdigit (c))
+	if (!str.get (c) || !isdigit (c))
 	    break;
 	i *= 10;
 	i += (c - '0');
@@ -66,16 +77,76 @@ readInt (bytecodeistream & str)
 
 
 bytecodeistream::bytecodeistream (string filename)
-    : std::ifstream (filename.c_str ())
-    , m_major (-1)
+    : m_major (-1)
     , m_minor (-1)
     , m_release (-1)
+    , m_filename (filename)
+    , m_users (1)
+    , m_data (0)
+    , m_size (0)
+    , m_mapped (false)
+    , m_pos (0)
+    , m_end (0)
+    , m_open (false)
+    , m_good (false)
 {
-    if (!is_open ())
+    int fd = open (filename.c_str (), O_RDONLY);
+    if (fd < 0)
     {
 	y2error ("Failed to open '%s': %s", filename.c_str(), strerror (errno));
 	return;
     }
+
+    struct stat st;
+    bool regular = fstat (fd, &st) == 0 && S_ISREG (st.st_mode);
+    if (regular
+	&& st.st_size >= MAP_MIN_SIZE)
+    {
+	void *data = mmap (0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data != MAP_FAILED)
+	{
+	    // the whole file is decoded right away
+	    madvise (data, st.st_size, MADV_WILLNEED);
+	    m_data = (const char *) data;
+	    m_size = st.st_size;
+	    m_mapped = true;
+	}
+    }
+
+    if (!m_mapped)
+    {
+	// a small or not a regular file, read it all
+	if (regular)
+	{
+	    m_buffer.reserve (st.st_size);
+	}
+	char buf[8192];
+	ssize_t len;
+	while ((len = ::read (fd, buf, sizeof (buf))) > 0)
+	{
+	    m_buffer.insert (m_buffer.end (), buf, buf + len);
+	}
+	if (len < 0)
+	{
+	    y2error ("Failed to read '%s': %s", filename.c_str(), strerror (errno));
+	    close (fd);
+	    return;
+	}
+	m_data = m_buffer.empty () ? 0 : &m_buffer[0];
+	m_size = m_buffer.size ();
+    }
+    close (fd);
+
+    init ();
+}
+
+// read the header (and the section index) of m_data
+void
+bytecodeistream::init ()
+{
+    m_end = m_size;
+    m_open = true;
+    m_good = true;
     // read YaST_BYTECODE_HEADER
 
     char header[sizeof(YaST_BYTECODE_HEADER)+1];
@@ -84,15 +155,234 @@ bytecodeistream::bytecodeistream (string filename)
     header[headerlen] = 0;
     if (strcmp (header, YaST_BYTECODE_HEADER) != 0)
     {
-	y2error ("Not a bytecode file '%s'[%s]", filename.c_str(), header);
+	y2error ("Not a bytecode file '%s'[%s]", m_filename.c_str(), header);
 	return;
     }
 
     m_major = readInt (*this);
     m_minor = readInt (*this);
     m_release = readInt (*this);
+
+    // files after 1.4.0 are in sections
+    if (!isVersionAtMost (1,4,0)
+	&& !readIndex ())
+    {
+	y2error ("Bad section index in '%s'", m_filename.c_str());
+	m_good = false;
+    }
+}
+
+bytecodeistream::~bytecodeistream ()
+{
+    if (m_mapped)
+    {
+	munmap ((void *) m_data, m_size);
+    }
 }
 
+
+// read the section index and the string table
+bool
+bytecodeistream::readIndex ()
+{
+    u_int32_t count = Bytecode::readInt32 (*this);
+    if (count == 0 || count > m_size)
+    {
+	return false;
+    }
+
+    m_sections.resize (count);
+    for (u_int32_t i = 0; i < count; i++)
+    {
+	sectionentry_t & section = m_sections[i];
+	section.kind = Bytecode::readInt32 (*this);
+	section.offset = Bytecode::readInt32 (*this);
+	section.length = Bytecode::readInt32 (*this);
+    }
+
+    // the offsets are counted from here
+    for (u_int32_t i = 0; i < count; i++)
+    {
+	sectionentry_t & section = m_sections[i];
+	if (!m_good
+	    || section.offset > m_size - m_pos
+	    || section.length > m_size - m_pos - section.offset)
+	{
+	    m_sections.clear ();
+	    return false;
+	}
+	section.offset += m_pos;
+    }
+
+    u_int32_t table = findSection (Bytecode::sStrings);
+    if (table == 0)
+    {
+	return false;
+    }
+
+    Section strings (*this, table);
+    count = Bytecode::readInt32 (*this);
+    if (count > m_size)
+    {
+	return false;
+    }
+    m_strings.reserve (count);
+    for (u_int32_t i = 0; i < count && m_good; i++)
+    {
+	u_int32_t len = Bytecode::readInt32 (*this);
+	const char *data = take (len);
+	m_strings.push_back (std::make_pair (data, len));
+    }
+
+    return m_good;
+}
+
+
+bytecodeistream &
+bytecodeistream::get (char & c)
+{
+    if (!m_good)
+    {
+	return *this;
+    }
+
+    if (m_pos < m_end)
+    {
+	c = m_data[m_pos++];
+    }
+    else
+    {
+	m_good = false;
+    }
+    return *this;
+}
+
+
+bytecodeistream &
+bytecodeistream::read (char * buf, size_t len)
+{
+    const char *data = take (len);
+    if (data)
+    {
+	memcpy (buf, data, len);
+    }
+    return *this;
+}
+
+
+const char *
+bytecodeistream::take (size_t len)
+{
+    if (!m_good)
+    {
+	return 0;
+    }
+
+    if (len > m_end - m_pos)
+    {
+	// truncated or a bogus length
+	m_pos = m_end;
+	m_good = false;
+	return 0;
+    }
+    const char *data = m_data + m_pos;
+    m_pos += len;
+    return data;
+}
+
+
+u_int32_t
+bytecodeistream::findSection (int kind) const
+{
+    for (size_t i = 0; i < m_sections.size (); i++)
+    {
+	if (m_sections[i].kind == (u_int32_t) kind)
+	{
+	    return i + 1;
+	}
+    }
+    return 0;
+}
+
+
+bool
+bytecodeistream::stringAt (u_int32_t index, const char * & data, u_int32_t & len)
+{
+    if (!m_good)
+    {
+	return false;
+    }
+    if (index >= m_strings.size ()
+	|| m_strings[index].first == 0)
+    {
+	y2error ("No string %u", index);
+	m_good = false;
+	return false;
+    }
+    data = m_strings[index].first;
+    len = m_strings[index].second;
+    return true;
+}
+
+
+Ustring
+bytecodeistream::ustringAt (u_int32_t index)
+{
+    std::map<u_int32_t, Ustring>::iterator it = m_ustrings.find (index);
+    if (it != m_ustrings.end ())
+    {
+	return it->second;
+    }
+
+    const char *data;
+    u_int32_t len;
+    if (!stringAt (index, data, len))
+    {
+	return Ustring (*SymbolEntry::_nameHash, "");
+    }
+
+    Ustring ustring (*SymbolEntry::_nameHash, string (data, strnlen (data, len)));
+    m_ustrings.insert (std::make_pair (index, ustring));
+    return ustring;
+}
+
+
+bytecodeistream::Section::Section (bytecodeistream & stream, u_int32_t section)
+    : m_stream (stream)
+    , m_pos (stream.m_pos)
+    , m_end (stream.m_end)
+    , m_moved (false)
+{
+    if (section == 0)
+    {
+	return;
+    }
+
+    if (section > stream.m_sections.size ())
+    {
+	y2error ("No section %u", section);
+	stream.m_good = false;
+	return;
+    }
+
+    const sectionentry_t & entry = stream.m_sections[section - 1];
+    stream.m_pos = entry.offset;
+    stream.m_end = entry.offset + entry.length;
+    m_moved = true;
+}
+
+
+bytecodeistream::Section::~Section ()
+{
+    // section 0 was read in place, the stream continues after it
+    if (m_moved)
+    {
+	m_stream.m_pos = m_pos;
+	m_stream.m_end = m_end;
+    }
+}
+
+
 bool bytecodeistream::isVersion (int major, int minor, int release)
 {
     return (major == m_major) 
@@ -123,6 +413,32 @@ bool bytecodeistream::isVersionAtMost (int major, int minor, int release)
     return true;
 }
 
+// a file being written in sections
+struct Bytecode::filewriter_t
+{
+    // the string table
+    std::map<string, u_int32_t> index;
+    std::vector<const string *> strings;
+
+    std::vector<std::pair<section_t, string> > sections;
+
+    // the modules imported, in order
+    std::vector<string> imports;
+
+    u_int32_t stringIndex (const string & s)
+    {
+	std::map<string, u_int32_t>::iterator it = index.find (s);
+	if (it == index.end ())
+	{
+	    it = index.insert (std::make_pair (s, (u_int32_t) strings.size ())).first;
+	    strings.push_back (&it->first);
+	}
+	return it->second;
+    }
+};
+
+Bytecode::filewriter_t *Bytecode::m_writer = 0;
+
 int Bytecode::m_namespace_nesting_level = -1;
 int Bytecode::m_namespace_nesting_array_size = 0;
 int Bytecode::m_namespace_tare_level = 0;
@@ -158,7 +474,7 @@ Bytecode::writeBool (std::ostream & str, const bool value)
 bool
 Bytecode::readBool (bytecodeistream & str)
 {
-    char c;
+    char c = 0;
     str.get (c);
 #if DO_DEBUG
 //    y2debug ("Bytecode::readBool 0x%02x", (unsigned int)c);
@@ -175,40 +491,48 @@ Bytecode::readBool (bytecodeistream & str)
 // ------------------------------------------------------------------
 // u_int32_t I/O
 
+// The count of bytes to follow, then the bytes of the value, LSB
+// first. Files up to 1.4.0 always have 4 bytes, later files only as
+// many as the value needs (none for 0).
 std::ostream &
 Bytecode::writeInt32 (std::ostream & str, const u_int32_t value)
 {
-    str.put ((char)4);
-    str.put ((char)(value & 0xff));
-    str.put ((char)(value>>8 & 0xff));
-    str.put ((char)(value>>16 & 0xff));
-    return str.put ((char)(value>>24 & 0xff));
+    char len = 0;
+    for (u_int32_t v = value; v != 0; v >>= 8)
+    {
+	len++;
+    }
+
+    str.put (len);
+    for (int i = 0; i < len; i++)
+    {
+	str.put ((char)(value>>(8 * i) & 0xff));
+    }
+    return str;
 }
 
 
 u_int32_t
 Bytecode::readInt32 (bytecodeistream & str)
 {
-//    char c;
-//    str.get (c);
-//    if (c != 4)
-//    {
-//	return false;
-//    }
-
-    char v[5];
+    const char *len = str.take (1);
+    if (len == 0 || (unsigned char)*len > 4)
+    {
+	return false;
+    }
 
-    str.read (v, 5);
-    if (v[0] != 4)
+    const char *v = str.take (*len);
+    if (v == 0)
     {
 	return false;
     }
 
-    u_int32_t cv, value = 0;
-    cv = (unsigned char)v[1]; value = cv;
-    cv = (unsigned char)v[2]; cv <<= 8; value |= cv;
-    cv = (unsigned char)v[3]; cv <<= 16; value |= cv;
-    cv = (unsigned char)v[4]; cv <<= 24; value |= cv;
+    u_int32_t value = 0;
+    for (int i = *len - 1; i >= 0; i--)
+    {
+	value <<= 8;
+	value |= (unsigned char)v[i];
+    }
     return value;
 }
 
@@ -219,6 +543,11 @@ Bytecode::readInt32 (bytecodeistream & str)
 std::ostream &
 Bytecode::writeString (std::ostream & streamref, const string & stringref)
 {
+    if (m_writer)
+    {
+	return writeInt32 (streamref, m_writer->stringIndex (stringref));
+    }
+
     u_int32_t len = stringref.size();
 
     writeInt32 (streamref, len);
@@ -231,17 +560,30 @@ Bytecode::readString (bytecodeistream & streamref, string & stringref)
 {
     bool ret = false;
     stringref.erase();
+
+    if (streamref.hasSections ())
+    {
+	const char *data;
+	u_int32_t len;
+	if (streamref.stringAt (readInt32 (streamref), data, len)
+	    && len > 0)
+	{
+	    stringref.assign (data, strnlen (data, len));
+	    ret = true;
+	}
+	return ret;
+    }
+
     u_int32_t len = readInt32 (streamref);
     if (len > 0)
     {
-	char *buf = new char [len+1];
-	if (streamref.read (buf, len))
+	const char *buf = streamref.take (len);
+	if (buf)
 	{
-	    buf[len] = 0;
-	    stringref = string (buf);
+	    // up to a NUL, as when it was read as a C string
+	    stringref.assign (buf, strnlen (buf, len));
 	    ret = true;
 	}
-	delete [] buf;
     }
     return ret;
 }
@@ -253,6 +595,11 @@ Bytecode::readString (bytecodeistream & streamref, string & stringref)
 std::ostream &
 Bytecode::writeUstring (std::ostream & streamref, const Ustring ustringref)
 {
+    if (m_writer)
+    {
+	return writeString (streamref, ustringref.asString ());
+    }
+
     u_int32_t len = ustringref->size();
 
     writeInt32 (streamref, len);
@@ -263,17 +610,20 @@ Bytecode::writeUstring (std::ostream & streamref, const Ustring ustringref)
 Ustring
 Bytecode::readUstring (bytecodeistream & streamref)
 {
+    if (streamref.hasSections ())
+    {
+	return streamref.ustringAt (readInt32 (streamref));
+    }
+
     u_int32_t len = readInt32 (streamref);
     Ustring ret = Ustring (*SymbolEntry::_nameHash, "");
     if (len > 0)
     {
-	char *buf = new char [len+1];
-	if (streamref.read (buf, len))
+	const char *buf = streamref.take (len);
+	if (buf)
 	{
-	    buf[len] = 0;
-	    ret = Ustring (*SymbolEntry::_nameHash, buf);
+	    ret = Ustring (*SymbolEntry::_nameHash, string (buf, strnlen (buf, len)));
 	}
-	delete [] buf;
     }
     return ret;
 }
@@ -284,6 +634,11 @@ Bytecode::readUstring (bytecodeistream & streamref)
 std::ostream &
 Bytecode::writeCharp (std::ostream & str, const char * charp)
 {
+    if (m_writer)
+    {
+	return writeString (str, charp);
+    }
+
     u_int32_t len = strlen (charp);
     writeInt32 (str, len);
     return str.write (charp, len);
@@ -293,16 +648,31 @@ Bytecode::writeCharp (std::ostream & str, const char * charp)
 char *
 Bytecode::readCharp (bytecodeistream & str)
 {
+    if (str.hasSections ())
+    {
+	const char *data;
+	u_int32_t len;
+	if (str.stringAt (readInt32 (str), data, len))
+	{
+	    char *buf = new char [len+1];
+	    memcpy (buf, data, len);
+	    buf[len] = 0;
+	    return buf;
+	}
+	return 0;
+    }
+
     u_int32_t len = readInt32 (str);
     if (str.good())
     {
-	char *buf = new char [len+1];
-	if (str.read (buf, len))
+	const char *data = str.take (len);
+	if (data)
 	{
+	    char *buf = new char [len+1];
+	    memcpy (buf, data, len);
 	    buf[len] = 0;
 	    return buf;
 	}
-	delete [] buf;
     }
     return 0;
 }
@@ -325,12 +695,13 @@ Bytecode::readBytep (bytecodeistream & str)
     u_int32_t len = readInt32 (str);
     if (str.good())
     {
-	unsigned char *buf = new unsigned char [len];
-	if (str.read ((char *)buf, len))
+	const char *data = str.take (len);
+	if (data)
 	{
+	    unsigned char *buf = new unsigned char [len];
+	    memcpy (buf, data, len);
 	    return buf;
 	}
-	delete [] buf;
     }
     return 0;
 }
@@ -578,6 +949,28 @@ Bytecode::readYCodelist (bytecodeistream & str, ycodelist_t **anchor)
 }
 
 
+// ------------------------------------------------------------------
+// section I/O
+
+std::ostream &
+Bytecode::writeSection (std::ostream & str, section_t kind, const string & data)
+{
+    m_writer->sections.push_back (std::make_pair (kind, data));
+    return writeInt32 (str, m_writer->sections.size ());
+}
+
+
+void
+Bytecode::writeImport (const string & name)
+{
+    std::vector<string> & imports = m_writer->imports;
+    if (std::find (imports.begin (), imports.end (), name) == imports.end ())
+    {
+	imports.push_back (name);
+    }
+}
+
+
 // ------------------------------------------------------------------
 // namespace stack handling
 
@@ -636,6 +1029,7 @@ Bytecode::pushNamespace (const Y2Namespace *name_space, bool with_xrefs)
 #endif
     m_namespace_nesting_array[m_namespace_nesting_level].name_space = name_space;
     m_namespace_nesting_array[m_namespace_nesting_level].with_xrefs = with_xrefs;
+    m_namespace_nesting_array[m_namespace_nesting_level].xrefs = 0;
     if (with_xrefs)
     {
 	name_space->table()->openXRefs();
@@ -673,6 +1067,7 @@ Bytecode::popNamespace (const Y2Namespace *name_space)
 	{
 	    name_space->table()->closeXRefs();
 	}
+	LazyDefinition::release (m_namespace_nesting_array[m_namespace_nesting_level].xrefs);
 	m_namespace_nesting_level--;
     }
     return 0;
@@ -699,6 +1094,7 @@ Bytecode::popUptoNamespace (const Y2Namespace *name_space)
 	{
 	    top_space->table()->closeXRefs();
 	}
+	LazyDefinition::release (m_namespace_nesting_array[m_namespace_nesting_level].xrefs);
 	m_namespace_nesting_level--;
 	if (top_space == name_space)
 	{
@@ -1062,6 +1458,120 @@ Bytecode::readCode (bytecodeistream & str)
 }
 
 
+// ------------------------------------------------------------------
+// function definitions read on first use
+
+unsigned int LazyDefinition::m_available = 0;
+unsigned int LazyDefinition::m_loaded = 0;
+
+LazyDefinition::LazyDefinition (bytecodeistream & str, u_int32_t section)
+    : m_stream (&str)
+    , m_section (section)
+{
+    m_stream->ref ();
+    m_available++;
+
+    for (int i = Bytecode::m_namespace_tare_level; i <= Bytecode::m_namespace_nesting_level; i++)
+    {
+	Bytecode::namespaceentry_t & entry = Bytecode::m_namespace_nesting_array[i];
+	scope_t scope;
+	scope.name_space = entry.name_space;
+	scope.xrefs = 0;
+	if (entry.with_xrefs)
+	{
+	    // copy the xrefs of the import once for all definitions after it
+	    if (entry.xrefs == 0)
+	    {
+		entry.xrefs = new XRefs;
+		entry.xrefs->users = 1;
+		const std::vector<TableEntry *> *refs = entry.name_space->table()->currentXRefs ();
+		if (refs)
+		{
+		    entry.xrefs->refs = *refs;
+		}
+	    }
+	    scope.xrefs = entry.xrefs;
+	    scope.xrefs->users++;
+	}
+	m_scopes.push_back (scope);
+    }
+}
+
+
+LazyDefinition::~LazyDefinition ()
+{
+    Y2Namespace::LoadLock lock;
+
+    for (size_t i = 0; i < m_scopes.size (); i++)
+    {
+	release (m_scopes[i].xrefs);
+    }
+    m_stream->unref ();
+}
+
+
+void
+LazyDefinition::release (XRefs *xrefs)
+{
+    if (xrefs != 0
+	&& --xrefs->users == 0)
+    {
+	delete xrefs;
+    }
+}
+
+
+YCodePtr
+LazyDefinition::read ()
+{
+    Y2Namespace::LoadLock lock;
+
+    // the namespaces as they were, on top of any file being read now
+    int tare_id = Bytecode::tareStack ();
+    int level = Bytecode::m_namespace_nesting_level;
+
+    YCodePtr definition = 0;
+    try
+    {
+	for (size_t i = 0; i < m_scopes.size (); i++)
+	{
+	    Bytecode::pushNamespace (m_scopes[i].name_space);
+	    if (m_scopes[i].xrefs)
+	    {
+		m_scopes[i].name_space->table()->openXRefs (m_scopes[i].xrefs->refs);
+		Bytecode::m_namespace_nesting_array[Bytecode::m_namespace_nesting_level].with_xrefs = true;
+	    }
+	}
+
+	YCodeArena::Scope arena (m_stream->filename ());
+	bytecodeistream::Section section (*m_stream, m_section);
+	definition = Bytecode::readCode (*m_stream);
+    }
+    catch (const Bytecode::Invalid&)
+    {
+	definition = 0;
+    }
+
+    if (definition == 0)
+    {
+	y2error ("Cannot read function definition %u in '%s'", m_section, m_stream->filename ().c_str ());
+    }
+
+    // also after errors, whatever was pushed
+    while (Bytecode::m_namespace_nesting_level > level)
+    {
+	Bytecode::popNamespace (Bytecode::m_namespace_nesting_array[Bytecode::m_namespace_nesting_level].name_space);
+    }
+    Bytecode::untareStack (tare_id);
+
+    m_loaded++;
+#if DO_DEBUG
+    y2debug ("Read definition %u of '%s', %u of %u", m_section, m_stream->filename ().c_str (), m_loaded, m_available);
+#endif
+    return definition;
+}
+
+
 // ------------------------------------------------------------------
 // File I/O
 
@@ -1077,6 +1587,9 @@ Bytecode::readModule (const string & mname)
 //    y2debug ("Bytecode::readModule (%s) ", mname.c_str ());
 #endif
 
+    // the namespace stack and the module cache are shared
+    Y2Namespace::LoadLock lock;
+
     // TODO better error reporting?
     // like: could not find foo.ycp in /modules, /a/modules.
     // It will return an empty string on failure
@@ -1104,7 +1617,29 @@ Bytecode::readModule (const string & mname)
     }
     
     int tare_id = Bytecode::tareStack ();			// current nesting level is 0 for this module
-    YBlockPtr block = (YBlockPtr)Bytecode::readFile (filename);
+    int level = m_namespace_nesting_level;
+
+    YCodePtr code = 0;
+    // the file opened ahead in the background
+    bytecodeistream *stream = ModulePrefetch::take (mname, filename);
+    if (stream != 0)
+    {
+	code = readStream (stream);
+	if (code == 0)
+	{
+	    y2warning ("Cannot read '%s' prefetched, reading the file", filename.c_str());
+	    // drop what the failed read left on the stack
+	    while (m_namespace_nesting_level > level)
+	    {
+		popNamespace (m_namespace_nesting_array[m_namespace_nesting_level].name_space);
+	    }
+	}
+    }
+    if (code == 0)
+    {
+	code = readFile (filename);
+    }
+    YBlockPtr block = (YBlockPtr)code;
 
     if (block == NULL)
     {
@@ -1125,6 +1660,16 @@ Bytecode::readModule (const string & mname)
 }
 
 
+// the reference of readFile to its stream
+class StreamRef
+{
+    bytecodeistream *m_stream;
+public:
+    StreamRef (bytecodeistream *stream) : m_stream (stream) {}
+    ~StreamRef () { m_stream->unref (); }
+};
+
+
 // read YCode from file, return YCode (0 in case of failure)
 YCodePtr
 Bytecode::readFile (const string & filename)
@@ -1132,7 +1677,21 @@ Bytecode::readFile (const string & filename)
 #if DO_DEBUG
 //    y2debug ("Bytecode::readFile (%s)", filename.c_str());
 #endif
-    bytecodeistream instream (filename);
+
+    Y2Namespace::LoadLock lock;
+
+    // kept open by the definitions read later (LazyDefinition)
+    return readStream (new bytecodeistream (filename));
+}
+
+
+// read YCode from stream, taking over the reference to it
+YCodePtr
+Bytecode::readStream (bytecodeistream *stream)
+{
+    StreamRef ref (stream);
+    bytecodeistream & instream = *stream;
+    const string & filename = stream->filename ();
     if (!instream.is_open ())
     {
 	y2error ("Failed to open '%s': %s", filename.c_str(), strerror (errno));
@@ -1145,20 +1704,41 @@ Bytecode::readFile (const string & filename)
 	    , atoi (YaST_BYTECODE_MINOR)
 	    , atoi (YaST_BYTECODE_RELEASE))
 	||
+	instream.isVersion (1,4,0)	// without sections
+	||
 	instream.isVersion (1,3,2) )	// 9.1/SLES9
     {
 #if DO_DEBUG
 //	y2debug ("Header accepted");
 #endif
 
+	bool prefetching = false;
 	try
 	{
-	    return readCode (instream);
+	    // all nodes of this file go to one arena
+	    YCodeArena::Scope arena (filename);
+	    u_int32_t section = instream.findSection (sCode);
+	    if (instream.hasSections () && section == 0)
+	    {
+		y2error ("No code in '%s'", filename.c_str());
+		return 0;
+	    }
+	    // the imports are opened meanwhile
+	    ModulePrefetch::imports (instream);
+	    prefetching = true;
+	    bytecodeistream::Section code (instream, section);
+	    YCodePtr res = readCode (instream);
+	    ModulePrefetch::read ();
+	    return res;
 	}
 	catch (const Bytecode::Invalid&)
 	{
 	    // there are memory leaks all over the place now
 	    y2error ("Caught invalid bytecode in '%s'", filename.c_str());
+	    if (prefetching)
+	    {
+		ModulePrefetch::read ();
+	    }
 	    return 0;
 	}
     }
@@ -1172,26 +1752,91 @@ Bytecode::readFile (const string & filename)
 
 
 // write YCode to file, return false on error (i.e. file not existing - see errno)
+//
+// The file consists of
+//   the header, "YaST bytecode 1.5.0\0"
+//   the section index, the number of sections and for each its kind,
+//     offset (from the end of the index) and length, all as Int32
+//   the sections, in the order of the index
+//
+// Each string is written once to the string table, the section of
+// kind sStrings (the number of strings and each as written by
+// writeString), and referred to by its index in the table elsewhere.
+// Sections are referred to by their number in the index, starting at
+// 1. The code (sCode) starts with the outermost block, see YBlock and
+// YFunction for the other sections. sImports has the number of
+// modules imported and their names.
 bool
 Bytecode::writeFile (const YCodePtr code, const string & filename)
 {
+    Y2Namespace::LoadLock lock;
+
     // clear errno first
     errno = 0;
 
 #if DO_DEBUG
 //    y2debug ("Bytecode::writeFile (%s)", filename.c_str());
 #endif
-    std::ofstream outstream (filename.c_str());
+    // written aside and renamed, running programs may have mapped the
+    // old file and read function definitions from it on first use
+    string tmpname = filename + ".new";
+    std::ofstream outstream (tmpname.c_str());
     if (!outstream.is_open ())
     {
-	y2error ("Failed to write '%s': %s", filename.c_str(), strerror (errno));
+	y2error ("Failed to write '%s': %s", tmpname.c_str(), strerror (errno));
 	return false;
     }
 
     string header =  string (YaST_BYTECODE_HEADER YaST_BYTECODE_MAJOR "." YaST_BYTECODE_MINOR "." YaST_BYTECODE_RELEASE);
     outstream.write (header.c_str(), header.size() + 1);	// including trailing \0
 
-    code->toStream (outstream);
+    filewriter_t writer;
+    m_writer = &writer;
+
+    std::ostringstream codestream;
+    code->toStream (codestream);
+
+    std::ostringstream imports;
+    writeInt32 (imports, writer.imports.size ());
+    for (size_t i = 0; i < writer.imports.size (); i++)
+    {
+	writeString (imports, writer.imports[i]);
+    }
+    m_writer = 0;
+    writer.sections.push_back (std::make_pair (sCode, codestream.str ()));
+    writer.sections.push_back (std::make_pair (sImports, imports.str ()));
+
+    std::ostringstream strings;
+    writeInt32 (strings, writer.strings.size ());
+    for (size_t i = 0; i < writer.strings.size (); i++)
+    {
+	writeString (strings, *writer.strings[i]);
+    }
+    writer.sections.push_back (std::make_pair (sStrings, strings.str ()));
 
-    return ! outstream.fail ();
+    u_int32_t offset = 0;
+    writeInt32 (outstream, writer.sections.size ());
+    for (size_t i = 0; i < writer.sections.size (); i++)
+    {
+	u_int32_t length = writer.sections[i].second.size ();
+	writeInt32 (outstream, writer.sections[i].first);
+	writeInt32 (outstream, offset);
+	writeInt32 (outstream, length);
+	offset += length;
+    }
+
+    for (size_t i = 0; i < writer.sections.size (); i++)
+    {
+	outstream.write (writer.sections[i].second.data (), writer.sections[i].second.size ());
+    }
+
+    outstream.close ();
+    if (outstream.fail ()
+	|| rename (tmpname.c_str (), filename.c_str ()) != 0)
+    {
+	y2error ("Failed to write '%s': %s", filename.c_str(), strerror (errno));
+	unlink (tmpname.c_str ());
+	return false;
+    }
+    return true;
 }
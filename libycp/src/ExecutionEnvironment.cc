@@ -12,21 +12,38 @@
  *
  */
 
+#include <set>
+#include <pthread.h>
+
 #include "ycp/ExecutionEnvironment.h"
+#include "ycp/Profiler.h"
 
 #include "ycp/YStatement.h"
 
 #include "ycp/y2log.h"
 
+#ifndef DO_DEBUG
+#define DO_DEBUG 0
+#endif
+
 // the number of call frames to show warning at
 #define WARN_RECURSION 1001
 static const char * Y2RECURSIONLIMIT = "Y2RECURSIONLIMIT";
 
+__thread ExecutionEnvironment *ExecutionEnvironment::_current = 0;
+
+static pthread_mutex_t intern_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// calls on 'ee' go to the environment of the current interpreter context
+#define CONTEXT_FORWARD(call) \
+    if (_current != 0 && _current != this) return _current->call
+
 
 ExecutionEnvironment::ExecutionEnvironment ()
-    : m_filename ("")
+    : m_filename (intern (""))
     , m_forced_filename (false)
     , m_statement(NULL)
+    , m_depth (0)
 {
     m_backtrace.clear ();
 
@@ -36,11 +53,37 @@ ExecutionEnvironment::ExecutionEnvironment ()
 	m_recursion_limit = atoi (s);
     if (m_recursion_limit == 0)
 	m_recursion_limit = WARN_RECURSION;
+
+    Profiler::initialize ();
+}
+
+
+ExecutionEnvironment::~ExecutionEnvironment ()
+{
+    for (CallStack::iterator it = m_backtrace.begin (); it != m_backtrace.end (); ++it)
+    {
+	delete *it;
+    }
+}
+
+
+const string *
+ExecutionEnvironment::intern (const string & filename)
+{
+    // function local, the global 'ee' is constructed during static initialization
+    static std::set<string> filenames;
+
+    pthread_mutex_lock (&intern_mutex);
+    const string *interned = &*(filenames.insert (filename).first);
+    pthread_mutex_unlock (&intern_mutex);
+    return interned;
 }
 
+
 int
 ExecutionEnvironment::linenumber () const
 {
+    CONTEXT_FORWARD (linenumber ());
     return m_linenumber;
 }
 
@@ -48,13 +91,23 @@ ExecutionEnvironment::linenumber () const
 void
 ExecutionEnvironment::setLinenumber (int line)
 {
+    CONTEXT_FORWARD (setLinenumber (line));
     m_linenumber = line;
 }
 
 
-const string 
+const string
 ExecutionEnvironment::filename () const
 {
+    CONTEXT_FORWARD (filename ());
+    return *m_filename;
+}
+
+
+const string *
+ExecutionEnvironment::internedFilename () const
+{
+    CONTEXT_FORWARD (internedFilename ());
     return m_filename;
 }
 
@@ -62,6 +115,17 @@ ExecutionEnvironment::filename () const
 void
 ExecutionEnvironment::setFilename (const string & filename)
 {
+    CONTEXT_FORWARD (setFilename (filename));
+    m_filename = intern (filename);
+    m_forced_filename = true;
+    return;
+}
+
+
+void
+ExecutionEnvironment::setFilename (const string * filename)
+{
+    CONTEXT_FORWARD (setFilename (filename));
     m_filename = filename;
     m_forced_filename = true;
     return;
@@ -71,6 +135,7 @@ ExecutionEnvironment::setFilename (const string & filename)
 YStatementPtr
 ExecutionEnvironment::statement () const
 {
+    CONTEXT_FORWARD (statement ());
     return m_statement;
 }
 
@@ -78,6 +143,7 @@ ExecutionEnvironment::statement () const
 void
 ExecutionEnvironment::setStatement (YStatementPtr s)
 {
+    CONTEXT_FORWARD (setStatement (s));
     m_statement = s;
     
     if (s != NULL)
@@ -91,7 +157,8 @@ ExecutionEnvironment::setStatement (YStatementPtr s)
 bool
 ExecutionEnvironment::endlessRecursion ()
 {
-    if (m_backtrace.size () == m_recursion_limit)
+    CONTEXT_FORWARD (endlessRecursion ());
+    if (m_depth == m_recursion_limit)
     {
 	y2error ("Recursion limit of %zd call frames reached. Set the environment variable %s to change this", m_recursion_limit, Y2RECURSIONLIMIT);
 	return true;
@@ -102,9 +169,30 @@ ExecutionEnvironment::endlessRecursion ()
 void
 ExecutionEnvironment::pushframe (YECallPtr function, YCPValue m_params[])
 {
+    CONTEXT_FORWARD (pushframe (function, m_params));
+#if DO_DEBUG
     y2debug ("Push frame %s", function->entry()->name());
-    CallFrame* frame = new CallFrame (filename(), linenumber (), function, m_params);
-    m_backtrace.push_back (frame);
+#endif
+    if (m_depth < m_backtrace.size ())
+    {
+	// reuse a frame from a previous, deeper call chain
+	CallFrame* frame = const_cast<CallFrame*> (m_backtrace[m_depth]);
+	frame->function = function;
+	frame->filename = m_filename;
+	frame->linenumber = m_linenumber;
+	frame->params = m_params;
+    }
+    else
+    {
+	m_backtrace.push_back (new CallFrame (m_filename, m_linenumber, function, m_params));
+    }
+    m_depth++;
+
+    // the profiler follows the evaluation outside of interpreter contexts
+    if (profiler_instance && _current == 0)
+    {
+	profiler_instance->enterFunction (*function->entry ());
+    }
     // backtrace( LOG_MILESTONE, 0 );
 }
 
@@ -112,28 +200,39 @@ ExecutionEnvironment::pushframe (YECallPtr function, YCPValue m_params[])
 void
 ExecutionEnvironment::popframe ()
 {
-    y2debug ("Pop frame %p", m_backtrace.back ());
-    const CallFrame* frame = m_backtrace.back ();
-    m_backtrace.pop_back ();
+    CONTEXT_FORWARD (popframe ());
+#if DO_DEBUG
+    y2debug ("Pop frame %p", m_backtrace[m_depth-1]);
+#endif
+    if (profiler_instance && _current == 0)
+    {
+	profiler_instance->leave ();
+    }
+
+    m_depth--;
+    // drop the references, but keep the frame for the next call
+    CallFrame* frame = const_cast<CallFrame*> (m_backtrace[m_depth]);
+    frame->function = 0;
+    frame->params = 0;
     // backtrace( LOG_MILESTONE, 0 );
-    delete frame;
 }
 
 
 void
 ExecutionEnvironment::backtrace (loglevel_t level, uint omit) const
 {
-    if (m_backtrace.empty ())
+    CONTEXT_FORWARD (backtrace (level, omit));
+    if (m_depth == 0)
 	return;
 	
     // FIXME: omit
-    CallStack::const_reverse_iterator it = m_backtrace.rbegin();
+    CallStack::const_reverse_iterator it (m_backtrace.begin () + m_depth);
 
     y2logger(level, "------------- Backtrace begin -------------");
     
     while (it != m_backtrace.rend())
     {
-	ycp2log (level, (*it)->filename.c_str (), (*it)->linenumber
+	ycp2log (level, (*it)->filename->c_str (), (*it)->linenumber
 		 , "", "%s", (*it)->function->entry()->toString().c_str());
 	++it;
     };
@@ -144,8 +243,9 @@ ExecutionEnvironment::backtrace (loglevel_t level, uint omit) const
 
 ExecutionEnvironment::CallStack ExecutionEnvironment::callstack() const
 {
+    CONTEXT_FORWARD (callstack ());
     // backtrace( LOG_MILESTONE, 0 );
-    return m_backtrace;
+    return CallStack (m_backtrace.begin (), m_backtrace.begin () + m_depth);
 }
 
 /* EOF */
@@ -31,6 +31,7 @@
 
 #include "y2/Y2Component.h"
 #include "y2/Y2ComponentBroker.h"
+#include "y2/Y2Namespace.h"
 
 
 //-------------------------------------------------------------------
@@ -63,6 +64,9 @@ Import::~Import ()
 int
 Import::import (const string &name, Y2Namespace *preloaded_namespace)
 {
+    // m_active_modules and the usage tracking are shared
+    Y2Namespace::LoadLock lock;
+
     if (!m_name->empty())
     {
 	ycp2error ("Import::import(%s) called again but already initialized with '%s'", name.c_str(), m_name->c_str());
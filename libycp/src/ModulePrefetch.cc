@@ -0,0 +1,319 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	ModulePrefetch.cc
+
+   Opening the bytecode of imported modules ahead, in the background
+
+/-*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "ycp/ModulePrefetch.h"
+#include "ycp/Bytecode.h"
+#include "ycp/pathsearch.h"
+#include "ycp/y2log.h"
+
+#include "y2/Y2Namespace.h"
+
+using std::vector;
+
+static const char *Y2PREFETCH = "Y2PREFETCH";
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+static int enabled = -1;		// not decided yet
+static bool started = false;
+
+static std::deque<string> queue;	// modules to prefetch, the next first
+static std::set<string> seen;		// modules queued once
+static std::set<string> taken;		// modules read by now, not to prefetch
+static std::map<string, bytecodeistream *> ready;
+static string busy;			// the module being prefetched
+static unsigned int dropped = 0;	// times ready and queue were dropped
+static std::list<string> search_list;	// copy of the module path
+static unsigned int used_count = 0;
+
+static int reading = 0;			// files being read, under the LoadLock
+
+
+// the names in the sImports section of stream
+static void
+readImports (bytecodeistream & stream, vector<string> & names)
+{
+    u_int32_t section = stream.findSection (Bytecode::sImports);
+    if (section == 0)
+    {
+	return;
+    }
+
+    bytecodeistream::Section imports (stream, section);
+    u_int32_t count = Bytecode::readInt32 (stream);
+    for (u_int32_t i = 0; i < count && stream.good (); i++)
+    {
+	string name;
+	if (Bytecode::readString (stream, name))
+	{
+	    names.push_back (name);
+	}
+    }
+}
+
+
+// queue names to be prefetched before the ones queued already,
+//  mutex is locked
+static void
+enqueue (const vector<string> & names)
+{
+    for (vector<string>::const_reverse_iterator it = names.rbegin (); it != names.rend (); ++it)
+    {
+	if (seen.insert (*it).second)
+	{
+	    queue.push_front (*it);
+	}
+    }
+}
+
+
+// YCPPathSearch::findModule in the copy of the module path, the
+//  search list itself may change in the thread reading meanwhile
+static string
+findModule (const std::list<string> & paths, const string & name)
+{
+    for (std::list<string>::const_iterator it = paths.begin (); it != paths.end (); ++it)
+    {
+	string pathname = Y2PathSearch::completeFilename (*it + '/' + name + ".ybc");
+	if (access (pathname.c_str (), R_OK) == 0)
+	{
+	    return pathname;
+	}
+    }
+    return "";
+}
+
+
+// open module name and find its imports, 0 if it has no bytecode file
+static bytecodeistream *
+prefetch (const std::list<string> & paths, const string & name, vector<string> & names)
+{
+    string filename = findModule (paths, name);
+    if (filename.empty ())
+    {
+	// not a YCP module, or not there
+	return 0;
+    }
+
+    bytecodeistream *stream = new bytecodeistream (filename);
+    if (stream->is_open () && stream->good ())
+    {
+	readImports (*stream, names);
+    }
+
+    if (!stream->is_open () || !stream->good ())
+    {
+	stream->unref ();
+	return 0;
+    }
+    return stream;
+}
+
+
+static void *
+worker (void *)
+{
+    pthread_mutex_lock (&mutex);
+    while (true)
+    {
+	while (queue.empty ())
+	{
+	    pthread_cond_wait (&work_cond, &mutex);
+	}
+	string name = queue.front ();
+	queue.pop_front ();
+	if (taken.find (name) != taken.end ())
+	{
+	    continue;
+	}
+
+	busy = name;
+	std::list<string> paths = search_list;
+	unsigned int generation = dropped;
+	pthread_mutex_unlock (&mutex);
+
+	vector<string> names;
+	bytecodeistream *stream = prefetch (paths, name, names);
+
+	pthread_mutex_lock (&mutex);
+	busy.clear ();
+	if (generation != dropped)
+	{
+	    // the file importing it was read meanwhile
+	    if (stream != 0)
+	    {
+		stream->unref ();
+	    }
+	}
+	else
+	{
+	    if (stream != 0)
+	    {
+		ready[name] = stream;
+	    }
+	    // the modules it imports are needed next
+	    enqueue (names);
+	}
+	pthread_cond_broadcast (&done_cond);
+    }
+
+    return 0;
+}
+
+
+// decide once, under the LoadLock
+static bool
+isEnabled ()
+{
+    if (enabled < 0)
+    {
+	const char *s = getenv (Y2PREFETCH);
+	if (s != 0 && *s != 0 && atoi (s) == 0)
+	{
+	    enabled = 0;
+	}
+	else
+	{
+	    // set up the search path before the worker uses it
+	    YCPPathSearch::initialize ();
+	    enabled = 1;
+	}
+    }
+    return enabled == 1;
+}
+
+
+void
+ModulePrefetch::imports (bytecodeistream & stream)
+{
+    Y2Namespace::LoadLock lock;
+
+    reading++;
+    if (!isEnabled ())
+    {
+	return;
+    }
+
+    vector<string> names;
+    readImports (stream, names);
+    if (names.empty ())
+    {
+	return;
+    }
+
+    pthread_mutex_lock (&mutex);
+    search_list.assign (YCPPathSearch::searchListBegin (YCPPathSearch::Module),
+			YCPPathSearch::searchListEnd (YCPPathSearch::Module));
+    enqueue (names);
+    if (!started)
+    {
+	pthread_t thread;
+	if (pthread_create (&thread, 0, worker, 0) != 0)
+	{
+	    y2warning ("Cannot start thread for prefetching modules: %m");
+	    enabled = 0;
+	}
+	else
+	{
+	    pthread_detach (thread);
+	    started = true;
+	}
+    }
+    pthread_cond_signal (&work_cond);
+    pthread_mutex_unlock (&mutex);
+}
+
+
+void
+ModulePrefetch::read ()
+{
+    Y2Namespace::LoadLock lock;
+
+    if (--reading > 0
+	|| !started)
+    {
+	return;
+    }
+
+    // all imports are read by now, what is left was not needed
+    pthread_mutex_lock (&mutex);
+    for (std::map<string, bytecodeistream *>::iterator it = ready.begin (); it != ready.end (); ++it)
+    {
+	y2debug ("Module '%s' was prefetched but not read", it->first.c_str ());
+	it->second->unref ();
+    }
+    ready.clear ();
+    queue.clear ();
+    dropped++;
+    pthread_mutex_unlock (&mutex);
+}
+
+
+bytecodeistream *
+ModulePrefetch::take (const string & name, const string & filename)
+{
+    pthread_mutex_lock (&mutex);
+    taken.insert (name);
+    while (busy == name)
+    {
+	pthread_cond_wait (&done_cond, &mutex);
+    }
+
+    bytecodeistream *stream = 0;
+    std::map<string, bytecodeistream *>::iterator it = ready.find (name);
+    if (it != ready.end ())
+    {
+	stream = it->second;
+	ready.erase (it);
+    }
+    pthread_mutex_unlock (&mutex);
+
+    if (stream != 0
+	&& stream->filename () != filename)
+    {
+	// the module path changed meanwhile
+	stream->unref ();
+	stream = 0;
+    }
+
+    if (stream != 0)
+    {
+	y2debug ("Module '%s' was prefetched", name.c_str ());
+	used_count++;
+    }
+    return stream;
+}
+
+
+unsigned int
+ModulePrefetch::used ()
+{
+    return used_count;
+}
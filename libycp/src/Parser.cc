@@ -23,9 +23,11 @@
 
 #include "ycp/Parser.h"
 #include "ycp/Scanner.h"
+#include "ycp/YCodeArena.h"
 #include "ycp/y2log.h"
 #include "ycp/StaticDeclaration.h"
 #include "ycp/SymbolTable.h"
+#include "y2/Y2Namespace.h"
 
 extern StaticDeclaration static_declarations;
 
@@ -164,6 +166,9 @@ Parser::parse (SymbolTable *gTable, SymbolTable *lTable)
 	y2debug ("Running with full debug");
 #endif
 
+    // the parser shares the global symbol tables and the module list
+    Y2Namespace::LoadLock lock;
+
     if (m_scanner == 0)
     {
 	y2internal("Not input for the parser has been set");
@@ -176,6 +181,9 @@ Parser::parse (SymbolTable *gTable, SymbolTable *lTable)
 
     m_result = 0;
 
+    // all nodes of this file go to one arena
+    YCodeArena::Scope arena (m_scanner->filename ());
+
     if (yyparse ((void *) this))
     {
 	// syntax error occured
@@ -0,0 +1,363 @@
+/*
+ * YaST2: Core system
+ *
+ * Description:
+ *   Profiler for YCP code, see Profiler.h
+ *
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ycp/Profiler.h"
+#include "ycp/StaticDeclaration.h"
+#include "ycp/y2log.h"
+
+#include <y2/SymbolEntry.h>
+
+static const char * Y2PROFILE = "Y2PROFILE";
+static const char * Y2PROFILEFILE = "Y2PROFILEFILE";
+static const char * Y2PROFILEINTERVAL = "Y2PROFILEINTERVAL";
+
+// default sampling interval in microseconds
+#define SAMPLE_INTERVAL 10000
+
+Profiler *profiler_instance = 0;
+
+volatile sig_atomic_t Profiler::_pending = 0;
+
+
+static unsigned long long
+now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec * 1000000ULL + tv.tv_usec;
+}
+
+
+static void
+profilerAtExit ()
+{
+    if (profiler_instance)
+    {
+	profiler_instance->report ();
+	delete profiler_instance;
+	profiler_instance = 0;
+    }
+}
+
+
+Profiler::Node::~Node ()
+{
+    for (std::map<const void *, Node *>::iterator it = children.begin (); it != children.end (); ++it)
+    {
+	delete it->second;
+    }
+}
+
+
+Profiler::Profiler (mode_t mode, const string & prefix)
+    : m_mode (mode)
+    , m_prefix (prefix)
+    , m_root (new Node (0, 0))
+    , m_left (0)
+    , m_last (now ())
+{
+    m_current = m_root;
+    m_names[0] = "(toplevel)";
+}
+
+
+Profiler::~Profiler ()
+{
+    delete m_root;
+}
+
+
+void
+Profiler::initialize ()
+{
+    const char *mode = getenv (Y2PROFILE);
+    if (mode == 0 || *mode == 0 || profiler_instance != 0)
+    {
+	return;
+    }
+
+    mode_t m;
+    if (strcmp (mode, "sample") == 0)
+    {
+	m = p_sample;
+    }
+    else if (strcmp (mode, "trace") == 0)
+    {
+	m = p_trace;
+    }
+    else
+    {
+	y2error ("Unknown %s mode '%s', use 'trace' or 'sample'", Y2PROFILE, mode);
+	return;
+    }
+
+    const char *prefix = getenv (Y2PROFILEFILE);
+    char buf[64];
+    if (prefix == 0 || *prefix == 0)
+    {
+	snprintf (buf, sizeof (buf), "/tmp/ycp-profile.%d", (int) getpid ());
+	prefix = buf;
+    }
+
+    profiler_instance = new Profiler (m, prefix);
+    atexit (profilerAtExit);
+
+    if (m == p_sample)
+    {
+	long interval = 0;
+	const char *s = getenv (Y2PROFILEINTERVAL);
+	if (s != 0)
+	    interval = atol (s);
+	if (interval <= 0)
+	    interval = SAMPLE_INTERVAL;
+
+	struct sigaction sa;
+	memset (&sa, 0, sizeof (sa));
+	sa.sa_handler = sampleHandler;
+	sa.sa_flags = SA_RESTART;
+	sigemptyset (&sa.sa_mask);
+	sigaction (SIGPROF, &sa, 0);
+
+	struct itimerval timer;
+	timer.it_interval.tv_sec = interval / 1000000;
+	timer.it_interval.tv_usec = interval % 1000000;
+	timer.it_value = timer.it_interval;
+	setitimer (ITIMER_PROF, &timer, 0);
+    }
+
+    y2milestone ("Profiling YCP code (%s), output to %s.{folded,txt}", mode, prefix);
+}
+
+
+// SIGPROF handler, only counts. The sample is attributed to the
+// current call path at the next enter() or leave().
+
+void
+Profiler::sampleHandler (int)
+{
+    _pending = _pending + 1;
+}
+
+
+inline void
+Profiler::charge ()
+{
+    if (m_mode == p_trace)
+    {
+	unsigned long long t = now ();
+	m_current->self += t - m_last;
+	m_last = t;
+    }
+    else if (_pending)
+    {
+	// swapped in one step, a sample may arrive any time
+	m_current->self += __sync_lock_test_and_set (&_pending, 0);
+    }
+}
+
+
+Profiler::Node *
+Profiler::child (const void *id)
+{
+    std::map<const void *, Node *>::iterator it = m_current->children.find (id);
+    if (it != m_current->children.end ())
+    {
+	return it->second;
+    }
+    Node *node = new Node (id, m_current);
+    m_current->children[id] = node;
+    return node;
+}
+
+
+void
+Profiler::enter (const void *id)
+{
+    charge ();
+
+    // loops call the same sequence of functions again and again
+    Node **guess = m_left ? &m_left->next : &m_current->first;
+    Node *node = *guess;
+    if (node == 0 || node->id != id)
+    {
+	node = child (id);
+	*guess = node;
+    }
+    node->calls++;
+    m_current = node;
+    m_left = 0;
+}
+
+
+void
+Profiler::leave ()
+{
+    charge ();
+
+    if (m_current->parent != 0)
+    {
+	m_left = m_current;
+	m_current = m_current->parent;
+    }
+}
+
+
+void
+Profiler::enterFunction (const SymbolEntry & entry)
+{
+    enter (&entry);
+
+    // first call on this path, make sure the name is known
+    if (m_current->calls == 1
+	&& m_names.find (&entry) == m_names.end ())
+    {
+	m_names[&entry] = entry.toString (false);
+    }
+}
+
+
+void
+Profiler::enterBuiltin (const declaration *decl)
+{
+    enter (decl);
+
+    if (m_current->calls == 1
+	&& m_names.find (decl) == m_names.end ())
+    {
+	string name = decl->name;
+	if (decl->name_space != 0)
+	{
+	    name = string (decl->name_space->name) + "::" + name;
+	}
+	m_names[decl] = name;
+    }
+}
+
+
+const string &
+Profiler::nameOf (const void *id) const
+{
+    return m_names.find (id)->second;
+}
+
+
+void
+Profiler::writeFolded (FILE *out, Node *node, const string & path) const
+{
+    string here = path.empty () ? nameOf (node->id) : path + ";" + nameOf (node->id);
+
+    if (node->self > 0)
+    {
+	fprintf (out, "%s %llu\n", here.c_str (), node->self);
+    }
+    for (std::map<const void *, Node *>::const_iterator it = node->children.begin (); it != node->children.end (); ++it)
+    {
+	writeFolded (out, it->second, here);
+    }
+}
+
+
+unsigned long long
+Profiler::summarize (Node *node, std::map<string, Summary> & summary) const
+{
+    Summary & s = summary[nameOf (node->id)];
+    s.calls += node->calls;
+    s.self += node->self;
+
+    unsigned long long total = node->self;
+    s.active++;
+    for (std::map<const void *, Node *>::const_iterator it = node->children.begin (); it != node->children.end (); ++it)
+    {
+	total += summarize (it->second, summary);
+    }
+    s.active--;
+
+    // recursion: already contained in the outermost call
+    if (s.active == 0)
+    {
+	s.inclusive += total;
+    }
+    return total;
+}
+
+
+static bool
+bySelf (const std::pair<unsigned long long, string> & a, const std::pair<unsigned long long, string> & b)
+{
+    return a.first > b.first;
+}
+
+
+void
+Profiler::report ()
+{
+    charge ();
+
+    if (m_mode == p_sample)
+    {
+	struct itimerval timer;
+	memset (&timer, 0, sizeof (timer));
+	setitimer (ITIMER_PROF, &timer, 0);
+    }
+
+    string filename = m_prefix + ".folded";
+    FILE *out = fopen (filename.c_str (), "w");
+    if (out == 0)
+    {
+	y2error ("Can't write profile %s: %s", filename.c_str (), strerror (errno));
+	return;
+    }
+    writeFolded (out, m_root, "");
+    fclose (out);
+
+    std::map<string, Summary> summary;
+    unsigned long long total = summarize (m_root, summary);
+    if (total == 0)
+    {
+	total = 1;
+    }
+
+    std::vector<std::pair<unsigned long long, string> > order;
+    for (std::map<string, Summary>::const_iterator it = summary.begin (); it != summary.end (); ++it)
+    {
+	order.push_back (std::make_pair (it->second.self, it->first));
+    }
+    std::stable_sort (order.begin (), order.end (), bySelf);
+
+    filename = m_prefix + ".txt";
+    out = fopen (filename.c_str (), "w");
+    if (out == 0)
+    {
+	y2error ("Can't write profile %s: %s", filename.c_str (), strerror (errno));
+	return;
+    }
+    fprintf (out, "# YCP profile, %s\n", m_mode == p_trace ? "times in microseconds" : "cpu time samples");
+    fprintf (out, "# %12s %7s %12s %7s %10s  %s\n", "self", "", "inclusive", "", "calls", "function");
+    for (std::vector<std::pair<unsigned long long, string> >::const_iterator it = order.begin (); it != order.end (); ++it)
+    {
+	const Summary & s = summary[it->second];
+	fprintf (out, "  %12llu %6.2f%% %12llu %6.2f%% %10lu  %s\n",
+		 s.self, 100.0 * s.self / total,
+		 s.inclusive, 100.0 * s.inclusive / total,
+		 s.calls, it->second.c_str ());
+    }
+    fclose (out);
+
+    y2milestone ("Profile written to %s.{folded,txt}", m_prefix.c_str ());
+}
+
+/* EOF */
@@ -347,6 +347,31 @@ SymbolTable::openXRefs ()
 }
 
 
+void
+SymbolTable::openXRefs (const std::vector<TableEntry *> & refs)
+{
+    if (! m_xrefs)
+    {
+	m_xrefs = new xrefs_t;
+    }
+
+    m_xrefs->push (new std::vector<TableEntry *> (refs));
+
+    return;
+}
+
+
+const std::vector<TableEntry *> *
+SymbolTable::currentXRefs () const
+{
+    if (!m_xrefs || m_xrefs->empty ())
+    {
+	return 0;
+    }
+    return m_xrefs->top();
+}
+
+
 void
 SymbolTable::closeXRefs ()
 {
@@ -701,8 +726,12 @@ SymbolTable::find (const char *key, SymbolEntry::category_t category)
 	    if ((category == SymbolEntry::c_unspec)		// wildcard
 		|| (tentry->sentry()->category() == category))	// or matching
 	    {
+		// the usage is for writing bytecode, it is not tracked for
+		//  the lookups of interpreter contexts (see SymbolEntry::_store)
+		//  which run concurrently on the shared tables
 		if (m_track_usage
 		    && m_used
+		    && SymbolEntry::_store == 0
 		    && m_used->find (tentry->m_key) == m_used->end())
 		{
 		    tentry->sentry()->setPosition (m_used->size());	// store the position in the sentry
@@ -23,7 +23,9 @@
 #include "ycp/YCPVoid.h"
 
 #include <stack>
+#include <sstream>
 #include <algorithm>
+#include <pthread.h>
 
 #ifndef DO_DEBUG
 #define DO_DEBUG 0
@@ -34,6 +36,7 @@
 #include "ycp/YSymbolEntry.h"
 #include "ycp/SymbolTable.h"
 #include "ycp/YExpression.h"
+#include "ycp/YProgram.h"
 #include "ycp/Point.h"
 
 #include "ycp/Bytecode.h"
@@ -62,11 +65,13 @@ YBlock::YBlock (const std::string & filename, YBlock::blockkind_t kind)
     , m_tenvironment (0)
     , m_last_tparm (0)
     , m_point (0)
+    , m_filename (0)
     , m_statements (0)
     , m_last_statement (0)
+    , m_linked (false)
+    , m_program (0)
     , m_includes (0)
     , m_type (Type::Unspec)
-    , m_running (false)
 {
 #if DO_DEBUG
     y2debug ("YBlock::YBlock [%p] (%s)", this, filename.c_str());
@@ -87,11 +92,13 @@ YBlock::YBlock (const Point *point)
     , m_tenvironment (0)
     , m_last_tparm (0)
     , m_point (point)
+    , m_filename (0)
     , m_statements (0)
     , m_last_statement (0)
+    , m_linked (false)
+    , m_program (0)
     , m_includes (0)
     , m_type (Type::Unspec)
-    , m_running (false)
 {
 }
 
@@ -125,6 +132,8 @@ YBlock::~YBlock ()
     
     if (m_includes)
 	delete m_includes;
+
+    delete m_program;
 }
 
 
@@ -193,6 +202,7 @@ YBlock::newEntry (const char *name, SymbolEntry::category_t cat, constTypePtr ty
     if (cat == SymbolEntry::c_filename)
     {
 	m_point = point;
+	m_filename = 0;
     }
     TableEntry *tentry = new TableEntry (sentry->name(), sentry, point);	// link symbol and declaration point
     attachEntry (tentry);
@@ -254,6 +264,7 @@ YBlock::attachStatement (YStatementPtr statement)
 	m_last_statement->next = newstmt;
         m_last_statement = newstmt;
     }
+    m_linked = false;
     
     return;
 }
@@ -270,11 +281,111 @@ YBlock::pretachStatement (YStatementPtr statement)
     newstmt->stmt = statement;
     newstmt->next = m_statements;
     m_statements = newstmt;
+    m_linked = false;
 
     return;
 }
 
 
+// the same code may be evaluated by several threads at once
+static pthread_mutex_t link_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void
+YBlock::linkStatements ()
+{
+    pthread_mutex_lock (&link_mutex);
+    if (! m_linked)
+    {
+	m_statementvector.clear ();
+	m_statementvector.reserve (statementCount ());
+
+	// lowered from the old statements
+	delete m_program;
+	m_program = 0;
+
+	stmtlist_t *stmt = m_statements;
+	while (stmt)
+	{
+	    m_statementvector.push_back (stmt->stmt);
+	    stmt = stmt->next;
+	}
+	// publish the vector before the flag
+	__sync_synchronize ();
+	m_linked = true;
+    }
+    pthread_mutex_unlock (&link_mutex);
+}
+
+
+void
+YBlock::buildProgram ()
+{
+    pthread_mutex_lock (&link_mutex);
+    if (m_program == 0)
+    {
+	YProgram *program = new YProgram (this);
+	// publish the program before the pointer
+	__sync_synchronize ();
+	m_program = program;
+    }
+    pthread_mutex_unlock (&link_mutex);
+}
+
+
+YCodePtr
+YBlock::optimize (int & removed)
+{
+    optimizeStatements (removed, false);
+    return this;
+}
+
+
+void
+YBlock::optimizeStatements (int & removed, bool keep_positions)
+{
+    stmtlist_t *prev = 0;
+    stmtlist_t *stmt = m_statements;
+    while (stmt)
+    {
+	YCodePtr optimized = stmt->stmt->optimize (removed);
+
+	if (optimized == 0
+	    && !keep_positions)
+	{
+	    // statement has no effect, unlink it
+	    stmtlist_t *next = stmt->next;
+	    if (prev == 0)
+	    {
+		m_statements = next;
+	    }
+	    else
+	    {
+		prev->next = next;
+	    }
+	    if (m_last_statement == stmt)
+	    {
+		m_last_statement = prev;
+	    }
+	    delete stmt;
+	    removed++;
+	    stmt = next;
+	    continue;
+	}
+
+	if (optimized != 0
+	    && optimized->isStatement ())
+	{
+	    stmt->stmt = (YStatementPtr)optimized;
+	}
+
+	prev = stmt;
+	stmt = stmt->next;
+    }
+
+    m_linked = false;
+}
+
+
 // bind namespace entry
 TableEntry *
 YBlock::newNamespace (const string & name, Y2Namespace *name_space, int line)
@@ -415,6 +526,7 @@ YBlock::endInclude ()
 	y2debug ("YBlock::endInclude(%s)", m_point->toString().c_str());
 #endif
 	m_point = point;
+	m_filename = 0;
     }
     return;
 }
@@ -587,95 +699,135 @@ YBlock::evaluate (bool cse)
 	debugger_instance->pushBlock (this, m_debug);
     }
 
-    // recursion handling - not used for modules
-    if (! isModule () && m_running)
+    // the local variables live in a frame, one per evaluation - not
+    //  used for modules, their variables are global
+    bool framed = ! isModule ();
+    if (framed)
     {
-	pushToStack ();
+	pushFrame ();
     }
-    
-    bool old_m_running = m_running;
-    m_running = true;
 
-    string restore_name;
-    if (!filename().empty())
+    if (m_filename == 0)
     {
-	restore_name = ee.filename ();
-	ee.setFilename (filename());
+	m_filename = ExecutionEnvironment::intern (filename ());
     }
 
-    stmtlist_t *stmt = m_statements;
+    const string *restore_name = 0;
+    if (!m_filename->empty())
+    {
+	restore_name = ee.internedFilename ();
+	ee.setFilename (m_filename);
+    }
+
+    if (! m_linked)
+    {
+	linkStatements ();
+    }
+
+    const unsigned int count = m_statementvector.size ();
+    unsigned int index = 0;
     YCPValue value = YCPVoid ();
-    while (stmt)
+
+    if (! debugger_instance && YProgram::enabled ())
     {
-	YStatementPtr statement = stmt->stmt;
-	
+	// plain execution of the lowered statements, a value ends the
+	//  block like below
+	if (m_program == 0)
+	{
+	    buildProgram ();
+	}
+	value = m_program->run ();
+	index = value.isNull () ? count : 0;
+    }
+    else if (! debugger_instance)
+    {
+	// plain execution, no per statement debugger handling
+	for (; index < count; index++)
+	{
+	    YStatementPtr statement = m_statementvector[index];
 #if DO_DEBUG
-	y2debug ("%d: %s", statement->line (), statement->toString ().c_str ());
+	    y2debug ("%d: %s", statement->line (), statement->toString ().c_str ());
 #endif
-	ee.setStatement (statement);
-
-	if (m_debug && statement->kind() != ysFunction )
-	{
-	    Debugger::command_t command;
-	    std::list<std::string> args;
-	    if (debugger_instance->processInput (command, args) && command==Debugger::c_continue)
+	    ee.setStatement (statement);
+	    value = statement->evaluate ();
+	    if (!value.isNull())
 	    {
-		m_debug = false;
-		debugger_instance->setTracing (false);
+#if DO_DEBUG
+		y2debug ("Block exit (%s)", value->toString().c_str());
+#endif
+		break;
 	    }
-	    else if (command == Debugger::c_next)
+	}
+    }
+    else
+    {
+	for (; index < count; index++)
+	{
+	    YStatementPtr statement = m_statementvector[index];
+
+#if DO_DEBUG
+	    y2debug ("%d: %s", statement->line (), statement->toString ().c_str ());
+#endif
+	    ee.setStatement (statement);
+
+	    if (m_debug && statement->kind() != ysFunction )
 	    {
-		debugger_instance->setTracing (false);
+		Debugger::command_t command;
+		std::list<std::string> args;
+		if (debugger_instance->processInput (command, args) && command==Debugger::c_continue)
+		{
+		    m_debug = false;
+		    debugger_instance->setTracing (false);
+		}
+		else if (command == Debugger::c_next)
+		{
+		    debugger_instance->setTracing (false);
+		}
 	    }
-	}
 
-	value = statement->evaluate ();
-	
-	// If we get continue from inner evaluation, we have to respect it
-        if (debugger_instance)
-        {
-    	    if (m_debug)
-    	    {
+	    value = statement->evaluate ();
+
+	    // If we get continue from inner evaluation, we have to respect it
+	    if (m_debug)
+	    {
 		m_debug = debugger_instance->lastCommand() != Debugger::c_continue;
 		debugger_instance->setTracing (m_debug);
 	    }
 	    else
 		m_debug = debugger_instance->tracing ();
-	}
 
-	if (!value.isNull())
-	{
+	    if (!value.isNull())
+	    {
 #if DO_DEBUG
-	    y2debug ("Block exit (%s)", value->toString().c_str());
+		y2debug ("Block exit (%s)", value->toString().c_str());
 #endif
-	    break;
+		break;
+	    }
 	}
-
-	stmt = stmt->next;
     }
-    if (!restore_name.empty())
+
+    if (restore_name != 0 && !restore_name->empty())
     {
 	ee.setFilename (restore_name);
     }
     
-    m_running = old_m_running;
-    
-    // recursion handling - not used for modules
-    if (! isModule () && m_running)
+    // the values of the outermost evaluation stay in the entries,
+    //  like those of a module
+    if (framed)
     {
-	popFromStack ();
+	popFrame (true);
     }
     
     if (debugger_instance)
 	debugger_instance->popBlock ();
 
 #if DO_DEBUG
-    y2debug ("YBlock::evaluate done (stmt %p, kind %d, value '%s')\n", stmt, m_kind, value.isNull() ? "NULL" : value->toString().c_str());
+    y2debug ("YBlock::evaluate done (stmt %d, kind %d, value '%s')\n", index, m_kind, value.isNull() ? "NULL" : value->toString().c_str());
 #endif
 
-    // if stmt==0 we're at the end of the block. If the block is evaluated as a statement,
+    // if index==count we're at the end of the block. If the block is evaluated as a statement,
     //   it returns NULL, else it returns Void
-    if (stmt == 0)
+    if (index == count)
     {
 	if (m_kind == b_statement)
 	{
@@ -684,7 +836,7 @@ YBlock::evaluate (bool cse)
 	return YCPVoid();
     }
 
-    // if stmt!=0 we just evaluated a break or return statement. A 'return;' evaluates to YCPReturn
+    // if index!=count we just evaluated a break or return statement. A 'return;' evaluates to YCPReturn
     return value;
 }
 
@@ -696,36 +848,44 @@ YBlock::evaluateFrom (int statement_index)
     y2debug ("YBlock::evaluate from statement([%d]%s)\n", (int)m_kind, toString().c_str());
 #endif
 
-    // recursion handling - not used for modules
-    if (m_running)
+    // the local variables live in a frame, one per evaluation - not
+    //  used for modules, their variables are global
+    bool framed = ! isModule ();
+    if (framed)
     {
-	pushToStack ();
+	pushFrame ();
     }
-    
-    bool old_m_running = m_running;
-    m_running = true;
 
-    string restore_name;
-    if (!filename().empty())
+    if (m_filename == 0)
     {
-	restore_name = ee.filename ();
-	ee.setFilename (filename());
+	m_filename = ExecutionEnvironment::intern (filename ());
+    }
+
+    const string *restore_name = 0;
+    if (!m_filename->empty())
+    {
+	restore_name = ee.internedFilename ();
+	ee.setFilename (m_filename);
+    }
+
+    if (! m_linked)
+    {
+	linkStatements ();
     }
 
-    stmtlist_t *stmt = m_statements;
-    YCPValue value = YCPVoid ();
-    
     // skip statements until index
-    while (stmt && statement_index > 0)
+    const unsigned int count = m_statementvector.size ();
+    unsigned int index = statement_index > 0 ? statement_index : 0;
+    if (index > count)
     {
-	stmt = stmt->next;
-	statement_index--;
+	index = count;
     }
-    
+    YCPValue value = YCPVoid ();
+
     // execute the rest of statements
-    while (stmt)
+    for (; index < count; index++)
     {
-	YStatementPtr statement = stmt->stmt;
+	YStatementPtr statement = m_statementvector[index];
 	
 #if DO_DEBUG
 	y2debug ("%d: %s", statement->line (), statement->toString ().c_str ());
@@ -741,29 +901,26 @@ YBlock::evaluateFrom (int statement_index)
 #endif
 	    break;
 	}
-
-	stmt = stmt->next;
     }
-    if (!restore_name.empty())
+    if (restore_name != 0 && !restore_name->empty())
     {
 	ee.setFilename (restore_name);
     }
     
-    m_running = old_m_running;
-    
-    // recursion handling - not used for modules
-    if (! isModule () && m_running)
+    // the values of the outermost evaluation stay in the entries,
+    //  like those of a module
+    if (framed)
     {
-	popFromStack ();
+	popFrame (true);
     }
 
 #if DO_DEBUG
-    y2debug ("YBlock::evaluate done (stmt %p, kind %d, value '%s')\n", stmt, m_kind, value.isNull() ? "NULL" : value->toString().c_str());
+    y2debug ("YBlock::evaluate done (stmt %d, kind %d, value '%s')\n", index, m_kind, value.isNull() ? "NULL" : value->toString().c_str());
 #endif
 
-    // if stmt==0 we're at the end of the block. If the block is evaluated as a statement,
+    // if index==count we're at the end of the block. If the block is evaluated as a statement,
     //   it returns NULL, else it returns Void
-    if (stmt == 0)
+    if (index == count)
     {
 	if (m_kind == b_statement)
 	{
@@ -772,7 +929,7 @@ YBlock::evaluateFrom (int statement_index)
 	return YCPVoid();
     }
 
-    // if stmt!=0 we just evaluated a break or return statement. A 'return;' evaluates to YCPReturn
+    // if index!=count we just evaluated a break or return statement. A 'return;' evaluates to YCPReturn
     return value;
 }
 
@@ -844,10 +1001,12 @@ YBlock::YBlock (bytecodeistream & str)
     , m_tenvironment (0)
     , m_last_tparm (0)
     , m_point (0)
+    , m_filename (0)
     , m_statements (0)
     , m_last_statement (0)
+    , m_linked (false)
+    , m_program (0)
     , m_includes (0)
-    , m_running (false)
 {
     Bytecode::readString (str, m_name);		// read name
 
@@ -855,65 +1014,81 @@ YBlock::YBlock (bytecodeistream & str)
 
     Bytecode::pushNamespace (nameSpace());
 
-    unsigned int scount = Bytecode::readInt32 (str);	// read Y2Namespace::m_symbols
-
-#if DO_DEBUG
-    y2debug("YBlock::fromStream (%p:\"%s\", %d entries, kind %d)", this, m_name.c_str(), scount, m_kind);
-#endif
-
-    // read all symbol entries belonging to this block
+    // the outermost block of a file in sections, see toStream
+    u_int32_t symbols = 0;
+    u_int32_t globals = 0;
+    if (str.hasSections ()
+	&& (m_kind == b_file || m_kind == b_module))
+    {
+	symbols = Bytecode::readInt32 (str);
+	globals = Bytecode::readInt32 (str);
+    }
 
-    if (scount > 0)
     {
-	for (unsigned int i = 0; i < scount; i++)
-	{
-	    SymbolEntryPtr sentry = new YSymbolEntry (str, nameSpace());
-	    addSymbol (sentry);
-	}
+	bytecodeistream::Section section (str, symbols);
+
+	unsigned int scount = Bytecode::readInt32 (str);	// read Y2Namespace::m_symbols
 
-	if (m_kind == b_module)			// if its a module, re-construct the table
-	{
-	    int tcount = Bytecode::readInt32 (str);
 #if DO_DEBUG
-	    y2debug ("Module with %d table entries", tcount);
+	y2debug("YBlock::fromStream (%p:\"%s\", %d entries, kind %d)", this, m_name.c_str(), scount, m_kind);
 #endif
 
-	    if (tcount > 0
-		&& m_table == 0)
+	// read all symbol entries belonging to this block
+
+	if (scount > 0)
+	{
+	    for (unsigned int i = 0; i < scount; i++)
 	    {
-		m_table = new SymbolTable (-1);
+		SymbolEntryPtr sentry = new YSymbolEntry (str, nameSpace());
+		addSymbol (sentry);
 	    }
 
-	    // HACK ahead: Y2ALLGLOBAL should make all
-	    // symbols visible. It works now, but as a trade-off,
-	    // line numbers are lost also for globals.
-	    while (tcount-- > 0)
+	    if (m_kind == b_module)			// if its a module, re-construct the table
 	    {
-		if (getenv("Y2ALLGLOBAL") != NULL)
+		bytecodeistream::Section section (str, globals);
+
+		int tcount = Bytecode::readInt32 (str);
+#if DO_DEBUG
+		y2debug ("Module with %d table entries", tcount);
+#endif
+
+		if (tcount > 0
+		    && m_table == 0)
 		{
-		    TableEntry t(str);				// FIXME: this object is temporary and unused
+		    m_table = new SymbolTable (-1);
 		}
-		else
+
+		// HACK ahead: Y2ALLGLOBAL should make all
+		// symbols visible. It works now, but as a trade-off,
+		// line numbers are lost also for globals.
+		while (tcount-- > 0)
 		{
-		    TableEntry *tentry = new TableEntry (str);
-		    attachEntry (tentry);
-		    m_table->enter (tentry);
+		    if (getenv("Y2ALLGLOBAL") != NULL)
+		    {
+			TableEntry t(str);				// FIXME: this object is temporary and unused
+		    }
+		    else
+		    {
+			TableEntry *tentry = new TableEntry (str);
+			attachEntry (tentry);
+			m_table->enter (tentry);
+		    }
 		}
-	    }
 
-	    if (getenv("Y2ALLGLOBAL") != NULL)
-	    {
-		delete m_table; // FIXME: memory leak
-		m_table = new SymbolTable(-1);
-		m_table->openXRefs ();
-		for (unsigned int i = 0 ; i < scount ; i++)
+		if (getenv("Y2ALLGLOBAL") != NULL)
 		{
-		    SymbolEntryPtr sentry = symbolEntry (i);
-		    if (!sentry->isModule()				// don't re-export imported modules
-			&& !sentry->isNamespace())			//   or predefined namespaces
+		    delete m_table; // FIXME: memory leak
+		    m_table = new SymbolTable(-1);
+		    m_table->openXRefs ();
+		    for (unsigned int i = 0 ; i < scount ; i++)
 		    {
-			TableEntry* tentry = m_table->enter(sentry->name (), sentry, 0);
-			attachEntry (tentry);
+			SymbolEntryPtr sentry = symbolEntry (i);
+			if (!sentry->isModule()				// don't re-export imported modules
+			    && !sentry->isNamespace())			//   or predefined namespaces
+			{
+			    TableEntry* tentry = m_table->enter(sentry->name (), sentry, 0);
+			    attachEntry (tentry);
+			}
 		    }
 		}
 	    }
@@ -986,17 +1161,25 @@ YBlock::toStream (std::ostream & str) const
     Bytecode::writeString (str, m_name);			// write name
     Bytecode::writeInt32 (str, m_kind);				// write kind
 
+    // the outermost block of a file has its symbols and global
+    // declarations in sections of their own
+    bool sectioned = Bytecode::writingSections ()
+	&& (m_kind == b_file || m_kind == b_module);
+    std::ostringstream symbols, globals;
+    std::ostream & sstr = sectioned ? symbols : str;
+    std::ostream & gstr = sectioned ? globals : str;
+
 #if DO_DEBUG
     y2debug ("YBlock %p: %d symbol entries", this, symbolCount());
 #endif
-    Bytecode::writeInt32 (str, symbolCount());			// write Y2Namespace::m_symbols
+    Bytecode::writeInt32 (sstr, symbolCount());			// write Y2Namespace::m_symbols
 
     if (symbolCount() > 0)
     {
 	for (unsigned int i = 0; i < symbolCount(); i++)
 	{
 	    YSymbolEntryPtr entry = (YSymbolEntryPtr)symbolEntry (i);
-	    entry->toStream (str);				// write SymbolEntry
+	    entry->toStream (sstr);				// write SymbolEntry
 	}
 
 	// if its a module, write the table
@@ -1014,17 +1197,30 @@ YBlock::toStream (std::ostream & str) const
 	    y2debug ("Module with %d table entries", tcount);
 #endif
 
-	    Bytecode::writeInt32 (str, tcount);
+	    Bytecode::writeInt32 (gstr, tcount);
 
 	    tptr = m_tenvironment;
 	    while (tptr)
 	    {
-		tptr->tentry->toStream (str);			// write the table entries
+		tptr->tentry->toStream (gstr);			// write the table entries
 		tptr = tptr->next;
 	    }
 	}
     }
 
+    if (sectioned)
+    {
+	Bytecode::writeSection (str, Bytecode::sSymbols, symbols.str ());
+	if (globals.str ().empty ())
+	{
+	    Bytecode::writeInt32 (str, 0);
+	}
+	else
+	{
+	    Bytecode::writeSection (str, Bytecode::sGlobals, globals.str ());
+	}
+    }
+
     m_point->toStream (str);
 
     u_int32_t count = statementCount();				// count statements
@@ -96,6 +96,12 @@ YCPBoolean::YCPBoolean (bool v)
 {
 }
 
+YCPBoolean::YCPBoolean (const char *r)
+    : YCPValue (YCPBoolean (strcmp (r, "true") == 0))
+{
+}
+
+
 YCPBoolean::YCPBoolean (bytecodeistream & str)
     : YCPValue (*(
 	Bytecode::readBool (str) ? 
@@ -120,9 +120,9 @@ YCPBuiltinBoolean::YCPBuiltinBoolean ()
 {
     // must be static, registerDeclarations saves a pointer to it!
     static declaration_t declarations[] = {
-	{ "!",  "boolean (boolean)",          (void *)b_lnot,   0,           0, 0, 0 },
-	{ "||", "boolean (boolean, boolean)", (void *)b_or, 	DECL_NOEVAL, 0, 0, 0 },
-	{ "&&", "boolean (boolean, boolean)", (void *)b_and, 	DECL_NOEVAL, 0, 0, 0 },
+	{ "!",  "boolean (boolean)",          (void *)b_lnot,   DECL_PURE,   0, 0, 0 },
+	{ "||", "boolean (boolean, boolean)", (void *)b_or, 	DECL_NOEVAL|DECL_PURE, 0, 0, 0 },
+	{ "&&", "boolean (boolean, boolean)", (void *)b_and, 	DECL_NOEVAL|DECL_PURE, 0, 0, 0 },
 	{ 0,    0,                            0,                0,           0, 0, 0 },
     };
 
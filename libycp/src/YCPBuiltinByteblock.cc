@@ -81,8 +81,8 @@ YCPBuiltinByteblock::YCPBuiltinByteblock ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "tobyteblock","byteblock (const any)", 	(void *)b_tobyteblock, ETC },
-	{ "size",   "integer (const byteblock)",	(void *)b_size,        ETC },
+	{ "tobyteblock","byteblock (const any)", 	(void *)b_tobyteblock, DECL_PURE, ETCf },
+	{ "size",   "integer (const byteblock)",	(void *)b_size,        DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
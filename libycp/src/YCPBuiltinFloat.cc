@@ -340,25 +340,25 @@ YCPBuiltinFloat::YCPBuiltinFloat ()
 
     // must be static, registerDeclarations saves a pointer to it!
     static declaration_t declarations[] = {
-	{ "+",	     "float (float, float)",	(void *)f_plus,     ETC },
-	{ "-",	     "float (float, float)",	(void *)f_minus,    ETC },
-	{ "-",	     "float (float)",		(void *)f_neg,      ETC },
-	{ "*",	     "float (float, float)",	(void *)f_mult,     ETC },
-	{ "/",	     "float (float, float)",	(void *)f_div,      ETC },
-	{ "tofloat", "float (const any)",	(void *)f_tofloat,  ETC },
-	{ "tostring","string (float, integer)",	(void *)f_tostring, ETC },
+	{ "+",	     "float (float, float)",	(void *)f_plus,     DECL_PURE, ETCf },
+	{ "-",	     "float (float, float)",	(void *)f_minus,    DECL_PURE, ETCf },
+	{ "-",	     "float (float)",		(void *)f_neg,      DECL_PURE, ETCf },
+	{ "*",	     "float (float, float)",	(void *)f_mult,     DECL_PURE, ETCf },
+	{ "/",	     "float (float, float)",	(void *)f_div,      DECL_PURE, ETCf },
+	{ "tofloat", "float (const any)",	(void *)f_tofloat,  DECL_PURE, ETCf },
+	{ "tostring","string (float, integer)",	(void *)f_tostring, DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
     };
 
     // must be static, registerDeclarations saves a pointer to it!
     static declaration_t declarations_ns[] = {
 	{ "float",   "",			NULL,    DECL_NAMESPACE, ETCf },
-	{ "abs",     "float (float)",		(void *)f_abs,       ETC },
-	{ "floor",   "float (float)",		(void *)f_floor,     ETC },
-	{ "ceil",    "float (float)",		(void *)f_ceil,      ETC },
-	{ "trunc",   "float (float)",		(void *)f_trunc,     ETC },
-	{ "pow",     "float (float, float)",	(void *)f_pow,       ETC },
-	{ "tolstring","string (float, integer)",(void *)f_tolstring, ETC },
+	{ "abs",     "float (float)",		(void *)f_abs,       DECL_PURE, ETCf },
+	{ "floor",   "float (float)",		(void *)f_floor,     DECL_PURE, ETCf },
+	{ "ceil",    "float (float)",		(void *)f_ceil,      DECL_PURE, ETCf },
+	{ "trunc",   "float (float)",		(void *)f_trunc,     DECL_PURE, ETCf },
+	{ "pow",     "float (float, float)",	(void *)f_pow,       DECL_PURE, ETCf },
+	{ "tolstring","string (float, integer)",(void *)f_tolstring, DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
     };
 
@@ -356,20 +356,20 @@ YCPBuiltinInteger::YCPBuiltinInteger ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "+",  "integer (integer, integer)",	(void *)i_plus,     ETC },
-	{ "-",  "integer (integer, integer)",	(void *)i_minus,    ETC },
-	{ "-",  "integer (integer)",		(void *)i_neg,	    ETC },
-	{ "*",  "integer (integer, integer)",	(void *)i_mult,	    ETC },
-	{ "/",  "integer (integer, integer)",	(void *)i_div,	    ETC },
-	{ "%",  "integer (integer, integer)",	(void *)i_mod,	    ETC },
-	{ "&",  "integer (integer, integer)",	(void *)i_and,	    ETC },
-	{ "^",  "integer (integer, integer)",	(void *)i_xor,      ETC },
-	{ "|",  "integer (integer, integer)",	(void *)i_or,	    ETC },
-	{ "<<", "integer (integer, integer)",	(void *)i_left,	    ETC },
-	{ ">>", "integer (integer, integer)",	(void *)i_right,    ETC },
-	{ "~",  "integer (integer)",		(void *)i_bnot,	    ETC },
-	{ "tointeger", "integer (const any)",		(void *)i_tointeger1, ETC },
-	{ "tointeger", "integer (string, integer)",	(void *)i_tointeger2, ETC },
+	{ "+",  "integer (integer, integer)",	(void *)i_plus,     DECL_PURE, ETCf },
+	{ "-",  "integer (integer, integer)",	(void *)i_minus,    DECL_PURE, ETCf },
+	{ "-",  "integer (integer)",		(void *)i_neg,	    DECL_PURE, ETCf },
+	{ "*",  "integer (integer, integer)",	(void *)i_mult,	    DECL_PURE, ETCf },
+	{ "/",  "integer (integer, integer)",	(void *)i_div,	    DECL_PURE, ETCf },
+	{ "%",  "integer (integer, integer)",	(void *)i_mod,	    DECL_PURE, ETCf },
+	{ "&",  "integer (integer, integer)",	(void *)i_and,	    DECL_PURE, ETCf },
+	{ "^",  "integer (integer, integer)",	(void *)i_xor,      DECL_PURE, ETCf },
+	{ "|",  "integer (integer, integer)",	(void *)i_or,	    DECL_PURE, ETCf },
+	{ "<<", "integer (integer, integer)",	(void *)i_left,	    DECL_PURE, ETCf },
+	{ ">>", "integer (integer, integer)",	(void *)i_right,    DECL_PURE, ETCf },
+	{ "~",  "integer (integer)",		(void *)i_bnot,	    DECL_PURE, ETCf },
+	{ "tointeger", "integer (const any)",		(void *)i_tointeger1, DECL_PURE, ETCf },
+	{ "tointeger", "integer (string, integer)",	(void *)i_tointeger2, DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
@@ -19,13 +19,11 @@
 
 /-*/
 
-#include <set>			// for toset
 #include <algorithm>		// sort
 
-using std::set;
-
 #include "ycp/YCPBuiltinList.h"
 #include "ycp/YCPList.h"
+#include "ycp/ycpless.h"
 #include "ycp/YCPMap.h"
 #include "ycp/YCPSymbol.h"
 #include "ycp/YCPString.h"
@@ -34,10 +32,12 @@ using std::set;
 #include "ycp/YCPVoid.h"
 #include "ycp/YCPCode.h"
 #include "ycp/YCPCodeCompare.h"
+#include "ycp/YCPParallel.h"
 #include "ycp/YCPTerm.h"
 #include "ycp/StaticDeclaration.h"
 
 #include "ycp/y2log.h"
+#include "ycp/y2string.h"
 
 extern StaticDeclaration static_declarations;
 
@@ -187,8 +187,6 @@ l_unionlist (const YCPList &list1, const YCPList &list2)
      * preserved. Elements of <tt>l1</tt> are prior to elements from <tt>l2</tt>.
      * <tt>nil</tt> as either argument makes the result <tt>nil</tt> too.
      *
-     * WARNING: quadratic complexity so far
-     *
      * @see merge
      * @usage union ([1, 2], [3, 4]) -> [1, 2, 3, 4]
      * @usage union ([1, 2, 3], [2, 3, 4]) -> [1, 2, 3, 4]
@@ -200,24 +198,22 @@ l_unionlist (const YCPList &list1, const YCPList &list2)
 	return YCPNull ();
     }
 
-    YCPList newlist;
+    YCPValueHashSet seen;
+    vector<YCPValue> values;
 
     for (int l = 0; l < 2; l++)
     {
-	YCPList list = (l == 0 ? list1 : list2);
+	const YCPList & list = (l == 0 ? list1 : list2);
 
-	for (int e = 0; e < list->size (); e++)
+	for (YCPList::const_iterator it = list->begin (); it != list->end (); ++it)
 	{
-	    YCPValue to_insert = list->value (e);
-
-	    // Already contained? I know, this has an _awful_ complexity.
-	    // We need to introduce an order on YCPValueRep to solve the problem.
-
-	    if (!newlist->contains(to_insert))
-		newlist->add (to_insert);
+	    if (seen.insert (*it).second)	// not contained yet
+		values.push_back (*it);
 	}
     }
 
+    YCPList newlist;
+    newlist->addAll (values);
     return newlist;
 }
 
@@ -388,11 +384,22 @@ l_filter (const YCPSymbol &symbol, const YCPList &list, const YCPCode &expr)
 
     SymbolEntryPtr s = symbol->asEntry()->entry();
 
-    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it)
-    {
-	s->setValue(*it);
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, list, s, results);
 
-	YCPValue v = expr->evaluate ();
+    int i = 0;
+    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it, ++i)
+    {
+	YCPValue v = YCPNull ();
+	if (parallel)
+	{
+	    v = results[i];
+	}
+	else
+	{
+	    s->setValue(*it);
+	    v = expr->evaluate ();
+	}
 
 	if (v.isNull ())
 	{
@@ -448,11 +455,22 @@ l_maplist (const YCPSymbol &symbol, const YCPList &list, const YCPCode &expr)
     YCPList ret;
     SymbolEntryPtr s = symbol->asEntry()->entry();
 
-    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it)
-    {
-	s->setValue(*it);
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, list, s, results);
 
-	YCPValue v = expr->evaluate ();
+    int i = 0;
+    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it, ++i)
+    {
+	YCPValue v = YCPNull ();
+	if (parallel)
+	{
+	    v = results[i];
+	}
+	else
+	{
+	    s->setValue(*it);
+	    v = expr->evaluate ();
+	}
 
 	if (v.isNull ())
 	{
@@ -505,11 +523,22 @@ l_listmap (const YCPSymbol &symbol, const YCPList &list, const YCPCode &expr)
     YCPList curr_list;
     YCPMap curr_map;
 
-    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it)
-    {
-	key->setValue(*it);
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, list, key, results);
 
-	YCPValue curr_value = expr->evaluate ();
+    int i = 0;
+    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it, ++i)
+    {
+	YCPValue curr_value = YCPNull ();
+	if (parallel)
+	{
+	    curr_value = results[i];
+	}
+	else
+	{
+	    key->setValue(*it);
+	    curr_value = expr->evaluate ();
+	}
 
 	if (curr_value.isNull ())
 	{
@@ -605,14 +634,19 @@ l_toset (const YCPList &list)
      * @usage toset ([1, 5, 3, 2, 3, true, false, true]) -> [false, true, 1, 2, 3, 5]
      */
 
-    set<YCPValue, ycp_less> newset(list->begin(), list->end());
-
-    YCPList setlist;
-    for (set <YCPValue, ycp_less>::const_iterator it = newset.begin ();
-	 it != newset.end (); ++it)
+    // remove the duplicates by hashing, only the distinct values are sorted
+    YCPValueHashSet seen;
+    vector<YCPValue> values;
+    for (YCPList::const_iterator it = list->begin (); it != list->end (); ++it)
     {
-	setlist->add (*it);
+	if (seen.insert (*it).second)
+	    values.push_back (*it);
     }
+
+    std::sort (values.begin (), values.end (), ycp_less ());
+
+    YCPList setlist;
+    setlist->addAll (values);
     return setlist;
 }
 
@@ -690,6 +724,102 @@ l_sort (const YCPValue &sym1, const YCPValue &sym2,
 }
 
 
+// an element of sortby with its key, ordered by the keys
+struct SortByEntry
+{
+    YCPValue key;
+    YCPValue value;
+};
+
+
+struct SortByLess
+{
+    bool operator() (const SortByEntry *a, const SortByEntry *b) const
+    {
+	return ycp_less () (a->key, b->key);
+    }
+};
+
+
+static YCPValue
+l_sortby (const YCPSymbol &symbol, const YCPList &list, const YCPCode &expr)
+{
+    /**
+     * @builtin sortby
+     * @short Sort list by a key computed for every element
+     * @param any VAR
+     * @param list LIST
+     * @param block KEY
+     * @return list
+     * @description
+     *
+     * Sorts the list <tt>LIST</tt> by keys. For each element the
+     * expression <tt>KEY</tt> is evaluated once, with the variable
+     * <tt>VAR</tt> assigned to the element, and the elements are
+     * ordered by these keys according to the YCP builtin predicate
+     * (like <tt>sort (LIST)</tt> orders values). Elements with equal
+     * keys keep their order.
+     *
+     * This is much faster than <tt>sort (x, y, LIST, EXPR)</tt>, which
+     * evaluates <tt>EXPR</tt> for every comparison, i.e. about
+     * n*log(n) times.
+     *
+     * @see sort
+     * @usage sortby (map p, [$["n":"b"], $["n":"a"]], ``(p["n"]:"")) -> [$["n":"a"], $["n":"b"]]
+     * @usage sortby (integer i, [3, -4, 1], ``(i * i)) -> [1, 3, -4]
+     */
+
+    if (list.isNull ())
+    {
+	return YCPNull ();
+    }
+
+    SymbolEntryPtr s = symbol->asEntry()->entry();
+
+    vector<SortByEntry> entries (list->size ());
+    vector<SortByEntry *> order (list->size ());
+
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, list, s, results);
+
+    int i = 0;
+    for (YCPList::const_iterator it = list->begin(); it != list->end(); ++it, ++i)
+    {
+	YCPValue key = YCPNull ();
+	if (parallel)
+	{
+	    key = results[i];
+	}
+	else
+	{
+	    s->setValue(*it);
+	    key = expr->evaluate ();
+	}
+
+	if (key.isNull ())
+	{
+	    ycp2error ("Bad sortby expression %s", expr->toString ().c_str ());
+	    return YCPNull ();
+	}
+
+	entries[i].key = key;
+	entries[i].value = *it;
+	order[i] = &entries[i];
+    }
+
+    std::stable_sort (order.begin (), order.end (), SortByLess ());
+
+    vector<YCPValue> values;
+    values.reserve (order.size ());
+    for (size_t j = 0; j < order.size (); j++)
+	values.push_back (order[j]->value);
+
+    YCPList ret;
+    ret->addAll (values);
+    return ret;
+}
+
+
 static YCPValue
 l_lsortlist (const YCPList &list)
 {
@@ -757,39 +887,45 @@ l_splitstring (const YCPString &s, const YCPString &c)
 
     YCPList ret;
 
-    string ss = s->value ();
-    string sc = c->value ();
+    const string & ss = s->value ();
+    const string & sc = c->value ();
 
     if (ss.empty () || sc.empty ())
 	return ret;
 
+    ByteSet delimiters (sc);
+
+    // collect the pieces first and hand them to the list at once,
+    // a large list is then built directly instead of value by value
+    vector<YCPValue> pieces;
+
     string::size_type spos = 0;			// start pos
     string::size_type epos = 0;			// end pos
 
     while (true)
     {
-	epos = ss.find_first_of (sc, spos);
+	epos = delimiters.findFirstOf (ss, spos);
 
 	if (epos == string::npos)	// break if not found
 	{
-	    ret->add (YCPString (string (ss, spos)));
+	    pieces.push_back (YCPString (string (ss, spos)));
 	    break;
 	}
 
-	if (spos == epos)
-	    ret->add (YCPString (""));
-	else
-	    ret->add (YCPString (string (ss, spos, epos - spos)));	// string piece w/o delimiter
+	// string piece w/o delimiter ("" if spos == epos)
+	pieces.push_back (YCPString (string (ss, spos, epos - spos)));
 
 	spos = epos + 1;	// skip c in s
 
 	if (spos == ss.size ())	// c was last char
 	{
-	    ret->add (YCPString (""));	// add "" and break
+	    pieces.push_back (YCPString (""));	// add "" and break
 	    break;
 	}
     }
 
+    ret->addAll (pieces);
+
     return ret;
 }
 
@@ -1253,33 +1389,34 @@ YCPBuiltinList::YCPBuiltinList ()
     // must be static, registerDeclarations saves a pointer to it!
     static declaration_t declarations[] = {
 	{ "find",	"flex (variable <flex>, const list <flex>, const block <boolean>)",			(void *)l_find,		DECL_SYMBOL|DECL_FLEX,                  ETCf },
-	{ "prepend",	"list <flex> (const list <flex>, const flex)",						(void *)l_prepend,	DECL_FLEX,				ETCf },
-	{ "contains",	"boolean (const list <flex>, const flex)",						(void *)l_contains,	DECL_FLEX,				ETCf },
-	{ "setcontains","boolean (const list <flex>, const flex)",						(void *)l_setcontains,	DECL_FLEX,				ETCf },
-	{ "union",	"list <any> (const list <any>, const list <any>)",					(void *)l_unionlist,						 ETC },
-	{ "+",		"list <flex> (const list <flex>, const list <flex>)",					(void *)l_unionlist,	DECL_FLEX,				ETCf },
-	{ "merge",	"list <any> (const list <any>, const list <any>)",					(void *)l_mergelist,						 ETC },
-	{ "sublist",	"list <flex> (const list <flex>, integer)",						(void *)l_sublist1,     DECL_FLEX,                              ETCf },
-	{ "sublist",	"list <flex> (const list <flex>, integer, integer)",					(void *)l_sublist2,     DECL_FLEX,				ETCf },
+	{ "prepend",	"list <flex> (const list <flex>, const flex)",						(void *)l_prepend,	DECL_FLEX|DECL_PREPEND|DECL_PURE,			ETCf },
+	{ "contains",	"boolean (const list <flex>, const flex)",						(void *)l_contains,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "setcontains","boolean (const list <flex>, const flex)",						(void *)l_setcontains,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "union",	"list <any> (const list <any>, const list <any>)",					(void *)l_unionlist,						 DECL_PURE, ETCf },
+	{ "+",		"list <flex> (const list <flex>, const list <flex>)",					(void *)l_unionlist,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "merge",	"list <any> (const list <any>, const list <any>)",					(void *)l_mergelist,						 DECL_PURE, ETCf },
+	{ "sublist",	"list <flex> (const list <flex>, integer)",						(void *)l_sublist1,     DECL_FLEX|DECL_PURE,                              ETCf },
+	{ "sublist",	"list <flex> (const list <flex>, integer, integer)",					(void *)l_sublist2,     DECL_FLEX|DECL_PURE,				ETCf },
 	{ "filter",	"list <flex> (variable <flex>, const list <flex>, const block <boolean>)",		(void *)l_filter,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX,	ETCf },
 	{ "maplist",	"list <flex1> (variable <flex2>, const list <flex2>, const block <flex1>)",		(void *)l_maplist,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX,	ETCf },
 	{ "listmap",	"map <flex1,flex2> (variable <flex3>, const list <flex3>, const block <map <flex1,flex2>>)",	(void *)l_listmap,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX,ETCf },
-	{ "flatten",	"list <flex> (const list <list <flex>>)",						(void *)l_flatten,	DECL_FLEX,				ETCf },
-	{ "toset",	"list <flex> (const list <flex>)",							(void *)l_toset,	DECL_FLEX,				ETCf },
-	{ "sort",	"list <flex> (const list <flex>)",							(void *)l_sortlist,	DECL_FLEX,                              ETCf },
+	{ "flatten",	"list <flex> (const list <list <flex>>)",						(void *)l_flatten,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "toset",	"list <flex> (const list <flex>)",							(void *)l_toset,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "sort",	"list <flex> (const list <flex>)",							(void *)l_sortlist,	DECL_FLEX|DECL_PURE,                              ETCf },
 	{ "sort",	"list <flex> (variable <flex>, variable <flex>, const list <flex>, const block <boolean>)", (void *)l_sort, 	DECL_SYMBOL|DECL_FLEX,			ETCf },
-	{ "lsort",	"list <flex> (const list <flex>)",							(void *)l_lsortlist,	DECL_FLEX,				ETCf },
-	{ "splitstring","list <string> (string, string)",							(void *)l_splitstring,						 ETC },
-	{ "change", 	"list <flex> (const list <flex>, const flex)",						(void *)l_changelist,	DECL_FLEX|DECL_DEPRECATED,		ETCf },
-	{ "add",	"list <flex> (const list <flex>, const flex)",						(void *)l_add,		DECL_FLEX|DECL_NIL,			ETCf },
-	{ "+",		"list <flex> (const list <flex>, const flex)",						(void *)l_add,		DECL_FLEX,				ETCf },
-	{ "+",		"list <any> (const list <any>, any)",							(void *)l_add,                                                   ETC },
-	{ "isempty",	"boolean (const list <any>)",								(void *)l_isempty,						 ETC },
-	{ "size",	"integer (const list <any>)",								(void *)l_size,		DECL_NIL,				ETCf },
-	{ "remove",	"list <flex> (const list <flex>, const integer)",					(void *)l_remove,	DECL_FLEX,				ETCf },
-	{ "select",	"flex (const list <flex>, integer, flex)",						(void *)l_select,	DECL_NIL|DECL_FLEX,			ETCf },
+	{ "sortby",	"list <flex> (variable <flex>, const list <flex>, const block <any>)",			(void *)l_sortby,	DECL_SYMBOL|DECL_FLEX,			ETCf },
+	{ "lsort",	"list <flex> (const list <flex>)",							(void *)l_lsortlist,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "splitstring","list <string> (string, string)",							(void *)l_splitstring,						 DECL_PURE, ETCf },
+	{ "change", 	"list <flex> (const list <flex>, const flex)",						(void *)l_changelist,	DECL_FLEX|DECL_DEPRECATED|DECL_PURE,		ETCf },
+	{ "add",	"list <flex> (const list <flex>, const flex)",						(void *)l_add,		DECL_FLEX|DECL_NIL|DECL_APPEND|DECL_PURE,		ETCf },
+	{ "+",		"list <flex> (const list <flex>, const flex)",						(void *)l_add,		DECL_FLEX|DECL_APPEND|DECL_PURE,			ETCf },
+	{ "+",		"list <any> (const list <any>, any)",							(void *)l_add,		DECL_APPEND|DECL_PURE,				ETCf },
+	{ "isempty",	"boolean (const list <any>)",								(void *)l_isempty,						 DECL_PURE, ETCf },
+	{ "size",	"integer (const list <any>)",								(void *)l_size,		DECL_NIL|DECL_PURE,				ETCf },
+	{ "remove",	"list <flex> (const list <flex>, const integer)",					(void *)l_remove,	DECL_FLEX|DECL_PURE,				ETCf },
+	{ "select",	"flex (const list <flex>, integer, flex)",						(void *)l_select,	DECL_NIL|DECL_FLEX|DECL_PURE,			ETCf },
 	{ "foreach",    "flex1 (variable <flex2>, const list <flex2>, const block <flex1>)",			(void *)l_foreach,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX,	ETCf },
-	{ "tolist",	"list <any> (const any)",								(void *)l_tolist,	DECL_DEPRECATED,			ETCf },
+	{ "tolist",	"list <any> (const any)",								(void *)l_tolist,	DECL_DEPRECATED|DECL_PURE,			ETCf },
 	{ NULL, NULL, NULL, ETC }
     };
 
@@ -1288,7 +1425,7 @@ YCPBuiltinList::YCPBuiltinList ()
 	{ "list",	"",											NULL,	                DECL_NAMESPACE, ETCf },
 	{ "reduce",	"flex1 (variable <flex1>, variable <flex1>, const list <flex1>, const block <flex1>)",  (void *)l_reduce1, DECL_LOOP|DECL_SYMBOL|DECL_FLEX, ETCf },
 	{ "reduce",	"flex1 (variable <flex1>, variable <flex2>, const flex1, const list <flex2>, const block <flex1>)", (void *)l_reduce2, DECL_LOOP|DECL_SYMBOL|DECL_FLEX, ETCf },
-	{ "swap",	"list <flex> (const list <flex>, const integer, const integer)",			(void *)l_swaplist,	DECL_FLEX, ETCf },
+	{ "swap",	"list <flex> (const list <flex>, const integer, const integer)",			(void *)l_swaplist,	DECL_FLEX|DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
     };
 
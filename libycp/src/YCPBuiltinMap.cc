@@ -25,6 +25,7 @@
 #include "ycp/YCPBoolean.h"
 #include "ycp/YCPInteger.h"
 #include "ycp/YCPCode.h"
+#include "ycp/YCPParallel.h"
 #include "ycp/YCPVoid.h"
 #include "ycp/StaticDeclaration.h"
 
@@ -95,29 +96,40 @@ m_filter (const YCPSymbol &key, const YCPSymbol &value,
     SymbolEntryPtr k = key->asEntry()->entry();
     SymbolEntryPtr v = value->asEntry()->entry();
 
-    for (YCPMap::const_iterator pos = map->begin(); pos != map->end(); ++pos)
-    {
-	k->setValue (pos->first);
-	v->setValue (pos->second);
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, map, k, v, results);
 
-	YCPValue v = expr->evaluate ();
+    int i = 0;
+    for (YCPMap::const_iterator pos = map->begin(); pos != map->end(); ++pos, ++i)
+    {
+	YCPValue curr_value = YCPNull ();
+	if (parallel)
+	{
+	    curr_value = results[i];
+	}
+	else
+	{
+	    k->setValue (pos->first);
+	    v->setValue (pos->second);
+	    curr_value = expr->evaluate ();
+	}
 
-	if (v.isNull ())
+	if (curr_value.isNull ())
 	{
 	    ycp2error ("Bad filter expression %s", expr->toString ().c_str ());
 	    return YCPNull ();
 	}
         // nil == false
-        if (v->isVoid ())
+        if (curr_value->isVoid ())
         {
             ycp2error ("The expression for 'filter' returned 'nil'");
             continue;
         }
-	if (v->isBreak())
+	if (curr_value->isBreak())
 	{
 	    break;
 	}
-	if (v->asBoolean ()->value ())
+	if (curr_value->asBoolean ()->value ())
 	{
 	    ret->add(pos->first, pos->second);
 	}
@@ -164,12 +176,23 @@ m_mapmap (const YCPSymbol &key, const YCPSymbol &value,
     SymbolEntryPtr k = key->asEntry()->entry();
     SymbolEntryPtr v = value->asEntry()->entry();
 
-    for (YCPMap::const_iterator pos = map->begin (); pos != map->end (); ++pos)
-    {
-	k->setValue (pos->first);
-	v->setValue (pos->second);
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, map, k, v, results);
 
-	YCPValue curr_value = expr->evaluate ();
+    int i = 0;
+    for (YCPMap::const_iterator pos = map->begin (); pos != map->end (); ++pos, ++i)
+    {
+	YCPValue curr_value = YCPNull ();
+	if (parallel)
+	{
+	    curr_value = results[i];
+	}
+	else
+	{
+	    k->setValue (pos->first);
+	    v->setValue (pos->second);
+	    curr_value = expr->evaluate ();
+	}
 
 	if (!curr_value.isNull())
 	{
@@ -226,23 +249,34 @@ m_maplist (const YCPSymbol &key, const YCPSymbol &value,
     SymbolEntryPtr k = key->asEntry()->entry();
     SymbolEntryPtr v = value->asEntry()->entry();
 
-    for (YCPMap::const_iterator pos = map->begin(); pos != map->end(); ++pos)
-    {
-	k->setValue (pos->first);
-	v->setValue (pos->second);
+    vector<YCPValue> results;
+    bool parallel = YCPParallel::evaluate (expr, map, k, v, results);
 
-	YCPValue v = expr->evaluate();
+    int i = 0;
+    for (YCPMap::const_iterator pos = map->begin(); pos != map->end(); ++pos, ++i)
+    {
+	YCPValue curr_value = YCPNull ();
+	if (parallel)
+	{
+	    curr_value = results[i];
+	}
+	else
+	{
+	    k->setValue (pos->first);
+	    v->setValue (pos->second);
+	    curr_value = expr->evaluate();
+	}
 
-	if (v.isNull())
+	if (curr_value.isNull())
 	{
 	    ycp2error ("Bad maplist expression %s", expr->toString ().c_str ());
 	    return YCPNull ();
 	}
-	if (v->isBreak())
+	if (curr_value->isBreak())
 	{
 	    break;
 	}
-	ret->add (v);
+	ret->add (curr_value);
     }
 
     return ret;
@@ -273,16 +307,13 @@ m_unionmap (const YCPMap &map1, const YCPMap &map2)
     if (map1.isNull () || map2.isNull ())
 	return YCPNull ();
 
-    YCPMap newmap;
+    // start with (a shared copy of) map1, large maps then only copy
+    // the parts changed by map2
+    YCPMap newmap = map1;
 
-    for (int m = 0; m < 2; m++)
+    for (YCPMap::const_iterator pos = map2->begin(); pos != map2->end(); ++pos)
     {
-	YCPMap map = (m == 0 ? map1 : map2);
-
-	for (YCPMap::const_iterator pos = map->begin(); pos != map->end(); ++pos)
-	{
-	    newmap->add(pos->first, pos->second);
-	}
+	newmap->add(pos->first, pos->second);
     }
 
     return newmap;
@@ -561,19 +592,19 @@ YCPBuiltinMap::YCPBuiltinMap ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "haskey", "boolean (const map <any,any>, const any)",								    (void *)m_haskey,                                                     ETC },
+	{ "haskey", "boolean (const map <any,any>, const any)",								    (void *)m_haskey,                                                     DECL_PURE, ETCf },
 	{ "mapmap", "map <flex3,flex4> (variable <flex1>, variable <flex2>, const map <flex1,flex2>, const block <map <flex3, flex4>>)",  (void *)m_mapmap,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX, ETCf },
 	{ "maplist","list <flex3> (variable <flex1>, variable <flex2>, const map <flex1,flex2>, const block <flex3>)",	    (void *)m_maplist,  DECL_LOOP|DECL_SYMBOL|DECL_FLEX,		 ETCf },
 	{ "filter", "map <flex1,flex2> (variable <flex1>, variable <flex2>, const map <flex1,flex2>, const block <boolean>)",(void *)m_filter,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX,		 ETCf },
-	{ "union",  "map <any,any> (const map <any,any>, const map <any,any>)",						    (void *)m_unionmap,							  ETC },
-	{ "+",	    "map <any,any> (const map <any,any>, const map <any,any>)",						    (void *)m_unionmap,							  ETC },
-	{ "add",    "map <flex1,flex2> (const map <flex1,flex2>, const flex1, const flex2)",				    (void *)m_addmap,	DECL_FLEX,					 ETCf },
-	{ "change", "map <flex1,flex2> (const map <flex1,flex2>, const flex1, const flex2)",				    (void *)m_changemap,DECL_FLEX|DECL_DEPRECATED,                       ETCf },
-	{ "isempty", "boolean (const map <any,any>)",									    (void *)m_isempty,							  ETC },
-	{ "size",   "integer (const map <any,any>)",									    (void *)m_size,	DECL_NIL,					 ETCf },
+	{ "union",  "map <any,any> (const map <any,any>, const map <any,any>)",						    (void *)m_unionmap,							  DECL_PURE, ETCf },
+	{ "+",	    "map <any,any> (const map <any,any>, const map <any,any>)",						    (void *)m_unionmap,							  DECL_PURE, ETCf },
+	{ "add",    "map <flex1,flex2> (const map <flex1,flex2>, const flex1, const flex2)",				    (void *)m_addmap,	DECL_FLEX|DECL_PURE,					 ETCf },
+	{ "change", "map <flex1,flex2> (const map <flex1,flex2>, const flex1, const flex2)",				    (void *)m_changemap,DECL_FLEX|DECL_DEPRECATED|DECL_PURE,                       ETCf },
+	{ "isempty", "boolean (const map <any,any>)",									    (void *)m_isempty,							  DECL_PURE, ETCf },
+	{ "size",   "integer (const map <any,any>)",									    (void *)m_size,	DECL_NIL|DECL_PURE,					 ETCf },
 	{ "foreach","flex1 (variable <flex2>, variable <flex3>, const map <flex2,flex3>, const block <flex1>)",		    (void *)m_foreach,	DECL_LOOP|DECL_SYMBOL|DECL_FLEX,		 ETCf },
-	{ "tomap",  "map <any,any> (const any)",									    (void *)m_tomap,	DECL_FLEX,					 ETCf },
-        { "remove", "map <flex1,flex2> (const map <flex1,flex2>, const flex1)", 					    (void *)m_remove,	DECL_FLEX,					 ETCf },
+	{ "tomap",  "map <any,any> (const any)",									    (void *)m_tomap,	DECL_FLEX|DECL_PURE,					 ETCf },
+        { "remove", "map <flex1,flex2> (const map <flex1,flex2>, const flex1)", 					    (void *)m_remove,	DECL_FLEX|DECL_PURE,					 ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
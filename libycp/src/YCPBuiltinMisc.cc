@@ -689,7 +689,7 @@ YCPBuiltinMisc::YCPBuiltinMisc ()
 	{ "srandom",	"void (integer)",		(void *)Srandom2,   ETC },
 	{ "eval",	"flex (block <flex>)",		(void *)Eval,		DECL_NIL|DECL_FLEX,                ETCf },
 	{ "eval",	"flex (const flex)",		(void *)Eval,		DECL_NIL|DECL_FLEX,		   ETCf },
-	{ "sformat",	"string (string, ...)",		(void *)s_sformat,	DECL_NIL|DECL_WILD|DECL_FORMATTED, ETCf },
+	{ "sformat",	"string (string, ...)",		(void *)s_sformat,	DECL_NIL|DECL_WILD|DECL_FORMATTED|DECL_PURE, ETCf },
 	// ordinary logging
 	{ "y2debug",	"void (string, ...)",		(void *)Y2Debug,	DECL_NIL|DECL_WILD|DECL_FORMATTED, ETCf },
 	{ "y2milestone","void (string, ...)",		(void *)Y2Milestone,	DECL_NIL|DECL_WILD|DECL_FORMATTED, ETCf },
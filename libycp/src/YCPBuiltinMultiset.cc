@@ -22,6 +22,7 @@
 
 #include "ycp/YCPBuiltinMultiset.h"
 #include "ycp/YCPList.h"
+#include "ycp/ycpless.h"
 #include "ycp/YCPBoolean.h"
 #include "ycp/YCPVoid.h"
 #include "ycp/YCPCode.h"
@@ -33,6 +34,37 @@
 extern StaticDeclaration static_declarations;
 
 
+// The algorithms of the STL need sorted input. For unsorted lists
+// difference and intersection count the values of the second list in
+// a hash map instead, the result keeps the order of the first list
+// (for sorted lists both give the same result).
+
+static bool
+isSorted(const YCPList& l)
+{
+    YCPList::const_iterator it = l->begin();
+    if (it == l->end())
+	return true;
+
+    YCPValue last = *it;
+    for (++it; it != l->end(); ++it)
+    {
+	if (ycp_less()(*it, last))
+	    return false;
+	last = *it;
+    }
+    return true;
+}
+
+
+static void
+countValues(const YCPList& l, YCPValueCountMap& counts)
+{
+    for (YCPList::const_iterator it = l->begin(); it != l->end(); ++it)
+	counts[*it]++;
+}
+
+
 static YCPValue
 ms_includes(const YCPList& a, const YCPList& b)
 {
@@ -48,6 +80,22 @@ ms_difference(const YCPList& a, const YCPList& b)
     // see http://www.sgi.com/tech/stl/set_difference.html
 
     YCPList ret;
+
+    if (!isSorted(a) || !isSorted(b))
+    {
+	YCPValueCountMap counts;
+	countValues(b, counts);
+	for (YCPList::const_iterator it = a->begin(); it != a->end(); ++it)
+	{
+	    YCPValueCountMap::iterator c = counts.find(*it);
+	    if (c != counts.end() && c->second > 0)
+		c->second--;
+	    else
+		ret->add(*it);
+	}
+	return ret;
+    }
+
     back_insert_iterator<YCPList> bii(ret);
     set_difference(a->begin(), a->end(), b->begin(), b->end(), bii, ycp_less());
     return ret;
@@ -72,6 +120,23 @@ ms_intersection(const YCPList& a, const YCPList& b)
     // see http://www.sgi.com/tech/stl/set_intersection.html
 
     YCPList ret;
+
+    if (!isSorted(a) || !isSorted(b))
+    {
+	YCPValueCountMap counts;
+	countValues(b, counts);
+	for (YCPList::const_iterator it = a->begin(); it != a->end(); ++it)
+	{
+	    YCPValueCountMap::iterator c = counts.find(*it);
+	    if (c != counts.end() && c->second > 0)
+	    {
+		c->second--;
+		ret->add(*it);
+	    }
+	}
+	return ret;
+    }
+
     back_insert_iterator<YCPList> bii(ret);
     set_intersection(a->begin(), a->end(), b->begin(), b->end(), bii, ycp_less());
     return ret;
@@ -109,12 +174,12 @@ YCPBuiltinMultiset::YCPBuiltinMultiset()
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
 	{ "multiset", "",									NULL, DECL_NAMESPACE,                       ETCf },
-	{ "includes",              "boolean (const list <flex>, const list <flex>)",		(void*) ms_includes, DECL_FLEX,		    ETCf },
-	{ "difference",            "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_difference, DECL_FLEX,	    ETCf },
-	{ "symmetric_difference",  "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_symmetric_difference, DECL_FLEX, ETCf },
-	{ "intersection",          "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_intersection, DECL_FLEX,	    ETCf },
-	{ "union",                 "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_union, DECL_FLEX,		    ETCf },
-	{ "merge",                 "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_merge, DECL_FLEX,		    ETCf },
+	{ "includes",              "boolean (const list <flex>, const list <flex>)",		(void*) ms_includes, DECL_FLEX|DECL_PURE,		    ETCf },
+	{ "difference",            "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_difference, DECL_FLEX|DECL_PURE,	    ETCf },
+	{ "symmetric_difference",  "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_symmetric_difference, DECL_FLEX|DECL_PURE, ETCf },
+	{ "intersection",          "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_intersection, DECL_FLEX|DECL_PURE,	    ETCf },
+	{ "union",                 "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_union, DECL_FLEX|DECL_PURE,		    ETCf },
+	{ "merge",                 "list <flex> (const list <flex>, const list <flex>)",	(void*) ms_merge, DECL_FLEX|DECL_PURE,		    ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
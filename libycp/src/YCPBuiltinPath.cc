@@ -148,12 +148,12 @@ YCPBuiltinPath::YCPBuiltinPath ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "+",	    "path (path, path)",	(void *)p_plus,   ETC },
-	{ "+",	    "path (path, string)",	(void *)p_add,	  ETC },
-	{ "size",   "integer (path)",		(void *)p_size,	  ETC },
-	{ "add",    "path (path, string)",	(void *)p_add,	  ETC },
-	{ "add",    "path (path, path)",	(void *)p_plus,	  ETC },
-	{ "topath", "path (any)",		(void *)p_topath, ETC },
+	{ "+",	    "path (path, path)",	(void *)p_plus,   DECL_PURE, ETCf },
+	{ "+",	    "path (path, string)",	(void *)p_add,	  DECL_PURE, ETCf },
+	{ "size",   "integer (path)",		(void *)p_size,	  DECL_PURE, ETCf },
+	{ "add",    "path (path, string)",	(void *)p_add,	  DECL_PURE, ETCf },
+	{ "add",    "path (path, path)",	(void *)p_plus,	  DECL_PURE, ETCf },
+	{ "topath", "path (any)",		(void *)p_topath, DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
@@ -25,13 +25,18 @@
 
 #define ERR_MAX 80		// for regexp
 #define SUB_MAX 10		// for regexp
+#define REGEX_CACHE_MAX 64	// compiled regexps kept
 
 #include <unistd.h>
 #include <ctype.h>
 #include <stdio.h>
 #include <regex.h>
 #include <libintl.h>
+#include <pthread.h>
+#include <stdlib.h>
 #include <string>
+#include <list>
+#include <map>
 #include <boost/algorithm/string.hpp>
 
 using std::string;
@@ -577,11 +582,7 @@ s_removechars (const YCPString &s, YCPString &r)
     if (s->isAscii() && r->isAscii())
     {
 	string ss = s->value();
-	string include = r->value();
-
-	string::size_type pos = 0;
-	while (pos = ss.find_first_of(include, pos), pos != string::npos)
-	    ss.erase(pos, ss.find_first_not_of(include, pos) - pos);
+	ByteSet (r->value()).filter (ss, false);
 
 	return YCPString(ss);
     }
@@ -624,11 +625,7 @@ s_filterchars (const YCPString &s, const YCPString &i)
     if (s->isAscii() && i->isAscii())
     {
 	string ss = s->value();
-	string include = i->value();
-
-	string::size_type pos = 0;
-	while (pos = ss.find_first_not_of(include, pos), pos != string::npos)
-	    ss.erase(pos, ss.find_first_of(include, pos) - pos);
+	ByteSet (i->value()).filter (ss, true);
 
 	return YCPString(ss);
     }
@@ -686,21 +683,30 @@ s_mergestring (const YCPList &l, const YCPString &s)
     if (l->isEmpty ())		// empty list -> empty result
 	return YCPString (ret);
 
-    string c = s->value ();
+    const string & c = s->value ();
+
+    // size the result first, so it is allocated once
+
+    string::size_type length = 0;
+    for (YCPList::const_iterator it = l->begin (); it != l->end (); ++it)
+    {
+	if ((*it)->isString ())
+	    length += c.size () + (*it)->asString ()->value ().size ();
+    }
+    ret.reserve (length);
 
     // loop through list
 
-    for (int i = 0; i < l->size (); i++)
+    bool first = true;
+    for (YCPList::const_iterator it = l->begin (); it != l->end (); ++it, first = false)
     {
-	YCPValue vv = l->value (i);
-	if (!vv->isString ())	// skip non-string elements
+	if (!(*it)->isString ())	// skip non-string elements
 	    continue;
-	string vs = vv->asString ()->value ();
 
-	if (i != 0)		// insert c *between* strings
+	if (!first)		// insert c *between* strings
 	    ret += c;
 
-	ret += vs;		// add string to result
+	ret += (*it)->asString ()->value ();	// add string to result
     }
 
     return YCPString (ret);
@@ -738,7 +744,7 @@ s_findfirstnotof (const YCPString &s1, const YCPString &s2)
 
     if (s1->isAscii() && s2->isAscii())
     {
-	string::size_type pos = s1->value().find_first_not_of(s2->value());
+	string::size_type pos = ByteSet (s2->value()).findFirstNotOf (s1->value());
 
 	if (pos == string::npos)
 	    return YCPVoid();		// not found
@@ -786,7 +792,7 @@ s_findfirstof (const YCPString &s1, const YCPString &s2)
 
     if (s1->isAscii() && s2->isAscii())
     {
-	string::size_type pos = s1->value().find_first_of(s2->value());
+	string::size_type pos = ByteSet (s2->value()).findFirstOf (s1->value());
 
 	if (pos == string::npos)
 	    return YCPVoid();		// not found
@@ -831,7 +837,7 @@ s_findlastof (const YCPString &s1, const YCPString &s2)
 
     if (s1->isAscii() && s2->isAscii())
     {
-	string::size_type pos = s1->value().find_last_of(s2->value());
+	string::size_type pos = ByteSet (s2->value()).findLastOf (s1->value());
 
 	if (pos == string::npos)
 	    return YCPVoid();		// not found
@@ -877,7 +883,7 @@ s_findlastnotof (const YCPString &s1, const YCPString &s2)
 
     if (s1->isAscii() && s2->isAscii())
     {
-	string::size_type pos = s1->value().find_last_not_of(s2->value());
+	string::size_type pos = ByteSet (s2->value()).findLastNotOf (s1->value());
 
 	if (pos == string::npos)
 	    return YCPVoid();		// not found
@@ -896,6 +902,133 @@ s_findlastnotof (const YCPString &s1, const YCPString &s2)
 }
 
 
+/*
+ * Cache of compiled regular expressions, least recently used ones are
+ * dropped beyond REGEX_CACHE_MAX. YCP code mostly matches many strings
+ * against a few constant patterns, so compiling them once saves most
+ * of the time of the regexp builtins.
+ *
+ * An entry stays alive while it is in use, also if it is dropped from
+ * the cache meanwhile.
+ */
+struct CompiledRegex
+{
+    string pattern;
+    int cflags;
+    regex_t compiled;
+    int refs;			// the cache and the users
+};
+
+typedef std::list<CompiledRegex *> RegexList;
+typedef std::map<std::pair<string, int>, RegexList::iterator> RegexIndex;
+
+static RegexList regex_lru;	// most recently used first
+static RegexIndex regex_index;
+static unsigned long regex_hits;
+static unsigned long regex_misses;
+static pthread_mutex_t regex_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+static void
+regexCacheStats ()
+{
+    y2debug ("Regexp cache: %lu hits, %lu misses, %zu cached",
+	     regex_hits, regex_misses, regex_lru.size ());
+}
+
+
+static void
+unrefRegex (CompiledRegex *re)
+{
+    // regex_mutex is locked
+    if (--re->refs == 0)
+    {
+	regfree (&re->compiled);
+	delete re;
+    }
+}
+
+
+/*
+ * Get the compiled pattern, compiling it if it is not in the cache.
+ * Returns 0 and the regerror () message in error if it does not
+ * compile. Give the result back with releaseRegex ().
+ */
+static CompiledRegex *
+acquireRegex (const char *pattern, int cflags, string &error)
+{
+    std::pair<string, int> key (pattern, cflags);
+
+    pthread_mutex_lock (&regex_mutex);
+
+    if (regex_hits + regex_misses == 0)
+    {
+	atexit (regexCacheStats);
+    }
+
+    RegexIndex::iterator pos = regex_index.find (key);
+    if (pos != regex_index.end ())
+    {
+	regex_hits++;
+	CompiledRegex *re = *pos->second;
+	regex_lru.splice (regex_lru.begin (), regex_lru, pos->second);
+	re->refs++;
+	pthread_mutex_unlock (&regex_mutex);
+	return re;
+    }
+
+    regex_misses++;
+    pthread_mutex_unlock (&regex_mutex);
+
+    // compile without the lock, this is the slow part
+    CompiledRegex *re = new CompiledRegex;
+    int status = regcomp (&re->compiled, pattern, cflags);
+    if (status)
+    {
+	char buf[ERR_MAX + 1];
+	regerror (status, &re->compiled, buf, ERR_MAX);
+	error = buf;
+	delete re;
+	return 0;
+    }
+    re->pattern = pattern;
+    re->cflags = cflags;
+    re->refs = 2;
+
+    pthread_mutex_lock (&regex_mutex);
+    pos = regex_index.find (key);
+    if (pos != regex_index.end ())
+    {
+	// another thread was faster, keep its entry
+	pthread_mutex_unlock (&regex_mutex);
+	re->refs = 1;
+	return re;
+    }
+
+    regex_lru.push_front (re);
+    regex_index[key] = regex_lru.begin ();
+    if (regex_lru.size () > REGEX_CACHE_MAX)
+    {
+	CompiledRegex *oldest = regex_lru.back ();
+	regex_index.erase (std::make_pair (oldest->pattern, oldest->cflags));
+	regex_lru.pop_back ();
+	unrefRegex (oldest);
+    }
+    pthread_mutex_unlock (&regex_mutex);
+
+    return re;
+}
+
+
+static void
+releaseRegex (CompiledRegex *re)
+{
+    pthread_mutex_lock (&regex_mutex);
+    unrefRegex (re);
+    pthread_mutex_unlock (&regex_mutex);
+}
+
+
 /// (regexp builtins)
 typedef struct REG_RET
 {
@@ -919,7 +1052,6 @@ Reg_Ret solve_regular_expression (const char *input, const char *pattern,
     int status;
     char error[ERR_MAX + 1];
 
-    regex_t compiled;
     regmatch_t matchptr[SUB_MAX + 1];
 
     Reg_Ret reg_ret;
@@ -927,19 +1059,18 @@ Reg_Ret solve_regular_expression (const char *input, const char *pattern,
     reg_ret.error = true;
     reg_ret.error_str = "";
 
-    status = regcomp (&compiled, pattern, REG_EXTENDED);
-    if (status)
+    CompiledRegex *re = acquireRegex (pattern, REG_EXTENDED, reg_ret.error_str);
+    if (re == 0)
     {
-	regerror (status, &compiled, error, ERR_MAX);
-	reg_ret.error_str = string (error);
 	return reg_ret;
     }
+    const regex_t & compiled = re->compiled;
 
     if (compiled.re_nsub > SUB_MAX)
     {
 	snprintf (error, ERR_MAX, "too many subexpresions: %zu", compiled.re_nsub);
 	reg_ret.error_str = string (error);
-	regfree (&compiled);
+	releaseRegex (re);
 	return reg_ret;
     }
 
@@ -949,7 +1080,7 @@ Reg_Ret solve_regular_expression (const char *input, const char *pattern,
 
     if (status)
     {
-	regfree (&compiled);
+	releaseRegex (re);
 	return reg_ret;
     }
 
@@ -986,7 +1117,7 @@ Reg_Ret solve_regular_expression (const char *input, const char *pattern,
     result_str += done;
       
     reg_ret.result_str = result_str;
-    regfree (&compiled);
+    releaseRegex (re);
     return reg_ret;
 }
 
@@ -1552,45 +1683,45 @@ YCPBuiltinString::YCPBuiltinString ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "+",		   "string (string, string)",		(void *)s_plus1,                         ETC },
-	{ "+",		   "string (string, integer)",		(void *)s_plus2,			 ETC },
-	{ "+",		   "string (string, path)",		(void *)s_plus3,			 ETC },
-	{ "+",		   "string (string, symbol)",		(void *)s_plus4,			 ETC },
-	{ "issubstring",   "boolean (string, string)",		(void *)s_issubstring,			 ETC },
-	{ "tostring",	   "string (any)",			(void *)s_tostring,			 ETC },
-	{ "tohexstring",   "string (integer)",			(void *)s_tohexstring1,			 ETC },
-	{ "tohexstring",   "string (integer, integer)",		(void *)s_tohexstring2,                  ETC },
-	{ "isempty",	   "boolean (string)",			(void *)s_isempty,			 ETC },
-	{ "size",	   "integer (string)",			(void *)s_size,				 ETC },
-	{ "find",	   "integer (string, string)",		(void *)s_find,	DECL_DEPRECATED,        ETCf },
-	{ "search",	   "integer (string, string)",		(void *)s_search,			 ETC },
-	{ "tolower",	   "string (string)",			(void *)s_tolower,			 ETC },
-	{ "toupper",	   "string (string)",			(void *)s_toupper,			 ETC },
-	{ "toascii",	   "string (string)",			(void *)s_toascii,                       ETC },
-	{ "deletechars",   "string (string, string)",		(void *)s_removechars,			 ETC },
-	{ "filterchars",   "string (string, string)",		(void *)s_filterchars,			 ETC },
-	{ "findfirstnotof","integer (string, string)",		(void *)s_findfirstnotof,		 ETC },
-	{ "findfirstof",   "integer (string, string)",		(void *)s_findfirstof,			 ETC },
-	{ "findlastof",	   "integer (string, string)",		(void *)s_findlastof,			 ETC },
-	{ "findlastnotof", "integer (string, string)",		(void *)s_findlastnotof,		 ETC },
-	{ "substring",	   "string (string, integer)",		(void *)s_substring1,                    ETC },
-	{ "substring",	   "string (string, integer, integer)",	(void *)s_substring2,			 ETC },
+	{ "+",		   "string (string, string)",		(void *)s_plus1,                         DECL_PURE, ETCf },
+	{ "+",		   "string (string, integer)",		(void *)s_plus2,			 DECL_PURE, ETCf },
+	{ "+",		   "string (string, path)",		(void *)s_plus3,			 DECL_PURE, ETCf },
+	{ "+",		   "string (string, symbol)",		(void *)s_plus4,			 DECL_PURE, ETCf },
+	{ "issubstring",   "boolean (string, string)",		(void *)s_issubstring,			 DECL_PURE, ETCf },
+	{ "tostring",	   "string (any)",			(void *)s_tostring,			 DECL_PURE, ETCf },
+	{ "tohexstring",   "string (integer)",			(void *)s_tohexstring1,			 DECL_PURE, ETCf },
+	{ "tohexstring",   "string (integer, integer)",		(void *)s_tohexstring2,                  DECL_PURE, ETCf },
+	{ "isempty",	   "boolean (string)",			(void *)s_isempty,			 DECL_PURE, ETCf },
+	{ "size",	   "integer (string)",			(void *)s_size,				 DECL_PURE, ETCf },
+	{ "find",	   "integer (string, string)",		(void *)s_find,	DECL_DEPRECATED|DECL_PURE,        ETCf },
+	{ "search",	   "integer (string, string)",		(void *)s_search,			 DECL_PURE, ETCf },
+	{ "tolower",	   "string (string)",			(void *)s_tolower,			 DECL_PURE, ETCf },
+	{ "toupper",	   "string (string)",			(void *)s_toupper,			 DECL_PURE, ETCf },
+	{ "toascii",	   "string (string)",			(void *)s_toascii,                       DECL_PURE, ETCf },
+	{ "deletechars",   "string (string, string)",		(void *)s_removechars,			 DECL_PURE, ETCf },
+	{ "filterchars",   "string (string, string)",		(void *)s_filterchars,			 DECL_PURE, ETCf },
+	{ "findfirstnotof","integer (string, string)",		(void *)s_findfirstnotof,		 DECL_PURE, ETCf },
+	{ "findfirstof",   "integer (string, string)",		(void *)s_findfirstof,			 DECL_PURE, ETCf },
+	{ "findlastof",	   "integer (string, string)",		(void *)s_findlastof,			 DECL_PURE, ETCf },
+	{ "findlastnotof", "integer (string, string)",		(void *)s_findlastnotof,		 DECL_PURE, ETCf },
+	{ "substring",	   "string (string, integer)",		(void *)s_substring1,                    DECL_PURE, ETCf },
+	{ "substring",	   "string (string, integer, integer)",	(void *)s_substring2,			 DECL_PURE, ETCf },
 	{ "timestring",	   "string (string, integer, boolean)",	(void *)s_timestring,			 ETC },
-	{ "mergestring",   "string (const list <string>, string)", (void *)s_mergestring,		 ETC },
+	{ "mergestring",   "string (const list <string>, string)", (void *)s_mergestring,		 DECL_PURE, ETCf },
 	{ "crypt",	   "string (string)",			(void *)s_crypt,			 ETC },
 	{ "cryptmd5",	   "string (string)",			(void *)s_cryptmd5,			 ETC },
 	{ "cryptblowfish", "string (string)",			(void *)s_cryptblowfish,                 ETC },
 	{ "cryptsha256",   "string (string)",			(void *)s_cryptsha256,                   ETC },
 	{ "cryptsha512",   "string (string)",			(void *)s_cryptsha512,                   ETC },
-	{ "regexpmatch",   "boolean (string, string)",		(void *)s_regexpmatch,			 ETC },
-	{ "regexppos",	   "list<integer> (string, string)",	(void *)s_regexppos,			 ETC },
-	{ "regexpsub",	   "string (string, string, string)",	(void *)s_regexpsub,			 ETC },
-	{ "regexptokenize","list <string> (string, string)",	(void *)s_regexptokenize,		 ETC },
+	{ "regexpmatch",   "boolean (string, string)",		(void *)s_regexpmatch,			 DECL_PURE, ETCf },
+	{ "regexppos",	   "list<integer> (string, string)",	(void *)s_regexppos,			 DECL_PURE, ETCf },
+	{ "regexpsub",	   "string (string, string, string)",	(void *)s_regexpsub,			 DECL_PURE, ETCf },
+	{ "regexptokenize","list <string> (string, string)",	(void *)s_regexptokenize,		 DECL_PURE, ETCf },
 	{ "dgettext",	   "string (string, string)",		(void *)s_dgettext,			 ETC },
 	{ "dngettext",	   "string (string, string, string, integer)",	(void *)s_dngettext,		 ETC },
 	{ "dpgettext",	   "string (string, string, string)",	(void *)s_dpgettext,                     ETC },
-	{ "lsubstring",	   "string (string, integer)",		(void *)s_substring1, DECL_DEPRECATED,  ETCf },
-	{ "lsubstring",	   "string (string, integer, integer)",	(void *)s_substring2, DECL_DEPRECATED,  ETCf },
+	{ "lsubstring",	   "string (string, integer)",		(void *)s_substring1, DECL_DEPRECATED|DECL_PURE,  ETCf },
+	{ "lsubstring",	   "string (string, integer, integer)",	(void *)s_substring2, DECL_DEPRECATED|DECL_PURE,  ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
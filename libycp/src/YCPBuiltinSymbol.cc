@@ -54,7 +54,7 @@ YCPBuiltinSymbol::YCPBuiltinSymbol ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "tosymbol",	"symbol (const string)",		(void*) s_tosymbol, ETC },
+	{ "tosymbol",	"symbol (const string)",		(void*) s_tosymbol, DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
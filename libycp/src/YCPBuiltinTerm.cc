@@ -289,14 +289,14 @@ YCPBuiltinTerm::YCPBuiltinTerm ()
     static declaration_t declarations[] = {
 #define ETC 0, NULL, constTypePtr(), NULL
 #define ETCf   NULL, constTypePtr(), NULL
-	{ "add",	"term (term, const any)",		(void *)t_add,      ETC },
-	{ "size",	"integer (term)",			(void *)t_size,	    ETC },
-	{ "symbolof",	"symbol (term)",			(void *)t_symbolof, ETC },
-	{ "select",	"flex (term, integer, const flex)",	(void *)t_select, DECL_NIL|DECL_FLEX, ETCf },
-	{ "toterm",	"term (any)",				(void *)t_toterm1,  ETC },
-	{ "toterm",	"term (symbol, const list <any>)",	(void *)t_toterm2,  ETC },
-	{ "remove",	"term (term, integer)",			(void *)t_remove,   ETC },
-	{ "argsof",	"list <any> (term)",			(void *)t_argsof,   ETC },
+	{ "add",	"term (term, const any)",		(void *)t_add,      DECL_PURE, ETCf },
+	{ "size",	"integer (term)",			(void *)t_size,	    DECL_PURE, ETCf },
+	{ "symbolof",	"symbol (term)",			(void *)t_symbolof, DECL_PURE, ETCf },
+	{ "select",	"flex (term, integer, const flex)",	(void *)t_select, DECL_NIL|DECL_FLEX|DECL_PURE, ETCf },
+	{ "toterm",	"term (any)",				(void *)t_toterm1,  DECL_PURE, ETCf },
+	{ "toterm",	"term (symbol, const list <any>)",	(void *)t_toterm2,  DECL_PURE, ETCf },
+	{ "remove",	"term (term, integer)",			(void *)t_remove,   DECL_PURE, ETCf },
+	{ "argsof",	"list <any> (term)",			(void *)t_argsof,   DECL_PURE, ETCf },
 	{ NULL, NULL, NULL, ETC }
 #undef ETC
 #undef ETCf
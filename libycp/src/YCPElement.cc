@@ -25,9 +25,17 @@
 
 // YCPElementRep
 
+unsigned long long YCPElementRep::_allocated = 0;
+int YCPElementRep::_atomic = 0;
+
 YCPElementRep::YCPElementRep()
     : reference_counter(0)
 {
+    // values are created by the parallel workers too
+    if (_atomic)
+	__sync_add_and_fetch (&_allocated, 1);
+    else
+	_allocated++;
 }
 
 YCPElementRep::~YCPElementRep()
@@ -37,17 +45,20 @@ YCPElementRep::~YCPElementRep()
 void
 YCPElementRep::destroy() const
 {
-    reference_counter--;
-    if (reference_counter == 0)
+    int counter = _atomic ? __sync_sub_and_fetch (&reference_counter, 1) : --reference_counter;
+    if (counter == 0)
 	delete this;
-    else if (reference_counter < 0)
+    else if (counter < 0)
 	y2internal("Negative reference counter");
 }
 
 const YCPElementRep *
 YCPElementRep::clone() const
 {
-    reference_counter++;
+    if (_atomic)
+	__sync_add_and_fetch (&reference_counter, 1);
+    else
+	reference_counter++;
     return this;
 }
 
@@ -139,7 +139,23 @@ static long long fromStream (bytecodeistream & str)
     return ll;
 }
 
+YCPInteger* YCPInteger::smallints[YCPInteger::cache_max - YCPInteger::cache_min + 1];
+
+const YCPIntegerRep*
+YCPInteger::cached (long long v)
+{
+    YCPInteger*& integer = smallints[v - cache_min];
+    if (integer == NULL)
+    {
+	YCPInteger *fresh = new YCPInteger (new YCPIntegerRep (v));
+	if (!__sync_bool_compare_and_swap (&integer, (YCPInteger *) NULL, fresh))
+	    delete fresh;
+    }
+    return static_cast<const YCPIntegerRep*>(integer->element);
+}
+
+
 YCPInteger::YCPInteger (bytecodeistream & str)
-    : YCPValue (new YCPIntegerRep (fromStream (str)))
+    : YCPValue (YCPInteger (fromStream (str)))
 {
 }
@@ -0,0 +1,81 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCPInterpreterContext.cc
+
+   State of one evaluation of YCP code, for running code concurrently
+
+/-*/
+
+#include "ycp/YCPInterpreterContext.h"
+#include "ycp/YCPBoolean.h"
+#include "ycp/YCPVoid.h"
+
+__thread YCPInterpreterContext *YCPInterpreterContext::_current = 0;
+
+
+YCPInterpreterContext::YCPInterpreterContext ()
+{
+    __sync_add_and_fetch (&Rep::_atomic, 1);
+    __sync_add_and_fetch (&YCPElementRep::_atomic, 1);
+
+    // create the shared constants now, not racing in the threads
+    YCPBoolean (true);
+    YCPBoolean (false);
+    YCPVoid ();
+}
+
+
+YCPInterpreterContext::~YCPInterpreterContext ()
+{
+    if (_current == this)
+    {
+	activate (0);
+    }
+
+    // release the values while reference counting is still atomic
+    m_values.clear ();
+
+    __sync_sub_and_fetch (&YCPElementRep::_atomic, 1);
+    __sync_sub_and_fetch (&Rep::_atomic, 1);
+}
+
+
+void
+YCPInterpreterContext::activate (YCPInterpreterContext *context)
+{
+    _current = context;
+    SymbolEntry::_store = context ? &context->m_values : 0;
+    SymbolEntry::_frames = context ? &context->m_values.frames : SymbolEntry::threadFrames ();
+    ExecutionEnvironment::_current = context ? &context->m_environment : 0;
+}
+
+
+YCPValue
+YCPInterpreterContext::evaluate (const YCodePtr & code)
+{
+    Scope scope (this);
+    return code->evaluate ();
+}
+
+
+YCPInterpreterContext::Scope::Scope (YCPInterpreterContext *context)
+    : m_previous (YCPInterpreterContext::_current)
+{
+    YCPInterpreterContext::activate (context);
+}
+
+
+YCPInterpreterContext::Scope::~Scope ()
+{
+    YCPInterpreterContext::activate (m_previous);
+}
@@ -22,7 +22,10 @@
 #include "YCP.h"
 #include "ycp/y2log.h"
 #include "ycp/YCPList.h"
+#include "ycp/ycpless.h"
 #include <algorithm>
+#include <wchar.h>
+#include "y2string.h"
 #include "ycp/Bytecode.h"
 #include "ycp/Xmlcode.h"
 #include "ycp/YCPCodeCompare.h"
@@ -30,58 +33,540 @@
 
 extern ExecutionEnvironment ee;
 
+// ------------------------------------------------------------------
+// persistent tree for large lists
+//
+// A B+ tree: the leaves hold blocks of up to LEAF_MAX values, the
+// inner nodes up to INNER_MAX children and know the number of values
+// below them. Nodes are reference counted and shared between copies
+// of a list, a shared node is copied before it is changed. So a
+// change copies only the nodes on the path from the root to the value.
+
+// contains () hashes the values of lists with at least INDEX_MIN
+// values on its INDEX_AFTER'th call on the unchanged list
+#define INDEX_MIN	16
+#define INDEX_AFTER	4
+
+// lists switch to a tree when they grow to TREE_MIN values and back
+// to a vector when they shrink below TREE_MIN / 4
+#define TREE_MIN	512
+#define LEAF_MAX	64
+#define INNER_MAX	32
+
+// fill of the nodes of a tree built from a vector
+#define LEAF_FILL	48
+#define INNER_FILL	24
+
+struct YCPListNode
+{
+    int refs;
+    int count;				// values in this subtree
+    bool leaf;
+    vector<YCPValue> values;		// leaf: the values
+    vector<YCPListNode *> children;	// inner node: the subtrees
+
+    YCPListNode (bool is_leaf) : refs (1), count (0), leaf (is_leaf) {}
+};
+
+
+static void
+unrefNode (YCPListNode *node)
+{
+    if (YCPElementRep::unrefShared (node->refs) > 0)
+	return;
+
+    for (size_t i = 0; i < node->children.size (); i++)
+    {
+	unrefNode (node->children[i]);
+    }
+    delete node;
+}
+
+
+// return node or a copy of it which is not shared and may be changed
+static YCPListNode *
+ownNode (YCPListNode *node)
+{
+    if (node->refs == 1)
+	return node;
+
+    YCPListNode *copy = new YCPListNode (node->leaf);
+    copy->count = node->count;
+    if (node->leaf)
+    {
+	copy->values.reserve (LEAF_MAX + 1);
+	copy->values.insert (copy->values.end (), node->values.begin (), node->values.end ());
+    }
+    else
+    {
+	copy->children.reserve (INNER_MAX + 1);
+	copy->children = node->children;
+	for (size_t i = 0; i < copy->children.size (); i++)
+	{
+	    YCPElementRep::refShared (copy->children[i]->refs);
+	}
+    }
+    unrefNode (node);
+    return copy;
+}
+
+
+// the child of an inner node containing index, index is made
+// relative to the child. index == count gives the last child.
+static size_t
+findChild (const YCPListNode *node, int & index)
+{
+    size_t i = 0;
+    while (i < node->children.size () - 1
+	   && index >= node->children[i]->count)
+    {
+	index -= node->children[i]->count;
+	i++;
+    }
+    return i;
+}
+
+
+static int
+countValues (const YCPListNode *node)
+{
+    int count = 0;
+    for (size_t i = 0; i < node->children.size (); i++)
+    {
+	count += node->children[i]->count;
+    }
+    return count;
+}
+
+
+// insert value before index into node (which must be owned)
+// returns the new right sibling if node had to be split
+static YCPListNode *
+insertValue (YCPListNode *node, int index, const YCPValue & value)
+{
+    node->count++;
+
+    if (node->leaf)
+    {
+	node->values.insert (node->values.begin () + index, value);
+	if (node->values.size () <= LEAF_MAX)
+	    return 0;
+
+	// split in the middle, but keep the node full when appending
+	// or prepending, so a list built that way has full blocks
+	size_t at = LEAF_MAX / 2;
+	if (index == LEAF_MAX)
+	    at = LEAF_MAX;
+	else if (index == 0)
+	    at = 1;
+
+	YCPListNode *right = new YCPListNode (true);
+	right->values.reserve (LEAF_MAX + 1);
+	right->values.insert (right->values.end (), node->values.begin () + at, node->values.end ());
+	node->values.erase (node->values.begin () + at, node->values.end ());
+	node->count = node->values.size ();
+	right->count = right->values.size ();
+	return right;
+    }
+
+    size_t i = findChild (node, index);
+    YCPListNode *child = node->children[i] = ownNode (node->children[i]);
+    YCPListNode *split = insertValue (child, index, value);
+    if (split == 0)
+	return 0;
+
+    node->children.insert (node->children.begin () + i + 1, split);
+    if (node->children.size () <= INNER_MAX)
+	return 0;
+
+    size_t at = INNER_MAX / 2;
+    if (i + 1 == INNER_MAX)
+	at = INNER_MAX;
+    else if (i == 0)
+	at = 1;
+
+    YCPListNode *right = new YCPListNode (false);
+    right->children.reserve (INNER_MAX + 1);
+    right->children.insert (right->children.end (), node->children.begin () + at, node->children.end ());
+    node->children.erase (node->children.begin () + at, node->children.end ());
+    right->count = countValues (right);
+    node->count -= right->count;
+    return right;
+}
+
+
+// merge the children i and i + 1 of node (which must be owned)
+// if they fit into one
+static void
+mergeChildren (YCPListNode *node, size_t i)
+{
+    YCPListNode *left = node->children[i];
+    YCPListNode *right = node->children[i + 1];
+
+    if (left->leaf)
+    {
+	if (left->values.size () + right->values.size () > LEAF_MAX)
+	    return;
+	left = node->children[i] = ownNode (left);
+	left->values.insert (left->values.end (), right->values.begin (), right->values.end ());
+    }
+    else
+    {
+	if (left->children.size () + right->children.size () > INNER_MAX)
+	    return;
+	left = node->children[i] = ownNode (left);
+	left->children.insert (left->children.end (), right->children.begin (), right->children.end ());
+	for (size_t c = 0; c < right->children.size (); c++)
+	{
+	    YCPElementRep::refShared (right->children[c]->refs);
+	}
+    }
+    left->count += right->count;
+    unrefNode (right);
+    node->children.erase (node->children.begin () + i + 1);
+}
+
+
+// remove the value at index from node (which must be owned)
+static void
+eraseValue (YCPListNode *node, int index)
+{
+    node->count--;
+
+    if (node->leaf)
+    {
+	node->values.erase (node->values.begin () + index);
+	return;
+    }
+
+    size_t i = findChild (node, index);
+    YCPListNode *child = node->children[i] = ownNode (node->children[i]);
+    eraseValue (child, index);
+
+    if (child->count == 0)
+    {
+	unrefNode (child);
+	node->children.erase (node->children.begin () + i);
+	return;
+    }
+
+    // keep the nodes reasonably filled
+    size_t size = child->leaf ? child->values.size () : child->children.size ();
+    size_t max = child->leaf ? LEAF_MAX : INNER_MAX;
+    if (size < max / 4)
+    {
+	if (i + 1 < node->children.size ())
+	    mergeChildren (node, i);
+	else if (i > 0)
+	    mergeChildren (node, i - 1);
+    }
+}
+
+
+static void
+insertTree (YCPListNode *& root, int index, const YCPValue & value)
+{
+    root = ownNode (root);
+    YCPListNode *split = insertValue (root, index, value);
+    if (split != 0)
+    {
+	YCPListNode *top = new YCPListNode (false);
+	top->children.reserve (INNER_MAX + 1);
+	top->children.push_back (root);
+	top->children.push_back (split);
+	top->count = root->count + split->count;
+	root = top;
+    }
+}
+
+
+static void
+eraseTree (YCPListNode *& root, int index)
+{
+    root = ownNode (root);
+    eraseValue (root, index);
+    while (!root->leaf
+	   && root->children.size () == 1)
+    {
+	YCPListNode *child = root->children[0];
+	root->children.clear ();
+	delete root;
+	root = child;
+    }
+}
+
+
+static void
+setTree (YCPListNode *& root, int index, const YCPValue & value)
+{
+    YCPListNode *node = root = ownNode (root);
+    while (!node->leaf)
+    {
+	size_t i = findChild (node, index);
+	node = node->children[i] = ownNode (node->children[i]);
+    }
+    node->values[index] = value;
+}
+
+
+static YCPListNode *
+buildTree (const YCPValue *values, int count)
+{
+    vector<YCPListNode *> level;
+    for (int i = 0; i < count; i += LEAF_FILL)
+    {
+	int n = count - i < LEAF_FILL ? count - i : LEAF_FILL;
+	YCPListNode *leaf = new YCPListNode (true);
+	leaf->values.reserve (LEAF_MAX + 1);
+	leaf->values.insert (leaf->values.end (), values + i, values + i + n);
+	leaf->count = n;
+	level.push_back (leaf);
+    }
+
+    if (level.empty ())
+	return new YCPListNode (true);
+
+    while (level.size () > 1)
+    {
+	vector<YCPListNode *> up;
+	for (size_t i = 0; i < level.size (); i += INNER_FILL)
+	{
+	    size_t n = level.size () - i < INNER_FILL ? level.size () - i : INNER_FILL;
+	    YCPListNode *inner = new YCPListNode (false);
+	    inner->children.reserve (INNER_MAX + 1);
+	    inner->children.insert (inner->children.end (), level.begin () + i, level.begin () + i + n);
+	    inner->count = countValues (inner);
+	    up.push_back (inner);
+	}
+	level.swap (up);
+    }
+    return level[0];
+}
+
+
+static void
+flattenTree (const YCPListNode *node, vector<YCPValue> & values)
+{
+    if (node->leaf)
+    {
+	values.insert (values.end (), node->values.begin (), node->values.end ());
+	return;
+    }
+    for (size_t i = 0; i < node->children.size (); i++)
+    {
+	flattenTree (node->children[i], values);
+    }
+}
+
+
+// ------------------------------------------------------------------
+// YCPListIterator
+
+const YCPValue &
+YCPListIterator::locate () const
+{
+    m_block = m_list->block (m_index, m_blockstart, m_blockend);
+    return m_block[m_index - m_blockstart];
+}
+
+
+// ------------------------------------------------------------------
 // YCPListRep
 
+struct YCPListIndex
+{
+    YCPValueHashSet values;
+};
+
+
 YCPListRep::YCPListRep()
+    : m_front (0)
+    , m_tree (0)
+    , m_index (0)
+    , m_lookups (0)
 {
     // TODO: is this value a good choice
     // elements.reserve(32);
 }
 
 
+YCPListRep::~YCPListRep()
+{
+    if (m_tree)
+	unrefNode (m_tree);
+    delete m_index;
+}
+
+
+void
+YCPListRep::dropIndex ()
+{
+    delete m_index;
+    m_index = 0;
+    m_lookups = 0;
+}
+
+
+void
+YCPListRep::toTree ()
+{
+    m_tree = buildTree (&elements[m_front], size ());
+    YCPValueList ().swap (elements);
+    m_front = 0;
+}
+
+
+void
+YCPListRep::fromTree ()
+{
+    YCPValueList values;
+    values.reserve (m_tree->count);
+    flattenTree (m_tree, values);
+    unrefNode (m_tree);
+    m_tree = 0;
+    elements.swap (values);
+    m_front = 0;
+}
+
+
+const YCPValue *
+YCPListRep::block (int n, int & start, int & end) const
+{
+    if (m_tree == 0)
+    {
+	start = 0;
+	end = size ();
+	return end > 0 ? &elements[m_front] : 0;
+    }
+
+    const YCPListNode *node = m_tree;
+    int index = n;
+    while (!node->leaf)
+    {
+	node = node->children[findChild (node, index)];
+    }
+    start = n - index;
+    end = start + node->values.size ();
+    return &node->values[0];
+}
+
+
 int
 YCPListRep::size() const
 {
-    return elements.size();
+    if (m_tree)
+	return m_tree->count;
+    return elements.size() - m_front;
 }
 
 
 void
 YCPListRep::reserve (int size)
 {
-    elements.reserve (size);
+    if (m_tree == 0)
+	elements.reserve (m_front + size);
 }
 
 
 bool
 YCPListRep::isEmpty() const
 {
-    return elements.empty();
+    return size() == 0;
 }
 
 
 void
 YCPListRep::add (const YCPValue& value)
 {
+    changed ();
+    if (m_tree)
+    {
+	insertTree (m_tree, m_tree->count, value);
+	return;
+    }
     elements.push_back(value);
+    if (size() >= TREE_MIN)
+	toTree ();
 }
 
 
 void
 YCPListRep::push_back(const YCPValue& value)
 {
-    elements.push_back(value);
+    add (value);
+}
+
+
+void
+YCPListRep::addAll (vector<YCPValue>& values)
+{
+    changed ();
+    if (m_tree == 0 && size () == 0)
+    {
+	if (values.size () >= TREE_MIN)
+	{
+	    m_tree = buildTree (&values[0], values.size ());
+	    YCPValueList ().swap (elements);
+	    m_front = 0;
+	}
+	else
+	{
+	    // take the vector, no copying at all
+	    elements.swap (values);
+	    m_front = 0;
+	}
+    }
+    else if (m_tree)
+    {
+	for (size_t i = 0; i < values.size (); i++)
+	    insertTree (m_tree, m_tree->count, values[i]);
+    }
+    else
+    {
+	elements.insert (elements.end (), values.begin (), values.end ());
+	if (size () >= TREE_MIN)
+	    toTree ();
+    }
+
+    values.clear ();
+}
+
+
+void
+YCPListRep::prepend (const YCPValue& value)
+{
+    changed ();
+    if (m_tree)
+    {
+	insertTree (m_tree, 0, value);
+	return;
+    }
+    if (m_front == 0)
+    {
+	// open a gap as large as the list, so repeated prepending
+	// is amortized constant time like appending
+	int gap = size() < 4 ? 4 : size();
+	elements.insert (elements.begin (), gap, YCPValue (YCPNull ()));
+	m_front = gap;
+    }
+    elements[--m_front] = value;
+    if (size() >= TREE_MIN)
+	toTree ();
 }
 
 
 void
 YCPListRep::set (const int i, const YCPValue& value)
 {
+    changed ();
     if (i < 0)
 	return;
     while (i >= size())
-	elements.push_back(YCPVoid());
-    elements[i] = value;
+	add (YCPVoid());
+    if (m_tree)
+	setTree (m_tree, i, value);
+    else
+	elements[m_front + i] = value;
 }
 
 
@@ -93,7 +578,15 @@ YCPListRep::remove (const int n)
         ycp2error("Invalid index %d (max %d) in %s", n, size()-1, __PRETTY_FUNCTION__);
         abort();
     }
-    elements.erase (elements.begin () + n);
+    changed ();
+    if (m_tree)
+    {
+	eraseTree (m_tree, n);
+	if (size() < TREE_MIN / 4)
+	    fromTree ();
+	return;
+    }
+    elements.erase (elements.begin () + m_front + n);
 }
 
 
@@ -104,46 +597,158 @@ YCPListRep::swap (int x, int y)
     if ((x < 0) || (x >= size()) || (y < 0) || (y >= size()))
 	return;
 
-    std::swap (elements[x], elements[y]);
+    if (m_tree)
+    {
+	YCPValue vx = value (x);
+	setTree (m_tree, x, value (y));
+	setTree (m_tree, y, vx);
+	return;
+    }
+    std::swap (elements[m_front + x], elements[m_front + y]);
 }
 
 
 bool YCPListRep::contains (const YCPValue& value) const
 {
+    if (m_index == 0
+	&& !value.isNull ()
+	&& size () >= INDEX_MIN
+	&& ++m_lookups >= INDEX_AFTER)
+    {
+	// threads evaluating in parallel may race here, the first
+	// complete index wins
+	YCPListIndex *index = new YCPListIndex;
+	index->values.insert (begin (), end ());
+	if (!__sync_bool_compare_and_swap (&m_index, (YCPListIndex *) 0, index))
+	    delete index;
+    }
+
+    if (m_index && !value.isNull ())
+	return m_index->values.find (value) != m_index->values.end ();
+
     return find_if(begin(), end(), bind2nd(ycp_equal_to(), value)) != end();
 }
 
 
+// sorting works on the vector
+
 void
 YCPListRep::sortlist()
 {
-    std::sort(elements.begin(), elements.end(), ycp_less());
+    if (m_tree)
+	fromTree ();
+    std::sort(elements.begin() + m_front, elements.end(), ycp_less());
+    if (size() >= TREE_MIN)
+	toTree ();
+}
+
+
+// an element of a locale aware sort with the collation key of a
+// string, comparing the keys gives the order of wcscoll (the order of
+// YCPStringRep::compare respecting the locale)
+struct LocaleSortEntry
+{
+    const YCPValue *value;
+    bool string;
+    wstring key;
+};
+
+
+struct LocaleSortLess
+{
+    bool operator() (const LocaleSortEntry *a, const LocaleSortEntry *b) const
+    {
+	if (a->string && b->string)
+	    return a->key < b->key;
+	return ycp_less (true) (*a->value, *b->value);
+    }
+};
+
+
+// the collation key of a string, false if it cannot be converted
+static bool
+collationKey (const YCPValue & value, wstring & key)
+{
+    wstring w;
+    if (!utf82wchar (value->asString ()->value_cstr (), &w))
+	return false;
+
+    size_t n = wcsxfrm (0, w.c_str (), 0);
+    key.resize (n + 1);
+    wcsxfrm (&key[0], w.c_str (), n + 1);
+    key.resize (n);
+    return true;
 }
 
 
 void
 YCPListRep::lsortlist()
 {
-    std::sort(elements.begin(), elements.end(), ycp_less(true));
+    if (m_tree)
+	fromTree ();
+
+    // compute the collation keys once instead of converting and
+    // collating both strings in every comparison
+    vector<LocaleSortEntry> entries (size ());
+    vector<LocaleSortEntry *> order (size ());
+    bool keyed = true;
+    for (int i = 0; i < size () && keyed; i++)
+    {
+	LocaleSortEntry & entry = entries[i];
+	entry.value = &elements[m_front + i];
+	entry.string = (*entry.value)->isString ();
+	if (entry.string)
+	    keyed = collationKey (*entry.value, entry.key);
+	order[i] = &entry;
+    }
+
+    if (keyed)
+    {
+	std::sort (order.begin (), order.end (), LocaleSortLess ());
+
+	YCPValueList sorted;
+	sorted.reserve (size () + 1);
+	for (size_t i = 0; i < order.size (); i++)
+	    sorted.push_back (*order[i]->value);
+	elements.swap (sorted);
+	m_front = 0;
+    }
+    else
+    {
+	std::sort(elements.begin() + m_front, elements.end(), ycp_less(true));
+    }
+
+    if (size() >= TREE_MIN)
+	toTree ();
 }
 
 
 void
 YCPListRep::fsortlist(const YCPCodeCompare& cmp)
 {
-    std::sort (elements.begin (), elements.end (), cmp);
+    if (m_tree)
+	fromTree ();
+    std::sort (elements.begin () + m_front, elements.end (), cmp);
+    if (size() >= TREE_MIN)
+	toTree ();
 }
 
 const YCPElementRep*
 YCPListRep::shallowCopy() const
 {
-    y2debug ("YCPListRep::shallowCopy for %s", toString().c_str() );
     YCPListRep* newlist = new YCPListRep ();
-    newlist->reserve (size());
-    for (int i=0; i<size(); i++)
+    if (m_tree)
     {
-	newlist->add(value(i));
+	// share the tree
+	YCPElementRep::refShared (m_tree->refs);
+	newlist->m_tree = m_tree;
+	return newlist;
     }
+
+    y2debug ("YCPListRep::shallowCopy for %s", toString().c_str() );
+    // the copy is usually made to be changed, leave room for one more
+    newlist->reserve (size() + 1);
+    newlist->elements.insert (newlist->elements.end (), elements.begin () + m_front, elements.end ());
     y2debug ("YCPListRep::shallowCopy result: %s", newlist->toString ().c_str () );
     return newlist;
 }
@@ -152,20 +757,14 @@ YCPListRep::shallowCopy() const
 YCPList
 YCPListRep::functionalAdd (const YCPValue& val, bool prepend) const
 {
-#warning TODO: implement this better. Avoid duplicating the list.
-    YCPList newlist;
-    newlist->reserve (size() + 1);
+    YCPList newlist = static_cast<const YCPListRep *>(shallowCopy ())->asList ();
     if (prepend)
     {
-	newlist->add(val);
-    }
-    for (int i=0; i<size(); i++)
-    {
-       newlist->add(value(i));
+	newlist->prepend (val);
     }
-    if (!prepend)
+    else
     {
-	newlist->add(val);
+	newlist->add (val);
     }
     return newlist;
 }
@@ -180,21 +779,29 @@ YCPListRep::value(int n) const
 	//abort();
 	return YCPNull();
     }
-    return elements[n];
+    if (m_tree)
+    {
+	int start, end;
+	const YCPValue *values = block (n, start, end);
+	return values[n - start];
+    }
+    return elements[m_front + n];
 }
 
 
 YCPListRep::const_iterator
 YCPListRep::begin() const
 {
-    return elements.begin();
+    if (m_tree)
+	return YCPListIterator (this, 0);
+    return YCPListIterator (this, 0, size () > 0 ? &elements[m_front] : 0, 0, size ());
 }
 
 
 YCPListRep::const_iterator
 YCPListRep::end() const
 {
-    return elements.end();
+    return YCPListIterator (this, size ());
 }
 
 
@@ -214,10 +821,13 @@ YCPListRep::compare(const YCPList& l) const
     switch( what )
     {
     case 0:   // none is empty
-	for ( i = 0; i < size_short; i++ )
 	{
-	    order = value(i)->compare( l->value(i) );
-	    if ( order == YO_LESS || order == YO_GREATER ) return order;
+	    const_iterator it = begin (), it_l = l->begin ();
+	    for ( i = 0; i < size_short; i++, ++it, ++it_l )
+	    {
+		order = (*it)->compare( *it_l );
+		if ( order == YO_LESS || order == YO_GREATER ) return order;
+	    }
 	}
 
 	// no difference found in shorter length
@@ -256,10 +866,10 @@ YCPListRep::commaList() const
 {
     string ret;
 
-    for (unsigned index = 0; index < elements.size(); index++)
+    for (const_iterator it = begin (); it != end (); ++it)
     {
-	if (index != 0) ret += ", ";
-	ret += elements[index].isNull() ? "(null)" : elements[index]->toString();
+	if (it != begin ()) ret += ", ";
+	ret += it->isNull() ? "(null)" : (*it)->toString();
     }
     return ret;
 }
@@ -271,10 +881,10 @@ YCPListRep::commaList() const
 std::ostream &
 YCPListRep::toStream (std::ostream & str) const
 {
-    Bytecode::writeInt32 (str, elements.size());
-    for (unsigned index = 0; index < elements.size(); index++)
+    Bytecode::writeInt32 (str, size());
+    for (const_iterator it = begin (); it != end (); ++it)
     {
-	if (!Bytecode::writeValue (str, elements[index]))
+	if (!Bytecode::writeValue (str, *it))
 	{
 	    y2error ("Can't write all values");
 	    break;
@@ -287,11 +897,11 @@ YCPListRep::toStream (std::ostream & str) const
 std::ostream &
 YCPListRep::toXml (std::ostream & str, int indent ) const
 {
-    str << "<list size=\"" << elements.size() << "\">";
-    for (unsigned index = 0; index < elements.size(); index++)
+    str << "<list size=\"" << size() << "\">";
+    for (const_iterator it = begin (); it != end (); ++it)
     {
 	str << "<element>";
-	elements[index]->toXml( str, 0 );
+	(*it)->toXml( str, 0 );
 	str << "</element>";
     }
     return str << "</list>";
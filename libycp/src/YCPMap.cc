@@ -20,22 +20,529 @@
 
 #include "ycp/y2log.h"
 #include "ycp/YCPMap.h"
+#include "ycp/YCPString.h"
+#include "ycp/YCPInteger.h"
 #include "ycp/Bytecode.h"
 #include "ycp/Xmlcode.h"
 #include "ycp/ExecutionEnvironment.h"
 
+#include <new>
+#include <algorithm>
+
 extern ExecutionEnvironment ee;
 
+// ------------------------------------------------------------------
+// persistent hash trie for large maps
+//
+// Every node covers TRIE_BITS bits of the key hash. An entry whose
+// hash fragment is unique in a node is stored in the node (datamap),
+// otherwise the entries go to a subtrie (nodemap). Entries with equal
+// hashes end up in a collision node below the last level. Nodes are
+// reference counted and shared between copies of a map, a shared
+// node is copied before it is changed.
+
+// maps switch to a trie when they grow to TRIE_MIN entries and back
+// to a std::map when they shrink below TRIE_MIN / 4
+#define TRIE_MIN	256
+#define TRIE_BITS	5
+#define TRIE_MASK	((1u << TRIE_BITS) - 1)
+#define HASH_BITS	32
+
+typedef YCPValueYCPValueMap::value_type YCPMapEntry;
+
+struct YCPMapSlot
+{
+    YCPMapEntry entry;
+    unsigned hash;
+
+    YCPMapSlot (const YCPValue & key, const YCPValue & value, unsigned h)
+	: entry (key, value), hash (h) {}
+};
+
+struct YCPMapNode
+{
+    int refs;
+    unsigned datamap;		// hash fragments stored in slots
+    unsigned nodemap;		// hash fragments stored in nodes
+    int nslots;
+    int nnodes;
+    YCPMapSlot *slots;		// ordered by hash fragment
+    YCPMapNode **nodes;		// ordered by hash fragment
+};
+
+// the entries of a trie in key order, shared between the copies of
+// a map as long as they share the trie
+struct YCPMapOrder
+{
+    int refs;
+    vector<const YCPMapEntry *> entries;
+};
+
+
+static inline bool
+keyEqual (const YCPValue & k1, const YCPValue & k2)
+{
+    return k1->compare (k2) == YO_EQUAL;
+}
+
+
+static inline int
+fragment (unsigned hash, int shift)
+{
+    return (hash >> shift) & TRIE_MASK;
+}
+
+
+// position of bit among the set bits of bitmap
+static inline int
+bitIndex (unsigned bitmap, unsigned bit)
+{
+    return __builtin_popcount (bitmap & (bit - 1));
+}
+
+
+static YCPMapNode *
+newNode (int nslots, int nnodes)
+{
+    YCPMapNode *node = new YCPMapNode;
+    node->refs = 1;
+    node->datamap = 0;
+    node->nodemap = 0;
+    node->nslots = nslots;
+    node->nnodes = nnodes;
+    node->slots = nslots ? (YCPMapSlot *) ::operator new (nslots * sizeof (YCPMapSlot)) : 0;
+    node->nodes = nnodes ? new YCPMapNode *[nnodes] : 0;
+    return node;
+}
+
+
+static void
+unrefNode (YCPMapNode *node)
+{
+    if (YCPElementRep::unrefShared (node->refs) > 0)
+	return;
+
+    for (int i = 0; i < node->nslots; i++)
+    {
+	node->slots[i].~YCPMapSlot ();
+    }
+    for (int i = 0; i < node->nnodes; i++)
+    {
+	unrefNode (node->nodes[i]);
+    }
+    ::operator delete (node->slots);
+    delete [] node->nodes;
+    delete node;
+}
+
+
+// copy the slots [from, to) of node to copy starting at slot at
+static void
+copySlots (const YCPMapNode *node, int from, int to, YCPMapNode *copy, int at)
+{
+    for (int i = from; i < to; i++)
+    {
+	new (&copy->slots[at++]) YCPMapSlot (node->slots[i]);
+    }
+}
+
+
+// copy the subtries [from, to) of node to copy starting at node at
+static void
+copyNodes (const YCPMapNode *node, int from, int to, YCPMapNode *copy, int at)
+{
+    for (int i = from; i < to; i++)
+    {
+	copy->nodes[at] = node->nodes[i];
+	YCPElementRep::refShared (copy->nodes[at++]->refs);
+    }
+}
+
+
+// return node or a copy of it which is not shared and may be changed,
+// moved is set if the entries had to be copied
+static YCPMapNode *
+ownNode (YCPMapNode *node, bool & moved)
+{
+    if (node->refs == 1)
+	return node;
+
+    YCPMapNode *copy = newNode (node->nslots, node->nnodes);
+    copy->datamap = node->datamap;
+    copy->nodemap = node->nodemap;
+    copySlots (node, 0, node->nslots, copy, 0);
+    copyNodes (node, 0, node->nnodes, copy, 0);
+    unrefNode (node);
+    moved = true;
+    return copy;
+}
+
+
+// node with a new slot at index i (and bit set in datamap)
+static YCPMapNode *
+addSlot (YCPMapNode *node, int i, unsigned bit, const YCPValue & key, const YCPValue & value, unsigned hash)
+{
+    YCPMapNode *copy = newNode (node->nslots + 1, node->nnodes);
+    copy->datamap = node->datamap | bit;
+    copy->nodemap = node->nodemap;
+    copySlots (node, 0, i, copy, 0);
+    new (&copy->slots[i]) YCPMapSlot (key, value, hash);
+    copySlots (node, i, node->nslots, copy, i + 1);
+    copyNodes (node, 0, node->nnodes, copy, 0);
+    unrefNode (node);
+    return copy;
+}
+
+
+// node without the slot at index i (and bit cleared in datamap)
+static YCPMapNode *
+removeSlot (YCPMapNode *node, int i, unsigned bit)
+{
+    YCPMapNode *copy = newNode (node->nslots - 1, node->nnodes);
+    copy->datamap = node->datamap & ~bit;
+    copy->nodemap = node->nodemap;
+    copySlots (node, 0, i, copy, 0);
+    copySlots (node, i + 1, node->nslots, copy, i);
+    copyNodes (node, 0, node->nnodes, copy, 0);
+    unrefNode (node);
+    return copy;
+}
+
+
+// node with the slot for bit replaced by the subtrie sub
+static YCPMapNode *
+slotToNode (YCPMapNode *node, unsigned bit, YCPMapNode *sub)
+{
+    int i = bitIndex (node->datamap, bit);
+    int j = bitIndex (node->nodemap, bit);
+
+    YCPMapNode *copy = newNode (node->nslots - 1, node->nnodes + 1);
+    copy->datamap = node->datamap & ~bit;
+    copy->nodemap = node->nodemap | bit;
+    copySlots (node, 0, i, copy, 0);
+    copySlots (node, i + 1, node->nslots, copy, i);
+    copyNodes (node, 0, j, copy, 0);
+    copy->nodes[j] = sub;
+    copyNodes (node, j, node->nnodes, copy, j + 1);
+    unrefNode (node);
+    return copy;
+}
+
+
+// node with the subtrie for bit (holding a single entry) replaced by a slot
+static YCPMapNode *
+nodeToSlot (YCPMapNode *node, unsigned bit)
+{
+    int i = bitIndex (node->datamap, bit);
+    int j = bitIndex (node->nodemap, bit);
+
+    YCPMapNode *copy = newNode (node->nslots + 1, node->nnodes - 1);
+    copy->datamap = node->datamap | bit;
+    copy->nodemap = node->nodemap & ~bit;
+    copySlots (node, 0, i, copy, 0);
+    copySlots (node->nodes[j], 0, 1, copy, i);
+    copySlots (node, i, node->nslots, copy, i + 1);
+    copyNodes (node, 0, j, copy, 0);
+    copyNodes (node, j + 1, node->nnodes, copy, j);
+    unrefNode (node);
+    return copy;
+}
+
+
+// a new subtrie at level shift holding the entry of slot and key/value
+static YCPMapNode *
+pairNode (const YCPMapSlot & slot, const YCPValue & key, const YCPValue & value, unsigned hash, int shift)
+{
+    if (shift >= HASH_BITS)
+    {
+	// collision node, no bitmaps
+	YCPMapNode *node = newNode (2, 0);
+	new (&node->slots[0]) YCPMapSlot (slot);
+	new (&node->slots[1]) YCPMapSlot (key, value, hash);
+	return node;
+    }
+
+    int f1 = fragment (slot.hash, shift);
+    int f2 = fragment (hash, shift);
+    if (f1 == f2)
+    {
+	YCPMapNode *node = newNode (0, 1);
+	node->nodemap = 1u << f1;
+	node->nodes[0] = pairNode (slot, key, value, hash, shift + TRIE_BITS);
+	return node;
+    }
+
+    YCPMapNode *node = newNode (2, 0);
+    node->datamap = (1u << f1) | (1u << f2);
+    new (&node->slots[f1 < f2 ? 0 : 1]) YCPMapSlot (slot);
+    new (&node->slots[f1 < f2 ? 1 : 0]) YCPMapSlot (key, value, hash);
+    return node;
+}
+
+
+static const YCPMapSlot *
+findTrie (const YCPMapNode *node, const YCPValue & key, unsigned hash)
+{
+    for (int shift = 0; shift < HASH_BITS; shift += TRIE_BITS)
+    {
+	unsigned bit = 1u << fragment (hash, shift);
+	if (node->datamap & bit)
+	{
+	    const YCPMapSlot *slot = &node->slots[bitIndex (node->datamap, bit)];
+	    return (slot->hash == hash && keyEqual (slot->entry.first, key)) ? slot : 0;
+	}
+	if (!(node->nodemap & bit))
+	    return 0;
+	node = node->nodes[bitIndex (node->nodemap, bit)];
+    }
+
+    // collision node
+    for (int i = 0; i < node->nslots; i++)
+    {
+	if (keyEqual (node->slots[i].entry.first, key))
+	    return &node->slots[i];
+    }
+    return 0;
+}
+
+
+// set key to value in the trie node at level shift, returns the
+// changed node. added is set if the key is new, moved if existing
+// entries were copied.
+static YCPMapNode *
+insertTrie (YCPMapNode *node, int shift, const YCPValue & key, const YCPValue & value, unsigned hash, bool & added, bool & moved)
+{
+    if (shift >= HASH_BITS)
+    {
+	for (int i = 0; i < node->nslots; i++)
+	{
+	    if (keyEqual (node->slots[i].entry.first, key))
+	    {
+		node = ownNode (node, moved);
+		node->slots[i].entry.second = value;
+		return node;
+	    }
+	}
+	added = true;
+	moved = true;
+	return addSlot (node, node->nslots, 0, key, value, hash);
+    }
+
+    unsigned bit = 1u << fragment (hash, shift);
+    if (node->datamap & bit)
+    {
+	int i = bitIndex (node->datamap, bit);
+	const YCPMapSlot & slot = node->slots[i];
+	if (slot.hash == hash && keyEqual (slot.entry.first, key))
+	{
+	    node = ownNode (node, moved);
+	    node->slots[i].entry.second = value;
+	    return node;
+	}
+
+	added = true;
+	moved = true;
+	return slotToNode (node, bit, pairNode (slot, key, value, hash, shift + TRIE_BITS));
+    }
+
+    if (node->nodemap & bit)
+    {
+	node = ownNode (node, moved);
+	int j = bitIndex (node->nodemap, bit);
+	node->nodes[j] = insertTrie (node->nodes[j], shift + TRIE_BITS, key, value, hash, added, moved);
+	return node;
+    }
+
+    added = true;
+    moved = true;
+    return addSlot (node, bitIndex (node->datamap, bit), bit, key, value, hash);
+}
+
+
+// remove key (which must exist) from the trie node at level shift,
+// returns the changed node
+static YCPMapNode *
+eraseTrie (YCPMapNode *node, int shift, const YCPValue & key, unsigned hash)
+{
+    if (shift >= HASH_BITS)
+    {
+	int i = 0;
+	while (!keyEqual (node->slots[i].entry.first, key))
+	    i++;
+	return removeSlot (node, i, 0);
+    }
+
+    unsigned bit = 1u << fragment (hash, shift);
+    if (node->datamap & bit)
+    {
+	return removeSlot (node, bitIndex (node->datamap, bit), bit);
+    }
+
+    bool moved = false;
+    node = ownNode (node, moved);
+    int j = bitIndex (node->nodemap, bit);
+    YCPMapNode *sub = eraseTrie (node->nodes[j], shift + TRIE_BITS, key, hash);
+    node->nodes[j] = sub;
+
+    // a single entry moves up, so every entry is stored at the
+    // lowest level where its hash is unique
+    if (sub->nslots == 1 && sub->nnodes == 0)
+    {
+	node = nodeToSlot (node, bit);
+    }
+    return node;
+}
+
+
+static void
+collectEntries (const YCPMapNode *node, vector<const YCPMapEntry *> & entries)
+{
+    for (int i = 0; i < node->nslots; i++)
+    {
+	entries.push_back (&node->slots[i].entry);
+    }
+    for (int i = 0; i < node->nnodes; i++)
+    {
+	collectEntries (node->nodes[i], entries);
+    }
+}
+
+
+static unsigned long long
+trieHash (const YCPMapNode *node)
+{
+    unsigned long long sum = 0;
+    for (int i = 0; i < node->nslots; i++)
+    {
+	const YCPMapSlot & slot = node->slots[i];
+	sum += YCPValueRep::hashEntry (slot.hash, slot.entry.second->hash ());
+    }
+    for (int i = 0; i < node->nnodes; i++)
+    {
+	sum += trieHash (node->nodes[i]);
+    }
+    return sum;
+}
+
+
+// orders pointers to entries by key
+struct EntryLess
+{
+    YCPMapKeyLess less;
+
+    EntryLess (const YCPMapKeyLess & l) : less (l) {}
+
+    bool operator() (const YCPMapEntry *e1, const YCPMapEntry *e2) const
+    {
+	return less (e1->first, e2->first);
+    }
+};
+
+
+// YCPMapKeyLess
+
+bool
+YCPMapKeyLess::operator() (const YCPValue& k1, const YCPValue& k2) const
+{
+    // same results as YCPStringRep::compare () and YCPIntegerRep::compare ()
+    switch (*m_keytype)
+    {
+	case YT_STRING:
+	    return static_cast<const YCPStringRep *> (k1.operator-> ())->value ()
+		< static_cast<const YCPStringRep *> (k2.operator-> ())->value ();
+	case YT_INTEGER:
+	    return static_cast<const YCPIntegerRep *> (k1.operator-> ())->value ()
+		< static_cast<const YCPIntegerRep *> (k2.operator-> ())->value ();
+	default:
+	    return k1->compare (k2) == YO_LESS;
+    }
+}
+
+
 // YCPMapRep
 
 YCPMapRep::YCPMapRep()
+    : m_keytype (YT_VOID)
+    , stl_map (YCPMapKeyLess (&m_keytype))
+    , m_trie (0)
+    , m_size (0)
+    , m_order (0)
 {
 }
 
 
+YCPMapRep::~YCPMapRep()
+{
+    dropOrder ();
+    if (m_trie)
+	unrefNode (m_trie);
+}
+
+
+void
+YCPMapRep::toTrie ()
+{
+    m_trie = newNode (0, 0);
+    m_size = 0;
+    for (YCPSmallMap::const_iterator pos = stl_map.begin(); pos != stl_map.end(); ++pos)
+    {
+	bool added = false, moved = false;
+	m_trie = insertTrie (m_trie, 0, pos->first, pos->second, pos->first->hash (), added, moved);
+	m_size++;
+    }
+    stl_map.clear ();
+}
+
+
+void
+YCPMapRep::fromTrie ()
+{
+    const YCPMapOrder *sorted = order ();
+    for (size_t i = 0; i < sorted->entries.size (); i++)
+    {
+	stl_map.insert (stl_map.end (), *sorted->entries[i]);
+    }
+    dropOrder ();
+    unrefNode (m_trie);
+    m_trie = 0;
+    m_size = 0;
+}
+
+
+const YCPMapOrder *
+YCPMapRep::order () const
+{
+    if (m_order == 0)
+    {
+	YCPMapOrder *order = new YCPMapOrder;
+	order->refs = 1;
+	order->entries.reserve (m_size);
+	collectEntries (m_trie, order->entries);
+	std::sort (order->entries.begin (), order->entries.end (), EntryLess (YCPMapKeyLess (&m_keytype)));
+
+	// threads evaluating in parallel may race here, the first
+	// complete order wins
+	if (!__sync_bool_compare_and_swap (&m_order, (YCPMapOrder *) 0, order))
+	    delete order;
+    }
+    return m_order;
+}
+
+
+void
+YCPMapRep::dropOrder ()
+{
+    if (m_order && YCPElementRep::unrefShared (m_order->refs) == 0)
+	delete m_order;
+    m_order = 0;
+}
+
+
 YCPMapIterator
 YCPMapRep::begin() const
 {
+    if (m_trie)
+	return &order ()->entries[0];
     return stl_map.begin();
 }
 
@@ -43,6 +550,8 @@ YCPMapRep::begin() const
 YCPMapIterator
 YCPMapRep::end() const
 {
+    if (m_trie)
+	return &order ()->entries[0] + m_size;
     return stl_map.end();
 }
 
@@ -58,12 +567,32 @@ YCPMapRep::add (const YCPValue& key, const YCPValue& value)
 	return;
     }
 
+    // a key of another type switches to the generic comparison
+    // before it is compared with the others
+    YCPValueType keytype = key->valuetype();
+    if (keytype != m_keytype)
+    {
+	m_keytype = (m_keytype == YT_VOID) ? keytype : YT_ERROR;
+    }
+
+    if (m_trie)
+    {
+	bool added = false, moved = false;
+	m_trie = insertTrie (m_trie, 0, key, value, key->hash (), added, moved);
+	if (added)
+	    m_size++;
+	// the order stays valid as long as the entries did not move
+	if (moved)
+	    dropOrder ();
+	return;
+    }
+
     // Note: 'stl_map[key] = value' would create a temporary object using the
     // default constructor for YCPValue. See Scott Meyers, Effective STL, Item
     // 24.
 
-    YCPMap::iterator pos = stl_map.lower_bound(key);
-    if (pos != stl_map.end() && !YCPMap::key_compare()(key, pos->first))
+    YCPSmallMap::iterator pos = stl_map.lower_bound(key);
+    if (pos != stl_map.end() && !stl_map.key_comp()(key, pos->first))
     {
 	pos->second = value;
     }
@@ -71,6 +600,9 @@ YCPMapRep::add (const YCPValue& key, const YCPValue& value)
     {
 	// pos is just a hint but can avoid a second search through the map
 	stl_map.insert(pos, YCPMap::value_type(key, value));
+
+	if (stl_map.size() >= TRIE_MIN)
+	    toTrie ();
     }
 
 }
@@ -88,16 +620,10 @@ YCPMapRep::functionalAdd (const YCPValue& key, const YCPValue& value) const
 	return YCPNull ();
     }
 
-    YCPMap newmap;
-
-    for (YCPMap::const_iterator pos = begin(); pos != end(); ++pos)
-    {
-	newmap->add(pos->first, pos->second);
-    }
-
-    newmap->add( key, value );
+    YCPMapRep *newmap = const_cast<YCPMapRep *> (static_cast<const YCPMapRep *> (shallowCopy ()));
+    newmap->add (key, value);
 
-    return newmap;
+    return newmap->asMap ();
 }
 
 
@@ -109,16 +635,49 @@ void YCPMapRep::remove(const YCPValue& key)
         return;
     }
 
+    if (!mayHaveKey (key))
+	return;
+
+    if (m_trie)
+    {
+	unsigned hash = key->hash ();
+	if (findTrie (m_trie, key, hash) == 0)
+	    return;
+
+	m_trie = eraseTrie (m_trie, 0, key, hash);
+	m_size--;
+	dropOrder ();
+	if (m_size < TRIE_MIN / 4)
+	    fromTrie ();
+	return;
+    }
+
     stl_map.erase (key);
+
+    if (stl_map.empty())
+	m_keytype = YT_VOID;
 }
 
 
 const YCPElementRep* YCPMapRep::shallowCopy() const
 {
     YCPMapRep* newmap = new YCPMapRep ();
+    newmap->m_keytype = m_keytype;
 
-    for (YCPMap::const_iterator pos = begin(); pos != end(); ++pos)
-	newmap->add(pos->first, pos->second);
+    if (m_trie)
+    {
+	// share the trie and its order until one of the maps changes
+	newmap->m_trie = m_trie;
+	YCPElementRep::refShared (m_trie->refs);
+	newmap->m_size = m_size;
+	newmap->m_order = m_order;
+	if (m_order)
+	    YCPElementRep::refShared (m_order->refs);
+    }
+    else
+    {
+	newmap->stl_map.insert (stl_map.begin (), stl_map.end ());
+    }
 
     return newmap;
 }
@@ -127,20 +686,26 @@ const YCPElementRep* YCPMapRep::shallowCopy() const
 bool
 YCPMapRep::isEmpty() const
 {
-    return stl_map.empty();
+    return size() == 0;
 }
 
 
 long
 YCPMapRep::size() const
 {
-    return stl_map.size();
+    return m_trie ? m_size : stl_map.size();
 }
 
 
 bool
 YCPMapRep::hasKey(const YCPValue& key) const
 {
+    if (!mayHaveKey (key))
+	return false;
+
+    if (m_trie)
+	return findTrie (m_trie, key, key->hash ()) != 0;
+
     return stl_map.find(key) != stl_map.end();
 }
 
@@ -148,15 +713,37 @@ YCPMapRep::hasKey(const YCPValue& key) const
 YCPValue
 YCPMapRep::value(const YCPValue& key) const
 {
-    YCPMap::const_iterator pos = stl_map.find(key);
+    if (!mayHaveKey (key))
+	return YCPNull();
+
+    if (m_trie)
+    {
+	const YCPMapSlot *slot = findTrie (m_trie, key, key->hash ());
+	return slot ? slot->entry.second : YCPNull();
+    }
 
-    if (pos != end())
+    YCPSmallMap::const_iterator pos = stl_map.find(key);
+
+    if (pos != stl_map.end())
 	return pos->second;
     else
 	return YCPNull();
 }
 
 
+unsigned long long
+YCPMapRep::entriesHash() const
+{
+    if (m_trie)
+	return trieHash (m_trie);
+
+    unsigned long long sum = 0;
+    for (YCPSmallMap::const_iterator pos = stl_map.begin(); pos != stl_map.end(); ++pos)
+	sum += hashEntry (pos->first->hash (), pos->second->hash ());
+    return sum;
+}
+
+
 YCPOrder
 YCPMapRep::compare(const YCPMap& m) const
 {
@@ -229,7 +816,7 @@ YCPMapRep::valuetype() const
 std::ostream &
 YCPMapRep::toStream (std::ostream & str) const
 {
-    Bytecode::writeInt32 (str, stl_map.size());
+    Bytecode::writeInt32 (str, size());
     for (YCPMap::const_iterator pos = begin(); pos != end(); ++pos)
     {
 	if (!Bytecode::writeValue (str, pos->first))
@@ -244,7 +831,7 @@ YCPMapRep::toStream (std::ostream & str) const
 std::ostream &
 YCPMapRep::toXml (std::ostream & str, int indent ) const
 {
-    str << "<map size=\"" << stl_map.size() << "\">";
+    str << "<map size=\"" << size() << "\">";
     for (YCPMap::const_iterator pos = begin(); pos != end(); ++pos)
     {
 	str << "<element>";
@@ -0,0 +1,311 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCPParallel.cc
+
+   Parallel evaluation of the blocks of list and map builtins
+
+/-*/
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "ycp/YCPParallel.h"
+#include "ycp/YCPInterpreterContext.h"
+#include "ycp/YCode.h"
+#include "ycp/YCPBoolean.h"
+#include "ycp/YCPVoid.h"
+#include "ycp/Profiler.h"
+#include "ycp/y2log.h"
+
+class Debugger;
+extern Debugger *debugger_instance;
+
+using std::vector;
+
+// fewer elements are evaluated serially, starting the
+// threads costs more than it saves
+#define PARALLEL_MIN 256
+
+// elements taken by a thread at once
+#define CHUNK 16
+
+#define MAX_THREADS 64
+
+static const char *Y2PARALLEL = "Y2PARALLEL";
+
+
+// one parallel evaluation
+struct Job
+{
+    YCode *code;
+    int entries;			// number of loop variables, 1 or 2
+    const SymbolEntry *entry[2];
+    const vector<YCPValue> *values[2];	// their values per element
+    vector<YCPValue> *results;
+    YCPInterpreterContext *context;	// of the caller, the other values are read there
+    SymbolEntry::FrameStack *frames;	// of the caller, for its local variables
+    int size;
+    int next;				// next element to evaluate
+};
+
+// only one evaluation uses the threads at a time, others (from other
+// threads of the program) evaluate serially
+static pthread_mutex_t run_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+static int pool_threads = 0;		// including the caller, 0 if not started yet
+static Job *current_job = 0;
+static unsigned long generation = 0;	// counts the jobs
+static int busy = 0;			// workers not done with the current job
+
+
+static void
+runJob (Job *job)
+{
+    SymbolEntry::Binding bindings[3];
+    for (int e = 0; e < job->entries; e++)
+    {
+	bindings[e].entry = job->entry[e];
+    }
+    bindings[job->entries].entry = 0;
+
+    YCPInterpreterContext::Scope scope (job->context);
+    SymbolEntry::_frames = job->frames;
+    SymbolEntry::_bindings = bindings;
+
+    while (true)
+    {
+	int start = __sync_fetch_and_add (&job->next, CHUNK);
+	if (start >= job->size)
+	    break;
+
+	int end = start + CHUNK < job->size ? start + CHUNK : job->size;
+	for (int i = start; i < end; i++)
+	{
+	    for (int e = 0; e < job->entries; e++)
+	    {
+		bindings[e].value = (*job->values[e])[i];
+	    }
+	    (*job->results)[i] = job->code->evaluate ();
+	}
+    }
+
+    SymbolEntry::_bindings = 0;
+}
+
+
+static void *
+worker (void *)
+{
+    unsigned long seen = 0;
+
+    pthread_mutex_lock (&pool_mutex);
+    while (true)
+    {
+	while (generation == seen)
+	{
+	    pthread_cond_wait (&work_cond, &pool_mutex);
+	}
+	seen = generation;
+	Job *job = current_job;
+	pthread_mutex_unlock (&pool_mutex);
+
+	runJob (job);
+
+	pthread_mutex_lock (&pool_mutex);
+	if (--busy == 0)
+	{
+	    pthread_cond_signal (&done_cond);
+	}
+    }
+
+    return 0;
+}
+
+
+// run_mutex is locked
+static void
+startPool ()
+{
+    int wanted;
+    const char *s = getenv (Y2PARALLEL);
+    if (s != 0 && *s != 0)
+    {
+	wanted = atoi (s);
+    }
+    else
+    {
+	wanted = sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+    if (wanted > MAX_THREADS)
+	wanted = MAX_THREADS;
+
+    // create the shared constants now, not racing in the threads
+    YCPBoolean (true);
+    YCPBoolean (false);
+    YCPVoid ();
+
+    pool_threads = 1;
+    while (pool_threads < wanted)
+    {
+	pthread_t thread;
+	if (pthread_create (&thread, 0, worker, 0) != 0)
+	{
+	    y2warning ("Cannot start thread for parallel evaluation: %m");
+	    break;
+	}
+	pthread_detach (thread);
+	pool_threads++;
+    }
+
+    y2debug ("Parallel evaluation with %d threads", pool_threads);
+}
+
+
+// is evaluating code for size elements in parallel possible and useful?
+static bool
+qualifies (const YCPCode & code, int size)
+{
+    return size >= PARALLEL_MIN
+	&& debugger_instance == 0
+	&& profiler_instance == 0
+	&& code->code ()->isPure ();
+}
+
+
+static bool
+run (Job & job)
+{
+    if (pthread_mutex_trylock (&run_mutex) != 0)
+    {
+	return false;
+    }
+
+    if (pool_threads == 0)
+    {
+	startPool ();
+    }
+
+    if (pool_threads < 2)
+    {
+	pthread_mutex_unlock (&run_mutex);
+	return false;
+    }
+
+    job.results->assign (job.size, YCPNull ());
+    job.context = YCPInterpreterContext::current ();
+    job.frames = SymbolEntry::_frames;
+    job.next = 0;
+
+    // atomically, interpreter contexts on other threads change them too
+    __sync_add_and_fetch (&Rep::_atomic, 1);
+    __sync_add_and_fetch (&YCPElementRep::_atomic, 1);
+
+    pthread_mutex_lock (&pool_mutex);
+    current_job = &job;
+    busy = pool_threads - 1;
+    generation++;
+    pthread_cond_broadcast (&work_cond);
+    pthread_mutex_unlock (&pool_mutex);
+
+    runJob (&job);
+
+    pthread_mutex_lock (&pool_mutex);
+    while (busy > 0)
+    {
+	pthread_cond_wait (&done_cond, &pool_mutex);
+    }
+    current_job = 0;
+    pthread_mutex_unlock (&pool_mutex);
+
+    __sync_sub_and_fetch (&YCPElementRep::_atomic, 1);
+    __sync_sub_and_fetch (&Rep::_atomic, 1);
+
+    pthread_mutex_unlock (&run_mutex);
+    return true;
+}
+
+
+bool
+YCPParallel::evaluate (const YCPCode & code, const YCPList & list,
+		       const SymbolEntryPtr & entry, vector<YCPValue> & results)
+{
+    if (!qualifies (code, list->size ()))
+    {
+	return false;
+    }
+
+    vector<YCPValue> values (list->begin (), list->end ());
+
+    Job job;
+    job.code = &*code->code ();
+    job.entries = 1;
+    job.entry[0] = &*entry;
+    job.values[0] = &values;
+    job.results = &results;
+    job.size = values.size ();
+
+    return run (job);
+}
+
+
+bool
+YCPParallel::evaluate (const YCPCode & code, const YCPMap & map,
+		       const SymbolEntryPtr & keyentry, const SymbolEntryPtr & valueentry,
+		       vector<YCPValue> & results)
+{
+    if (!qualifies (code, map->size ()))
+    {
+	return false;
+    }
+
+    vector<YCPValue> keys, values;
+    keys.reserve (map->size ());
+    values.reserve (map->size ());
+    for (YCPMap::const_iterator pos = map->begin (); pos != map->end (); ++pos)
+    {
+	keys.push_back (pos->first);
+	values.push_back (pos->second);
+    }
+
+    Job job;
+    job.code = &*code->code ();
+    job.entries = 2;
+    job.entry[0] = &*keyentry;
+    job.entry[1] = &*valueentry;
+    job.values[0] = &keys;
+    job.values[1] = &values;
+    job.results = &results;
+    job.size = keys.size ();
+
+    return run (job);
+}
+
+
+int
+YCPParallel::threads ()
+{
+    pthread_mutex_lock (&run_mutex);
+    if (pool_threads == 0)
+    {
+	startPool ();
+    }
+    int n = pool_threads;
+    pthread_mutex_unlock (&run_mutex);
+    return n;
+}
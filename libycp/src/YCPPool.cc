@@ -0,0 +1,325 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCPPool.cc
+
+   Allocator for YCPElementRep and its subclasses
+
+/-*/
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <new>
+#include <vector>
+
+#include "ycp/YCPPool.h"
+#include "ycp/YCPValue.h"
+
+#include <y2util/y2log.h>
+
+// size classes of GRANULE bytes up to MAX_POOLED
+#define GRANULE 8
+#define MAX_POOLED 256
+#define CLASSES (MAX_POOLED / GRANULE)
+
+// bytes taken from the system allocator per refill
+#define BLOCKSIZE 8192
+
+// the counters are not atomic, they are approximate if values
+// are created by several threads at once
+static unsigned long live_objects[YCPPool::types];
+static unsigned long total_objects[YCPPool::types];
+
+#ifdef YCP_VALUE_POOL
+
+struct FreeObject
+{
+    FreeObject *next;
+};
+
+struct FreeList
+{
+    FreeObject *first;
+    size_t count;
+};
+
+static __thread FreeList freelists[CLASSES];
+
+// objects given back by the threads, in batches any thread can take
+//  over in one step, see release () and reuse ()
+typedef std::vector<FreeList> batches_t;
+static batches_t *shared = 0;
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// the batches of size class c, call with shared_mutex held
+static batches_t &
+batches (size_t c)
+{
+    // not a static object, values are still freed while the static
+    //  objects are destroyed at exit
+    if (shared == 0)
+    {
+	shared = new batches_t[CLASSES];
+    }
+    return shared[c];
+}
+
+// a thread registers when it first allocates, to give its free lists
+//  back when it exits
+static pthread_key_t exit_key;
+static pthread_once_t exit_once = PTHREAD_ONCE_INIT;
+static __thread bool registered = false;
+
+// objects of size class c per block
+static inline size_t
+perBlock (size_t c)
+{
+    return BLOCKSIZE / ((c + 1) * GRANULE);
+}
+
+
+// give the first count objects of the free list of size class c to
+//  the shared batches
+static void
+release (size_t c, size_t count)
+{
+    FreeList batch = freelists[c];
+    FreeObject *last = batch.first;
+    for (size_t i = 1; i < count; i++)
+    {
+	last = last->next;
+    }
+    freelists[c].first = last->next;
+    freelists[c].count -= count;
+    last->next = 0;
+    batch.count = count;
+
+    pthread_mutex_lock (&shared_mutex);
+    batches (c).push_back (batch);
+    pthread_mutex_unlock (&shared_mutex);
+}
+
+
+// at thread exit, give all free objects to the shared batches
+static void
+releaseAll (void *)
+{
+    for (size_t c = 0; c < CLASSES; c++)
+    {
+	if (freelists[c].count > 0)
+	{
+	    release (c, freelists[c].count);
+	}
+    }
+}
+
+
+static void
+createExitKey ()
+{
+    pthread_key_create (&exit_key, releaseAll);
+}
+
+
+// take a shared batch of size class c, false if there is none
+static bool
+reuse (size_t c)
+{
+    pthread_mutex_lock (&shared_mutex);
+    batches_t & b = batches (c);
+    bool found = !b.empty ();
+    if (found)
+    {
+	freelists[c] = b.back ();
+	b.pop_back ();
+    }
+    pthread_mutex_unlock (&shared_mutex);
+    return found;
+}
+
+
+// have the free lists of this thread released at its exit
+static void
+enroll ()
+{
+    if (!registered)
+    {
+	pthread_once (&exit_once, createExitKey);
+	pthread_setspecific (exit_key, &registered);
+	registered = true;
+    }
+}
+
+
+// carve a new block into objects of size class c
+static void
+refill (size_t c)
+{
+    enroll ();
+
+    if (reuse (c))
+    {
+	return;
+    }
+
+    size_t size = (c + 1) * GRANULE;
+    size_t count = perBlock (c);
+    char *block = (char *) ::operator new (count * size);
+
+    for (size_t i = 0; i < count - 1; i++)
+    {
+	((FreeObject *) (block + i * size))->next = (FreeObject *) (block + (i + 1) * size);
+    }
+    ((FreeObject *) (block + (count - 1) * size))->next = 0;
+
+    freelists[c].first = (FreeObject *) block;
+    freelists[c].count = count;
+}
+
+#endif
+
+
+void *
+YCPPool::allocate (size_t size, int type)
+{
+    live_objects[type]++;
+    total_objects[type]++;
+
+#ifdef YCP_VALUE_POOL
+    if (size <= MAX_POOLED)
+    {
+	size_t c = (size - 1) / GRANULE;
+	if (freelists[c].first == 0)
+	{
+	    refill (c);
+	}
+	FreeObject *obj = freelists[c].first;
+	freelists[c].first = obj->next;
+	freelists[c].count--;
+	return obj;
+    }
+#endif
+
+    return ::operator new (size);
+}
+
+
+void
+YCPPool::deallocate (void *ptr, size_t size, int type)
+{
+    if (ptr == 0)
+	return;
+
+    live_objects[type]--;
+
+#ifdef YCP_VALUE_POOL
+    if (size <= MAX_POOLED)
+    {
+	// objects allocated in other threads end up here too, a thread
+	//  freeing more than it allocates passes them on
+	size_t c = (size - 1) / GRANULE;
+	FreeObject *obj = (FreeObject *) ptr;
+	obj->next = freelists[c].first;
+	freelists[c].first = obj;
+	if (++freelists[c].count == 1)
+	{
+	    enroll ();
+	}
+	else if (freelists[c].count >= 2 * perBlock (c))
+	{
+	    release (c, perBlock (c));
+	}
+	return;
+    }
+#endif
+
+    ::operator delete (ptr);
+}
+
+
+unsigned long
+YCPPool::live (int type)
+{
+    return live_objects[type];
+}
+
+
+static const char *
+typeName (int type)
+{
+    switch (type)
+    {
+	case YT_VOID:		return "void";
+	case YT_BOOLEAN:	return "boolean";
+	case YT_INTEGER:	return "integer";
+	case YT_FLOAT:		return "float";
+	case YT_STRING:		return "string";
+	case YT_BYTEBLOCK:	return "byteblock";
+	case YT_PATH:		return "path";
+	case YT_SYMBOL:		return "symbol";
+	case YT_LIST:		return "list";
+	case YT_TERM:		return "term";
+	case YT_MAP:		return "map";
+	case YT_CODE:		return "code";
+	case YT_RETURN:		return "return";
+	case YT_BREAK:		return "break";
+	case YT_ENTRY:		return "entry";
+	case YT_ERROR:		return "error";
+	case YT_REFERENCE:	return "reference";
+	case YT_EXTERNAL:	return "external";
+    }
+    return "other";
+}
+
+
+void
+YCPPool::dump ()
+{
+#ifdef YCP_VALUE_POOL
+    y2milestone ("YCP values (pooled): live / total");
+#else
+    y2milestone ("YCP values (system allocator): live / total");
+#endif
+    for (int type = 0; type < types; type++)
+    {
+	if (total_objects[type] > 0)
+	{
+	    y2milestone ("%-10s %10lu / %lu", typeName (type), live_objects[type], total_objects[type]);
+	}
+    }
+}
+
+
+void
+YCPPoolDump ()
+{
+    YCPPool::dump ();
+}
+
+
+static void
+dumpAtExit ()
+{
+    YCPPool::dump ();
+}
+
+// register the exit dump if requested
+static struct PoolStats
+{
+    PoolStats ()
+    {
+	if (getenv ("Y2POOLSTATS") != 0)
+	{
+	    atexit (dumpAtExit);
+	}
+    }
+} poolStats;
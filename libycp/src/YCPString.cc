@@ -31,14 +31,14 @@
 // YCPStringRep
 
 YCPStringRep::YCPStringRep(const string& s)
-    : v(s), is_ascii(false)
+    : v(s), is_ascii(false), m_hash(0)
 {
     is_ascii = all_of(v.begin(), v.end(), isascii);
 }
 
 
 YCPStringRep::YCPStringRep(const wstring& s)
-    : v(), is_ascii(false)
+    : v(), is_ascii(false), m_hash(0)
 {
     wchar2utf8(s, &v);
     is_ascii = all_of(v.begin(), v.end(), isascii);
@@ -59,6 +59,26 @@ YCPStringRep::value() const
 }
 
 
+unsigned
+YCPStringRep::hash() const
+{
+    // strings are used as map keys over and over, so the
+    // hash is kept (0 is reserved for 'not computed')
+    unsigned h = m_hash;
+    if (h == 0)
+    {
+	h = hashBytes (v.data (), v.size ());
+	if (h == 0)
+	    h = 1;
+
+	// threads evaluating in parallel may race here, they all
+	// store the same hash
+	__sync_bool_compare_and_swap (&m_hash, 0u, h);
+    }
+    return h;
+}
+
+
 wstring
 YCPStringRep::wvalue() const
 {
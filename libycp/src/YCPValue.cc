@@ -306,6 +306,112 @@ YCPValueRep::compare (const YCPValue& v, bool rl) const
     return valuetype() < v->valuetype() ? YO_LESS : YO_GREATER;
 }
 
+// final mix of a hash, every input bit affects all output bits
+static unsigned
+finishHash (unsigned long long h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (unsigned) h;
+}
+
+
+static inline unsigned long long
+combineHash (unsigned long long h, unsigned v)
+{
+    return (h ^ v) * 1099511628211ULL;
+}
+
+
+unsigned
+YCPValueRep::hashBytes (const void *data, size_t len)
+{
+    // FNV-1a
+    const unsigned char *p = (const unsigned char *) data;
+    unsigned long long h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+	h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return finishHash (h);
+}
+
+
+unsigned
+YCPValueRep::hashEntry (unsigned key, unsigned value)
+{
+    return finishHash (combineHash (key, value));
+}
+
+
+unsigned
+YCPValueRep::hash () const
+{
+    unsigned long long h = 14695981039346656037ULL ^ valuetype ();
+
+    switch (valuetype ())
+    {
+	case YT_BOOLEAN:
+	    return finishHash (combineHash (h, asBoolean ()->value ()));
+	case YT_INTEGER:
+	    return finishHash (combineHash (h, 0) + asInteger ()->value ());
+	case YT_FLOAT:
+	{
+	    // 0.0 == -0.0
+	    double d = asFloat ()->value ();
+	    if (d == 0.0)
+		d = 0.0;
+	    return finishHash (combineHash (h, hashBytes (&d, sizeof (d))));
+	}
+	case YT_STRING:
+	    return asString ()->hash ();
+	case YT_BYTEBLOCK:
+	{
+	    YCPByteblock b = asByteblock ();
+	    return finishHash (combineHash (h, hashBytes (b->value (), b->size ())));
+	}
+	case YT_PATH:
+	{
+	    string s = toString ();
+	    return finishHash (combineHash (h, hashBytes (s.data (), s.size ())));
+	}
+	case YT_SYMBOL:
+	{
+	    string s = asSymbol ()->symbol ();
+	    return finishHash (combineHash (h, hashBytes (s.data (), s.size ())));
+	}
+	case YT_LIST:
+	{
+	    YCPList l = asList ();
+	    for (YCPList::const_iterator it = l->begin (); it != l->end (); ++it)
+		h = combineHash (h, (*it)->hash ());
+	    return finishHash (h);
+	}
+	case YT_TERM:
+	{
+	    YCPTerm t = asTerm ();
+	    string name = t->name ();
+	    YCPValue args = t->args ();
+	    h = combineHash (h, hashBytes (name.data (), name.size ()));
+	    return finishHash (combineHash (h, args->hash ()));
+	}
+	case YT_MAP:
+	{
+	    // the sum does not depend on the order, so no need to sort
+	    //  the entries of a large map for begin ()
+	    return finishHash (combineHash (h, 0) + asMap ()->entriesHash ());
+	}
+	default:
+	    // void, code, references: only the type
+	    break;
+    }
+    return finishHash (h);
+}
+
+
 /**
  * Default constructor, sets the value to YCPNull().
  */
@@ -23,6 +23,7 @@
 #endif
 
 #include <libintl.h>
+#include <sstream>
 
 #include "ycp/YCode.h"
 #include "ycp/YCPVoid.h"
@@ -42,6 +43,7 @@
 
 #include "ycp/Bytecode.h"
 #include "ycp/Xmlcode.h"
+#include "y2/Y2Namespace.h"
 
 #include "ycp/y2log.h"
 #include "ycp/ExecutionEnvironment.h"
@@ -101,6 +103,13 @@ YCode::isReferenceable () const
 }
 
 
+bool
+YCode::isPure () const
+{
+    return false;
+}
+
+
 string
 YCode::toString (ykind kind)
 {
@@ -223,6 +232,29 @@ YCode::evaluate (bool /*cse*/)
 }
 
 
+YCodePtr
+YCode::optimize (int & /*removed*/)
+{
+    return this;
+}
+
+
+void
+YCode::optimizeChild (YCodePtr & code, int & removed)
+{
+    if (code == 0)
+    {
+	return;
+    }
+
+    YCodePtr optimized = code->optimize (removed);
+    if (optimized != 0)
+    {
+	code = optimized;
+    }
+}
+
+
 constTypePtr
 YCode::type () const
 {
@@ -387,6 +419,37 @@ YConst::evaluate (bool /*cse*/)
 }
 
 
+YCodePtr
+YConst::create (const YCPValue & value)
+{
+    if (value.isNull ())
+    {
+	return 0;
+    }
+
+    ykind kind;
+    switch (value->valuetype ())
+    {
+	case YT_VOID:		kind = ycVoid; break;
+	case YT_BOOLEAN:	kind = ycBoolean; break;
+	case YT_INTEGER:	kind = ycInteger; break;
+	case YT_FLOAT:		kind = ycFloat; break;
+	case YT_STRING:		kind = ycString; break;
+	case YT_BYTEBLOCK:	kind = ycByteblock; break;
+	case YT_PATH:		kind = ycPath; break;
+	case YT_SYMBOL:		kind = ycSymbol; break;
+	case YT_LIST:		kind = ycList; break;
+	case YT_MAP:		kind = ycMap; break;
+	case YT_TERM:		kind = ycTerm; break;
+	default:
+	    // code, references, ... are no constants
+	    return 0;
+    }
+
+    return new YConst (kind, value);
+}
+
+
 std::ostream &
 YConst::toStream (std::ostream & str) const
 {
@@ -452,7 +515,8 @@ YLocale::YLocale (const char *locale, const char *textdomain)
 {
     if (domains.find (textdomain) == domains.end ())
     {
-	domains.insert (std::make_pair(textdomain,false));
+	// the textdomain of the parser lives in the code, keep a copy
+	domains.insert (std::make_pair(strdup (textdomain),false));
     }
 
     m_domain = domains.find (textdomain);
@@ -589,6 +653,7 @@ YFunction::YFunction (YBlockPtr declaration, const SymbolEntryPtr entry)
     : YCode ()
     , m_declaration (declaration)
     , m_definition (0)
+    , m_lazy (0)
     , m_is_global (entry ? entry->isGlobal() : true)
 {
 }
@@ -596,16 +661,46 @@ YFunction::YFunction (YBlockPtr declaration, const SymbolEntryPtr entry)
 
 YFunction::~YFunction ()
 {
+    delete m_lazy;
 }
 
 
 YCodePtr
 YFunction::definition() const
 {
+    if (m_lazy != 0)
+    {
+	readDefinition ();
+    }
     return m_definition;
 }
 
 
+void
+YFunction::readDefinition () const
+{
+    // other threads may want it at the same time
+    Y2Namespace::LoadLock lock;
+
+    if (m_lazy == 0)
+    {
+	return;
+    }
+
+    YCodePtr def = m_lazy->read ();
+    if (def != 0
+	&& def->isBlock ())
+    {
+	((YBlockPtr)def)->setKind (YBlock::b_definition);
+    }
+    m_definition = def;
+
+    delete m_lazy;
+    __sync_synchronize ();
+    m_lazy = 0;
+}
+
+
 YBlockPtr
 YFunction::declaration() const
 {
@@ -639,24 +734,35 @@ YFunction::setDefinition (bytecodeistream & str)
 #if DO_DEBUG
 	y2debug ("YFunction::YFunction: have definition!");
 #endif
+	// in a section of its own, see toStreamDefinition
+	u_int32_t body = str.hasSections () ? Bytecode::readInt32 (str) : 0;
 
 	if (m_declaration != 0)
 	{
 	    Bytecode::pushNamespace (m_declaration->nameSpace());
 	}
 	
-	YBlockPtr def = (YBlockPtr)Bytecode::readCode (str);
-	def->setKind (YBlock::b_definition);
+	if (body != 0)
+	{
+	    // read on first use, with the namespaces pushed now
+	    m_lazy = new LazyDefinition (str, body);
+	}
+	else
+	{
+	    YBlockPtr def = (YBlockPtr)Bytecode::readCode (str);
+	    def->setKind (YBlock::b_definition);
 
-	m_definition = def;
+	    m_definition = def;
+	}
 
 	if (m_declaration != 0)
 	{
 	    Bytecode::popNamespace (m_declaration->nameSpace());
 	}
 
-	if ((m_definition == 0)
-	    || (!m_definition->isBlock()))
+	if ((m_lazy == 0)
+	    && ((m_definition == 0)
+		|| (!m_definition->isBlock())))
 	{
 	    y2error ("Error reading definition");
 	}
@@ -672,6 +778,17 @@ YFunction::setDefinition (bytecodeistream & str)
 }
 
 
+YCodePtr
+YFunction::optimize (int & removed)
+{
+    if (m_definition != 0)
+    {
+	m_definition->optimize (removed);
+    }
+    return this;
+}
+
+
 unsigned int
 YFunction::parameterCount (void) const
 {
@@ -709,10 +826,11 @@ string
 YFunction::toString() const
 {
     string  s = toStringDeclaration ();
-    if (m_definition != 0)
+    YCodePtr def = definition ();
+    if (def != 0)
     {
 	s += "\n";
-	s += m_definition->toString();
+	s += def->toString();
     }
 
     return s;
@@ -737,6 +855,7 @@ YFunction::YFunction (bytecodeistream & str)
     : YCode ()
     , m_declaration (0)
     , m_definition (0)
+    , m_lazy (0)
     , m_is_global (false)		// don't care about globalness any more
 {
 #if DO_DEBUG
@@ -770,7 +889,8 @@ YFunction::toStreamDefinition (std::ostream & str) const
 
     // definition
 
-    bool need_definition = (m_definition != 0);
+    YCodePtr def = definition ();
+    bool need_definition = (def != 0);
     Bytecode::writeBool (str, need_definition);
 #if DO_DEBUG
     y2debug ("YFunction::toStreamDefinition, need_definition %d", need_definition);
@@ -781,7 +901,17 @@ YFunction::toStreamDefinition (std::ostream & str) const
 	{
 	    Bytecode::pushNamespace (m_declaration->nameSpace());	// keep the declaration accessible during definition write
 	}
-	m_definition->toStream (str);
+	if (Bytecode::writingSections ())
+	{
+	    // each definition is a section of its own
+	    std::ostringstream body;
+	    def->toStream (body);
+	    Bytecode::writeSection (str, Bytecode::sBody, body.str ());
+	}
+	else
+	{
+	    def->toStream (str);
+	}
 	if (need_declaration)
 	{
 	    Bytecode::popNamespace (m_declaration->nameSpace());
@@ -834,7 +964,8 @@ std::ostream &
 YFunction::toXml (std::ostream & str, int indent ) const
 {
     bool need_declaration = ((m_declaration != 0) && (m_declaration->symbolCount() > 0));
-    bool need_definition = (m_definition != 0);
+    YCodePtr def = definition ();
+    bool need_definition = (def != 0);
 
     if (need_declaration || need_definition) {
 	if (need_declaration)
@@ -844,7 +975,7 @@ YFunction::toXml (std::ostream & str, int indent ) const
 	    m_declaration->toXml (str, indent+4 );
 	    str << Xmlcode::spaces( indent+2 ) << "</declaration>\n";
 	}
-	m_definition->toXml (str, indent+2 );
+	def->toXml (str, indent+2 );
 	if (need_declaration)
 	{
 	    Xmlcode::popNamespace (m_declaration->nameSpace());
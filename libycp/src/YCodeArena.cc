@@ -0,0 +1,166 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCodeArena.cc
+
+   Arena allocation for the code trees of one bytecode or source file
+
+/-*/
+
+#include <stdlib.h>
+#include <new>
+
+#include "ycp/YCodeArena.h"
+#include <y2util/y2log.h>
+
+// the first chunk is small, runtime parsing (eval) creates tiny arenas,
+// following chunks double in size up to MAX_CHUNK
+#define FIRST_CHUNK 1024
+#define MAX_CHUNK (256*1024)
+
+// every allocation is preceeded by its arena (0 if it came from the heap)
+union Header {
+    YCodeArena *arena;
+    long long align_ll;
+    double align_d;
+};
+
+__thread YCodeArena *YCodeArena::_current = 0;
+
+
+YCodeArena::YCodeArena (const std::string & name)
+    : m_chunks (0)
+    , m_live (0)
+    , m_count (0)
+    , m_bytes (0)
+    , m_open (true)
+    , m_name (name)
+{
+}
+
+
+YCodeArena::~YCodeArena ()
+{
+    while (m_chunks)
+    {
+	Chunk *next = m_chunks->next;
+	free (m_chunks);
+	m_chunks = next;
+    }
+}
+
+
+void *
+YCodeArena::alloc (size_t size)
+{
+    if (m_chunks == 0
+	|| m_chunks->used + size > m_chunks->size)
+    {
+	size_t chunksize = m_chunks ? 2 * m_chunks->size : FIRST_CHUNK;
+	if (chunksize > MAX_CHUNK)
+	    chunksize = MAX_CHUNK;
+	if (chunksize < size)
+	    chunksize = size;
+
+	// keep the chunk header a multiple of the alignment
+	size_t headsize = (sizeof (Chunk) + sizeof (Header) - 1) / sizeof (Header) * sizeof (Header);
+	Chunk *chunk = (Chunk *) malloc (headsize + chunksize);
+	if (chunk == 0)
+	    throw std::bad_alloc ();
+
+	chunk->next = m_chunks;
+	chunk->size = headsize + chunksize;
+	chunk->used = headsize;
+	m_chunks = chunk;
+    }
+
+    void *ptr = (char *) m_chunks + m_chunks->used;
+    m_chunks->used += size;
+    m_live++;
+    m_count++;
+    m_bytes += size;
+    return ptr;
+}
+
+
+void
+YCodeArena::close ()
+{
+    m_open = false;
+
+    y2debug ("Arena '%s': %zd objects, %zd bytes, %zd still alive", m_name.c_str (), m_count, m_bytes, m_live);
+
+    if (m_live == 0)
+    {
+	delete this;
+    }
+}
+
+
+void *
+YCodeArena::allocate (size_t size)
+{
+    // room for the header, rounded up to the alignment
+    size = (size + 2 * sizeof (Header) - 1) / sizeof (Header) * sizeof (Header);
+
+    Header *header;
+    if (_current)
+    {
+	header = (Header *) _current->alloc (size);
+    }
+    else
+    {
+	header = (Header *) malloc (size);
+	if (header == 0)
+	    throw std::bad_alloc ();
+    }
+    header->arena = _current;
+    return header + 1;
+}
+
+
+void
+YCodeArena::deallocate (void *ptr)
+{
+    if (ptr == 0)
+	return;
+
+    Header *header = (Header *) ptr - 1;
+    YCodeArena *arena = header->arena;
+    if (arena == 0)
+    {
+	free (header);
+	return;
+    }
+
+    arena->m_live--;
+    if (arena->m_live == 0
+	&& !arena->m_open)
+    {
+	delete arena;
+    }
+}
+
+
+YCodeArena::Scope::Scope (const std::string & name)
+    : m_arena (new YCodeArena (name))
+    , m_previous (YCodeArena::_current)
+{
+    YCodeArena::_current = m_arena;
+}
+
+
+YCodeArena::Scope::~Scope ()
+{
+    YCodeArena::_current = m_previous;
+    m_arena->close ();
+}
@@ -38,6 +38,7 @@
 
 #include "ycp/Bytecode.h"
 #include "ycp/Xmlcode.h"
+#include "ycp/Profiler.h"
 
 #ifndef DO_DEBUG
 #define DO_DEBUG 0
@@ -71,6 +72,17 @@ IMPL_DERIVED_POINTER(YECall, YCode);
 IMPL_DERIVED_POINTER(YEFunction, YECall);
 IMPL_DERIVED_POINTER(YEFunctionPointer, YECall);
 
+// optimize all codes of a parameter/element list in place
+static void
+optimizeYCodelist (ycodelist_t *codep, int & removed)
+{
+    while (codep)
+    {
+	YCode::optimizeChild (codep->code, removed);
+	codep = codep->next;
+    }
+}
+
 // ------------------------------------------------------------------
 // variable ref (-> SymbolEntry)
 
@@ -109,12 +121,23 @@ YEVariable::toString() const
 }
 
 
+bool
+YEVariable::isPure () const
+{
+    // reading a variable, the value of a loop variable of a parallel
+    // builtin is private to the thread (see SymbolEntry::_bindings)
+    return true;
+}
+
+
 YCPValue
 YEVariable::evaluate (bool cse)
 {
     if (cse) return YCPNull();
 
-    YCPValue value = m_entry->value();		// get current value
+    // a local variable is read from its slot in the active frame
+    const YCPValue *slot = m_entry->slot ();
+    YCPValue value = slot ? *slot : m_entry->value();	// get current value
 
     if (value.isNull())				// oops, no value yet
     {
@@ -349,6 +372,18 @@ YETerm::toString () const
 }
 
 
+bool
+YETerm::isPure () const
+{
+    for (ycodelist_t *p = m_parameters; p; p = p->next)
+    {
+	if (!p->code->isPure ())
+	    return false;
+    }
+    return true;
+}
+
+
 YCPValue
 YETerm::evaluate (bool cse)
 {
@@ -379,6 +414,14 @@ YETerm::evaluate (bool cse)
 }
 
 
+YCodePtr
+YETerm::optimize (int & removed)
+{
+    optimizeYCodelist (m_parameters, removed);
+    return this;
+}
+
+
 std::ostream &
 YETerm::toStream (std::ostream & str) const
 {
@@ -462,6 +505,13 @@ YECompare::toString () const
 }
 
 
+bool
+YECompare::isPure () const
+{
+    return m_left->isPure () && m_right->isPure ();
+}
+
+
 YCPValue
 YECompare::evaluate (bool cse)
 {
@@ -520,6 +570,28 @@ YECompare::evaluate (bool cse)
 }
 
 
+YCodePtr
+YECompare::optimize (int & removed)
+{
+    optimizeChild (m_left, removed);
+    optimizeChild (m_right, removed);
+
+    if (!m_left->isConstant ()
+	|| !m_right->isConstant ())
+    {
+	return this;
+    }
+
+    YCodePtr folded = YConst::create (evaluate ());
+    if (folded == 0)
+    {
+	return this;
+    }
+    removed += 2;
+    return folded;
+}
+
+
 std::ostream &
 YECompare::toStream (std::ostream & str) const
 {
@@ -553,7 +625,8 @@ YELocale::YELocale (const char *singular, const char *plural, YCodePtr count, co
 {
     if (YLocale::domains.find (textdomain) == YLocale::domains.end ())
     {
-	YLocale::domains.insert (std::make_pair(textdomain,false));
+	// the textdomain of the parser lives in the code, keep a copy
+	YLocale::domains.insert (std::make_pair(strdup (textdomain),false));
     }
     m_domain = YLocale::domains.find (textdomain);
 }
@@ -633,6 +706,14 @@ YELocale::evaluate (bool cse)
 }
 
 
+YCodePtr
+YELocale::optimize (int & removed)
+{
+    optimizeChild (m_count, removed);
+    return this;
+}
+
+
 std::ostream &
 YELocale::toStream (std::ostream & str) const
 {
@@ -726,6 +807,18 @@ YEList::toString() const
 }
 
 
+bool
+YEList::isPure () const
+{
+    for (ycodelist_t *p = m_first; p; p = p->next)
+    {
+	if (!p->code->isPure ())
+	    return false;
+    }
+    return true;
+}
+
+
 YCPValue
 YEList::evaluate (bool cse)
 {
@@ -756,6 +849,22 @@ YEList::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEList::optimize (int & removed)
+{
+    optimizeYCodelist (m_first, removed);
+
+    // all elements constant ?
+    YCodePtr folded = YConst::create (evaluate (true));
+    if (folded == 0)
+    {
+	return this;
+    }
+    removed += count ();
+    return folded;
+}
+
+
 int
 YEList::count () const
 {
@@ -906,6 +1015,18 @@ YEMap::toString() const
 }
 
 
+bool
+YEMap::isPure () const
+{
+    for (mapval_t *p = m_first; p; p = p->next)
+    {
+	if (!p->key->isPure () || !p->value->isPure ())
+	    return false;
+    }
+    return true;
+}
+
+
 YCPValue
 YEMap::evaluate (bool cse)
 {
@@ -942,6 +1063,30 @@ YEMap::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEMap::optimize (int & removed)
+{
+    int count = 0;
+    mapval_t *element = m_first;
+    while (element)
+    {
+	optimizeChild (element->key, removed);
+	optimizeChild (element->value, removed);
+	element = element->next;
+	count++;
+    }
+
+    // all keys and values constant ?
+    YCodePtr folded = YConst::create (evaluate (true));
+    if (folded == 0)
+    {
+	return this;
+    }
+    removed += 2 * count;
+    return folded;
+}
+
+
 std::ostream &
 YEMap::toStream (std::ostream & str) const
 {
@@ -1144,6 +1289,13 @@ YEPropagate::canPropagate(const YCPValue& value, constTypePtr to_type) const
 }
 
 
+bool
+YEPropagate::isPure () const
+{
+    return m_value->isPure ();
+}
+
+
 YCPValue
 YEPropagate::evaluate (bool cse)
 {
@@ -1189,6 +1341,43 @@ YEPropagate::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEPropagate::optimize (int & removed)
+{
+    optimizeChild (m_value, removed);
+
+    if (m_from->equals (m_to))
+    {
+	// nothing to convert
+	removed++;
+	return m_value;
+    }
+
+    if (!m_value->isConstant ())
+    {
+	return this;
+    }
+
+    // don't report conversion errors at compile time
+    YCPValue v = ((YConstPtr)m_value)->value ();
+    if (v.isNull ()
+	|| !((m_to->isFloat () && v->isInteger ())
+	     || (m_to->isInteger () && v->isFloat ())
+	     || canPropagate (v, m_to)))
+    {
+	return this;
+    }
+
+    YCodePtr folded = YConst::create (evaluate ());
+    if (folded == 0)
+    {
+	return this;
+    }
+    removed++;
+    return folded;
+}
+
+
 std::ostream &
 YEPropagate::toStream (std::ostream & str) const
 {
@@ -1252,6 +1441,13 @@ YEUnary::toString() const
 }
 
 
+bool
+YEUnary::isPure () const
+{
+    return (m_decl->flags & DECL_PURE) && m_arg->isPure ();
+}
+
+
 YCPValue
 YEUnary::evaluate (bool cse)
 {
@@ -1287,6 +1483,27 @@ YEUnary::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEUnary::optimize (int & removed)
+{
+    optimizeChild (m_arg, removed);
+
+    if (!m_arg->isConstant ()
+	|| (m_decl->flags & DECL_NOEVAL) == DECL_NOEVAL)
+    {
+	return this;
+    }
+
+    YCodePtr folded = YConst::create (evaluate ());
+    if (folded == 0)
+    {
+	return this;
+    }
+    removed++;
+    return folded;
+}
+
+
 std::ostream &
 YEUnary::toStream (std::ostream & str) const
 {
@@ -1348,6 +1565,20 @@ YEBinary::decl()
 }
 
 
+YCodePtr
+YEBinary::arg1 () const
+{
+    return m_arg1;
+}
+
+
+YCodePtr
+YEBinary::arg2 () const
+{
+    return m_arg2;
+}
+
+
 string
 YEBinary::toString() const
 {
@@ -1357,6 +1588,13 @@ YEBinary::toString() const
 }
 
 
+bool
+YEBinary::isPure () const
+{
+    return (m_decl->flags & DECL_PURE) && m_arg1->isPure () && m_arg2->isPure ();
+}
+
+
 YCPValue
 YEBinary::evaluate (bool cse)
 {
@@ -1401,6 +1639,42 @@ YEBinary::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEBinary::optimize (int & removed)
+{
+    optimizeChild (m_arg1, removed);
+    optimizeChild (m_arg2, removed);
+
+    if (!m_arg1->isConstant ()
+	|| !m_arg2->isConstant ()
+	|| (m_decl->flags & DECL_NOEVAL) == DECL_NOEVAL)
+    {
+	return this;
+    }
+
+    // leave division by zero to the runtime, it reports the error there
+    if (strcmp (m_decl->name, "/") == 0
+	|| strcmp (m_decl->name, "%") == 0)
+    {
+	YCPValue divisor = ((YConstPtr)m_arg2)->value ();
+	if (divisor.isNull ()
+	    || (divisor->isInteger () && divisor->asInteger ()->value () == 0)
+	    || (divisor->isFloat () && divisor->asFloat ()->value () == 0.0))
+	{
+	    return this;
+	}
+    }
+
+    YCodePtr folded = YConst::create (evaluate ());
+    if (folded == 0)
+    {
+	return this;
+    }
+    removed += 2;
+    return folded;
+}
+
+
 std::ostream &
 YEBinary::toStream (std::ostream & str) const
 {
@@ -1487,6 +1761,13 @@ YETriple::toString() const
 }
 
 
+bool
+YETriple::isPure () const
+{
+    return m_expr->isPure () && m_true->isPure () && m_false->isPure ();
+}
+
+
 YCPValue
 YETriple::evaluate (bool cse)
 {
@@ -1523,6 +1804,23 @@ YETriple::evaluate (bool cse)
 }
 
 
+YCodePtr
+YETriple::optimize (int & removed)
+{
+    optimizeChild (m_expr, removed);
+    optimizeChild (m_true, removed);
+    optimizeChild (m_false, removed);
+
+    if (m_expr->kind () != ycBoolean)
+    {
+	return this;
+    }
+
+    removed += 2;		// the condition and the branch not taken
+    return ((YConstPtr)m_expr)->value ()->asBoolean ()->value () ? m_true : m_false;
+}
+
+
 std::ostream &
 YETriple::toStream (std::ostream & str) const
 {
@@ -1581,6 +1879,13 @@ YEIs::toString () const
 }
 
 
+bool
+YEIs::isPure () const
+{
+    return m_expr->isPure ();
+}
+
+
 YCPValue
 YEIs::evaluate (bool cse)
 {
@@ -1631,6 +1936,14 @@ YEIs::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEIs::optimize (int & removed)
+{
+    optimizeChild (m_expr, removed);
+    return this;
+}
+
+
 std::ostream &
 YEIs::toStream (std::ostream & str) const
 {
@@ -1681,6 +1994,13 @@ YEReturn::toString () const
 }
 
 
+bool
+YEReturn::isPure () const
+{
+    return m_expr->isPure ();
+}
+
+
 YCPValue
 YEReturn::evaluate (bool /*cse*/)
 {
@@ -1688,6 +2008,14 @@ YEReturn::evaluate (bool /*cse*/)
 }
 
 
+YCodePtr
+YEReturn::optimize (int & removed)
+{
+    optimizeChild (m_expr, removed);
+    return this;
+}
+
+
 std::ostream &
 YEReturn::toStream (std::ostream & str) const
 {
@@ -1744,6 +2072,13 @@ YEBracket::toString () const
 }
 
 
+bool
+YEBracket::isPure () const
+{
+    return m_var->isPure () && m_arg->isPure () && m_def->isPure ();
+}
+
+
 YCPValue
 YEBracket::evaluate (bool cse)
 {
@@ -1855,6 +2190,16 @@ YEBracket::evaluate (bool cse)
     return result;
 }
 
+
+YCodePtr
+YEBracket::optimize (int & removed)
+{
+    optimizeChild (m_var, removed);
+    optimizeChild (m_arg, removed);
+    optimizeChild (m_def, removed);
+    return this;
+}
+
 std::ostream &
 YEBracket::toStream (std::ostream & str) const
 {
@@ -1888,6 +2233,7 @@ YEBuiltin::YEBuiltin (declaration_t *decl, YBlockPtr parameterblock, constTypePt
     , m_type (type==0 ? Type::Function(Type::Unspec) : (constFunctionTypePtr)type)
     , m_parameterblock (parameterblock)
     , m_parameters (0)
+    , m_thunk (0)
 {
 }
 
@@ -1896,6 +2242,7 @@ YEBuiltin::YEBuiltin (bytecodeistream & str)
     : YCode ()
     , m_parameterblock (0)
     , m_parameters (0)
+    , m_thunk (0)
 {
     m_type = FunctionTypePtr (Bytecode::readType (str));
     extern StaticDeclaration static_declarations;
@@ -1915,6 +2262,11 @@ YEBuiltin::YEBuiltin (bytecodeistream & str)
     }
     // throw away type info
     m_type = Type::Void;
+
+    if (m_decl != 0)
+    {
+	resolveCall ();
+    }
 }
 
 
@@ -2038,6 +2390,13 @@ YEBuiltin::decl () const
 }
 
 
+ycodelist_t *
+YEBuiltin::parameters () const
+{
+    return m_parameters;
+}
+
+
 YBlockPtr
 YEBuiltin::parameterBlock () const
 {
@@ -2072,6 +2431,7 @@ YEBuiltin::finalize (Logger* problem_logger)
 	return Type::Error;
     }
     m_decl = decl;					// remember matching declaration
+    m_thunk = 0;					// re-resolve on next evaluate
 
 #if DO_DEBUG
     y2debug ("YEBuiltin::finalize found (%s : %s)", StaticDeclaration::Decl2String (m_decl, true).c_str(), m_type->toString().c_str());
@@ -2413,6 +2773,154 @@ YEBuiltin::toString() const
 }
 
 
+// builtin call thunks, one per arity
+// selected once by YEBuiltin::resolveCall (), so evaluate () does not
+// have to look at the declaration type on every call
+
+static YCPValue
+builtinCall0 (const declaration_t *decl, int, YCPValue [])
+{
+    return (*(v2)decl->ptr) ();
+}
+
+static YCPValue
+builtinCall1 (const declaration_t *decl, int, YCPValue args[])
+{
+    return (*(v2v)decl->ptr) (args[0]);
+}
+
+static YCPValue
+builtinCall2 (const declaration_t *decl, int, YCPValue args[])
+{
+    return (*(v2vv)decl->ptr) (args[0], args[1]);
+}
+
+static YCPValue
+builtinCall3 (const declaration_t *decl, int, YCPValue args[])
+{
+    return (*(v2vvv)decl->ptr) (args[0], args[1], args[2]);
+}
+
+static YCPValue
+builtinCall4 (const declaration_t *decl, int, YCPValue args[])
+{
+    return (*(v2vvvv)decl->ptr) (args[0], args[1], args[2], args[3]);
+}
+
+static YCPValue
+builtinCall5 (const declaration_t *decl, int, YCPValue args[])
+{
+    return (*(v2vvvvv)decl->ptr) (args[0], args[1], args[2], args[3], args[4]);
+}
+
+// The bultin belongs to a name space with a special call handler -
+// don't simply call the builtin function via decl->ptr,
+// call the call handler and pass the builtin function pointer and
+// arguments to the call handler
+static YCPValue
+builtinCallHandler (const declaration_t *decl, int, YCPValue args[])
+{
+    call_handler_t call_handler = (call_handler_t) decl->name_space->ptr;
+    constFunctionTypePtr type = decl->type;
+    return call_handler (decl->ptr, type->parameterCount (), args);
+}
+
+static YCPValue
+builtinCallNone (const declaration_t *, int, YCPValue [])
+{
+    return YCPNull ();
+}
+
+static YCPValue
+builtinCallNoHandler (const declaration_t *decl, int argc, YCPValue [])
+{
+    ycp2error("YEBuiltin::evaluate [%s (%d args)]: Call handler declared, but not present",
+	    StaticDeclaration::Decl2String (decl, false).c_str(), argc);
+    return YCPNull();
+}
+
+static YCPValue
+builtinCallBad (const declaration_t *, int argc, YCPValue [])
+{
+    ycp2error ("Bad builtin: Arg count %d", argc);
+    return YCPNull ();
+}
+
+
+void
+YEBuiltin::resolveCall ()
+{
+    // m_thunk is set last, another thread evaluating the same call
+    // (see YCPParallel) resolves again or sees everything resolved
+    constFunctionTypePtr type = m_decl->type;
+    int argcount = type->parameterCount ();
+    int wildcard = -1;
+    for (int i = 0; i < argcount; i++)
+    {
+	if (type->parameterType (i)->isWildcard ())
+	{
+	    wildcard = i;
+	    break;
+	}
+    }
+    m_argcount = argcount;
+    m_wildcard = wildcard;
+    m_noeval = (m_decl->flags & DECL_NOEVAL) == DECL_NOEVAL;
+    m_nilok = (m_decl->flags & DECL_NIL) != 0;
+    m_handler = m_decl->name_space && (m_decl->name_space->flags & DECL_CALL_HANDLER);
+
+    thunk_t thunk;
+    if (m_decl->ptr == 0)
+    {
+	thunk = builtinCallNone;
+    }
+    else if (m_handler)
+    {
+	thunk = m_decl->name_space->ptr ? builtinCallHandler : builtinCallNoHandler;
+    }
+    else
+    {
+	switch (m_argcount)
+	{
+	    case 0: thunk = builtinCall0; break;
+	    case 1: thunk = builtinCall1; break;
+	    case 2: thunk = builtinCall2; break;
+	    case 3: thunk = builtinCall3; break;
+	    case 4: thunk = builtinCall4; break;
+	    case 5: thunk = builtinCall5; break;
+	    default: thunk = builtinCallBad; break;
+	}
+    }
+
+    __sync_synchronize ();
+    m_thunk = thunk;
+
+#if DO_DEBUG
+    y2debug ("YEBuiltin::resolveCall [%s] argc %d, wildcard %d", m_decl->name, m_argcount, m_wildcard);
+#endif
+}
+
+
+bool
+YEBuiltin::isPure () const
+{
+    // builtins with symbolic parameters (maplist, foreach, ...) set
+    // the values of their variables
+    if ((m_decl->flags & DECL_PURE) == 0
+	|| m_parameterblock != 0)
+    {
+	return false;
+    }
+
+    for (ycodelist_t *p = m_parameters; p; p = p->next)
+    {
+	if (!p->code->isPure ())
+	    return false;
+    }
+    return true;
+}
+
+
 YCPValue
 YEBuiltin::evaluate (bool cse)
 {
@@ -2425,15 +2933,16 @@ YEBuiltin::evaluate (bool cse)
 	return YCPNull();
     }
 
+    if (m_thunk == 0)
+    {
+	resolveCall ();
+    }
+
     // init parameters
 
     ycodelist_t *actualp = m_parameters;
     const int maxargs = 10;
     YCPValue args[maxargs] = { YCPNull(), YCPNull(), YCPNull(), YCPNull(), YCPNull(), YCPNull(), YCPNull(), YCPNull(), YCPNull(), YCPNull() };
-    YCPList list;
-
-    constFunctionTypePtr type = m_decl->type;
-    int typepos = -1; // position of w
 
     // evaluate parameters
 
@@ -2450,7 +2959,7 @@ YEBuiltin::evaluate (bool cse)
 	y2debug ("actualp ([%d]%s)", actualp->code->kind(), actualp->code->toString().c_str());
 #endif
 
-	if (actualp->code->isBlock() || ( (m_decl->flags & DECL_NOEVAL) == DECL_NOEVAL))
+	if (m_noeval || actualp->code->isBlock())
 	    // block as parameter to builtin function or builtin will eval on its own
 	{
 	    args[i] = YCPCode (actualp->code);	// pass as-is
@@ -2464,8 +2973,8 @@ YEBuiltin::evaluate (bool cse)
 	    args[i] = actualp->code->evaluate ();
 	}
 
-	if ((args[i].isNull() || args[i]->isVoid())
-	    && ((m_decl->flags & DECL_NIL) == 0))
+	if (!m_nilok
+	    && (args[i].isNull() || args[i]->isVoid()))
 	{
 	    ycp2error ("Argument (%s) to %s(...) is nil", actualp->code->toString().c_str(), m_decl->name);
 	    return YCPNull ();
@@ -2475,22 +2984,6 @@ YEBuiltin::evaluate (bool cse)
 	y2debug ("==> (%s)", args[i].isNull() ? "NULL" : args[i]->toString().c_str());
 #endif
 
-	if ((typepos < 0)					// not at wildcard yet
-	    && type->parameterType(i)->isWildcard ())		// at '...' now ?
-	{
-	    typepos = i;
-#if DO_DEBUG
-	    y2debug ("type '...' %d", i);
-#endif
-	}
-
-	if (typepos >= 0)					// at or beyond '...'
-	{
-#if DO_DEBUG
-	    y2debug ("w! args[%d] = '%s'", i, args[i].isNull() ? "nil" : args[i]->toString().c_str());
-#endif
-	    list->add (args[i]);	// Y: add value to list
-	}
 	i++;
 	actualp = actualp->next;
     }
@@ -2504,14 +2997,20 @@ YEBuiltin::evaluate (bool cse)
     }
 
 
-    // wildcard checking
+    // wildcard checking, collect all values at or beyond '...' in a list
 
-    if (typepos >= 0)
+    if (m_wildcard >= 0
+	&& i > m_wildcard)
     {
+	YCPList list;
+	for (int w = m_wildcard; w < i; w++)
+	{
+	    list->add (args[w]);
+	}
 #if DO_DEBUG
-	y2debug ("w! pos %d '%s'", i, list->toString().c_str());
+	y2debug ("w! pos %d '%s'", m_wildcard, list->toString().c_str());
 #endif
-	i = typepos+1;
+	i = m_wildcard+1;
 	args[i-1] = list;
     }
 
@@ -2523,61 +3022,26 @@ YEBuiltin::evaluate (bool cse)
     y2debug ("parameter 1: %s", i > 0 ? (args[0].isNull() ? "NULL" : args[0]->toString().c_str()) : "nil" );
 #endif
     YCPValue ret = YCPNull();
-    if (m_decl->ptr == 0)
+
+    if (profiler_instance)
     {
-	return ret;
+	profiler_instance->enterBuiltin (m_decl);
     }
 
-    if (m_decl->name_space && ( m_decl->name_space->flags & DECL_CALL_HANDLER ) )
+    if (m_handler || m_parameterblock == 0)
     {
-	// The bultin belongs to a name space with a special call handler -
-	// don't simply call the builtin function via m_decl->ptr(),
-	// call the call handler and pass the builtin function pointer and
-	// arguments to the call handler
-	call_handler_t call_handler = (call_handler_t) m_decl->name_space->ptr;
-	if (call_handler)
-	{
-	    return call_handler (m_decl->ptr, type->parameterCount (), args);
-	}
-	else
-	{
-	    ycp2error("YEBuiltin::evaluate [%s (%d args)]: Call handler declared, but not present",
-		    StaticDeclaration::Decl2String (m_decl, false).c_str(), i);
-	    return YCPNull();
-	}
+	ret = (*m_thunk) (m_decl, i, args);
     }
     else
     {
-	if (m_parameterblock) m_parameterblock->pushToStack ();
-	
-	switch (type->parameterCount ())
-	{
-	    case 0:
-		ret = (*(v2)m_decl->ptr) ();
-	    break;
-	    case 1:
-		ret = (*(v2v)m_decl->ptr) (args[0]);
-	    break;
-	    case 2:
-		ret = (*(v2vv)m_decl->ptr) (args[0], args[1]);
-	    break;
-	    case 3:
-		ret = (*(v2vvv)m_decl->ptr) (args[0], args[1], args[2]);
-	    break;
-	    case 4:
-		ret = (*(v2vvvv)m_decl->ptr) (args[0], args[1], args[2], args[3]);
-	    break;
-	    case 5:
-		ret = (*(v2vvvvv)m_decl->ptr) (args[0], args[1], args[2], args[3], args[4]);
-	    break;
-	    default:
-	    {
-		ycp2error ("Bad builtin: Arg count %d", i);
-		ret = YCPNull ();
-	    }
-	    break;
-	}
-	if (m_parameterblock) m_parameterblock->popFromStack ();
+	m_parameterblock->pushFrame ();
+	ret = (*m_thunk) (m_decl, i, args);
+	m_parameterblock->popFrame (false);
+    }
+
+    if (profiler_instance)
+    {
+	profiler_instance->leave ();
     }
 
 #ifdef BUILTIN_STATISTICS
@@ -2597,6 +3061,14 @@ YEBuiltin::evaluate (bool cse)
 }
 
 
+YCodePtr
+YEBuiltin::optimize (int & removed)
+{
+    optimizeYCodelist (m_parameters, removed);
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // function call parameter handling (-> SymbolEntry + Parameters)
 
@@ -2953,6 +3425,17 @@ YECall::finalize()
 }
 
 
+YCodePtr
+YECall::optimize (int & removed)
+{
+    for (uint i = 0 ; i < m_next_param_id; i++)
+    {
+	optimizeChild (m_parameters[i], removed);
+    }
+    return this;
+}
+
+
 string
 YECall::toString() const
 {
@@ -3066,11 +3549,16 @@ YEFunction::evaluate (bool cse)
     y2debug ("YEFunction::evaluate (%s)\n", toString().c_str());
 #endif
 
-    
-    if (!m_functioncall)
+    // m_functioncall is shared by all threads evaluating this code,
+    //  an interpreter context keeps a call of its own per function
+    Y2Function *& call = SymbolEntry::_store != 0
+	? SymbolEntry::_store->calls[m_sentry->serial ()]
+	: m_functioncall;
+
+    if (!call)
     {
-	m_functioncall = const_cast<Y2Namespace*>(m_sentry->nameSpace())->createFunctionCall (m_sentry->name (), m_sentry->type ());
-	if (m_functioncall == 0)
+	call = const_cast<Y2Namespace*>(m_sentry->nameSpace())->createFunctionCall (m_sentry->name (), m_sentry->type ());
+	if (call == 0)
 	{
 	    y2error ("Cannot create a function call for %s", m_sentry->toString ().c_str ());
 	    return YCPVoid ();
@@ -3078,12 +3566,13 @@ YEFunction::evaluate (bool cse)
     }
     else
     {
-	if (! m_functioncall->reset ())
+	if (! call->reset ())
 	{
 	    y2error ("failed to reset function call parameters for %s", m_sentry->toString ().c_str ());
 	    return YCPVoid ();
 	}
     }
+    Y2Function *functioncall = call;
     
     YCPValue evaluated_params [m_next_param_id];
 
@@ -3109,14 +3598,14 @@ YEFunction::evaluate (bool cse)
     // set the parameters for Y2Function
     for (unsigned int p = 0; p < m_next_param_id ; p++)
     {
-	m_functioncall->attachParameter (evaluated_params[p], p);
+	functioncall->attachParameter (evaluated_params[p], p);
     }
     
     extern ExecutionEnvironment ee;
 
     // save the context info
     int linenumber = ee.linenumber ();
-    string filename = ee.filename ();
+    const string *filename = ee.internedFilename ();
 
     if (ee.endlessRecursion ())
     {
@@ -3126,7 +3615,7 @@ YEFunction::evaluate (bool cse)
 
     ee.pushframe ((YECallPtr)this, evaluated_params);
 
-    YCPValue value = m_functioncall->evaluateCall ();
+    YCPValue value = functioncall->evaluateCall ();
 
     // restore the context info
     ee.setLinenumber (linenumber);
@@ -3213,19 +3702,35 @@ YEFunctionPointer::evaluate (bool cse)
 
     Y2Namespace* ns = const_cast<Y2Namespace*> (ptr_sentry->nameSpace ());
 
-    m_functioncall = ns->createFunctionCall (
-	ptr_sentry->name (),
-	ptr_sentry->type ()
-    );
+    // like in YEFunction, an interpreter context keeps a call of its
+    //  own per function
+    Y2Function *functioncall;
+    if (SymbolEntry::_store != 0)
+    {
+	Y2Function *& call = SymbolEntry::_store->calls[ptr_sentry->serial ()];
+	if (call == 0)
+	{
+	    call = ns->createFunctionCall (ptr_sentry->name (), ptr_sentry->type ());
+	}
+	functioncall = call;
+    }
+    else
+    {
+	functioncall = ns->createFunctionCall (
+	    ptr_sentry->name (),
+	    ptr_sentry->type ()
+	);
+	m_functioncall = functioncall;
+    }
     
-    if (!m_functioncall)
+    if (!functioncall)
     {
 	y2internal ("Cannot get function call object for %s", m_sentry->toString().c_str());
 	return YCPVoid ();
     }
 
     // FIXME: this could fail    
-    m_functioncall->reset ();
+    functioncall->reset ();
     
     YCPValue m_params [m_next_param_id];
 
@@ -3251,16 +3756,16 @@ YEFunctionPointer::evaluate (bool cse)
     // set the parameters for Y2Function
     for (unsigned int p = 0; p < m_next_param_id ; p++)
     {
-	m_functioncall->attachParameter (m_params[p], p);
+	functioncall->attachParameter (m_params[p], p);
     }
     
     extern ExecutionEnvironment ee;
 
     // save the context info
     int linenumber = ee.linenumber ();
-    string filename = ee.filename ();
+    const string *filename = ee.internedFilename ();
 
-    YCPValue value = m_functioncall->evaluateCall ();
+    YCPValue value = functioncall->evaluateCall ();
 
     // restore the context info
     ee.setLinenumber (linenumber);
@@ -3312,13 +3817,6 @@ Y2YCPFunction::evaluateCall ()
 
     YFunctionPtr func = (YFunctionPtr)(m_sentry->code());
 
-    // push parameter values for recursion
-    for (unsigned int p = 0; p < func->parameterCount(); p++)
-    {
-	func->parameter (p)->push ();
-    }
-
-    // push also local parameters
     YCodePtr definition = func->definition ();
 
     if (definition == 0)
@@ -3327,9 +3825,12 @@ Y2YCPFunction::evaluateCall ()
 	return YCPNull();
     }
 
-    if (definition->isBlock())
+    // the parameters live in one frame per call, on the frame stack
+    //  of the thread (see Y2Namespace::pushFrame())
+    YBlockPtr declaration = func->declaration ();
+    if (declaration)
     {
-//       ((YBlockPtr)definition)->pushToStack ();
+	declaration->pushFrame ();
     }
 
     for (unsigned int p = 0; p < func->parameterCount(); p++)
@@ -3340,10 +3841,9 @@ Y2YCPFunction::evaluateCall ()
 	{
 	    ycp2error ("Parameter not specified (%d)", p);
 
-	    // cleanup: pop parameter values for recursion
-	    for (unsigned int p = 0; p < func->parameterCount(); p++)
+	    if (declaration)
 	    {
-		func->parameter (p)->pop ();
+		declaration->popFrame (false);
 	    }
 
 	    return value;
@@ -3361,24 +3861,17 @@ Y2YCPFunction::evaluateCall ()
 
     // save the context info
     int linenumber = ee.linenumber ();
-    string filename = ee.filename ();
+    const string *filename = ee.internedFilename ();
 
     YCPValue value = definition->evaluate ();
 
-    if (definition->isBlock())
-    {
-       // pop also local parameters
-//       ((YBlockPtr)definition)->popFromStack ();
-    }
-
     // restore the context info
     ee.setLinenumber (linenumber);
     ee.setFilename (filename);
 
-    // pop parameter values for recursion
-    for (unsigned int p = 0; p < func->parameterCount(); p++)
+    if (declaration)
     {
-	func->parameter (p)->pop ();
+	declaration->popFrame (false);
     }
 
 #if DO_DEBUG
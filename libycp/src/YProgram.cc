@@ -0,0 +1,1525 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YProgram.cc
+
+   The statements of a block lowered to register code
+
+/-*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ycp/YProgram.h"
+#include "ycp/YBlock.h"
+#include "ycp/YStatement.h"
+#include "ycp/YExpression.h"
+#include "ycp/YCPInteger.h"
+#include "ycp/YCPBoolean.h"
+#include "ycp/YCPVoid.h"
+#include "ycp/YCPCode.h"
+#include "ycp/StaticDeclaration.h"
+#include "ycp/ExecutionEnvironment.h"
+#include "ycp/y2log.h"
+
+extern ExecutionEnvironment ee;
+
+using std::vector;
+
+static const char *Y2VM = "Y2VM";
+
+typedef YCPValue (*v2v) (const YCPValue &);
+typedef YCPValue (*v2vv) (const YCPValue &, const YCPValue &);
+
+// GCC dispatches on a table of label addresses, one indirect jump per
+// instruction, other compilers use the switch
+#ifdef __GNUC__
+#define THREADED_DISPATCH 1
+#define OUT_OF_LINE __attribute__ ((noinline))
+#else
+#define OUT_OF_LINE
+#endif
+
+
+// the operations, a = register a of the instruction, and so on
+enum {
+    op_statement,	// ee.setStatement (statement)
+    op_execute,		// evaluate the statement code, a value ends it: to handler
+    op_evaluate,	// a = code->evaluate ()
+    op_integer,		// a = value
+    op_boolean,		// a = value
+    op_constant,	// a = m_constants[value]
+    op_load,		// a = value of the variable entry
+    op_store,		// entry = a, as YSAssign
+    op_argument,	// a is the first argument of decl: nil is an error, a = nil, to jump
+    op_binary,		// a = decl (a, b), integers directly if mode is set
+    op_unary,		// a = decl (a)
+    op_compare,		// a = a <mode> b, as YECompare
+    op_logical,		// one operand of && or ||, mode tells which
+    op_triple,		// condition a of ?:, false to jump, error to jump2
+    op_test,		// condition a of if or a loop, false (true for repeat) to jump, error to jump2
+    op_jump,		// to jump
+    op_push,		// push the frame of block
+    op_pop,		// pop the frame of block
+    op_signal,		// sig = break or continue, to handler
+    op_return,		// sig = value of return (a if mode is set), to handler
+    op_propagate,	// pass sig on to handler
+    op_handle,		// a loop handles sig: break to jump, continue to jump2, else to handler
+    op_exit,		// return sig
+    op_end,		// return YCPNull ()
+    op_count
+};
+
+// integer operations of op_binary (i_*) and op_unary (u_*)
+enum {
+    i_none = 0,
+    i_plus, i_minus, i_mult, i_div, i_mod,
+    i_and, i_xor, i_or, i_left, i_right
+};
+
+enum { u_none = 0, u_neg, u_bnot, u_lnot };
+
+// operands of op_logical
+enum { l_and1, l_and2, l_or1, l_or2 };
+
+// statements of op_test
+enum { t_if, t_while, t_do, t_repeat };
+
+// loops of op_handle, do and repeat handle alike
+enum { h_while, h_do };
+
+// signals of op_signal
+enum { s_break, s_continue };
+
+
+struct YProgram::Insn
+{
+    int op;
+    int mode;			// variant of the operation, see above
+    unsigned int a;		// registers, a gets the result
+    unsigned int b;
+    unsigned int jump;		// instruction to jump to
+    unsigned int jump2;		// the other one, e.g. on errors
+    unsigned int handler;	// handler of a value ending the statement
+    long long value;		// constant
+    YCodePtr code;		// node of the tree
+    YCodePtr code2;		// second argument of op_binary, for errors
+    YStatementPtr statement;
+    SymbolEntryPtr entry;
+    YBlockPtr block;
+    declaration_t *decl;	// builtin of an operator
+
+    Insn ()
+	: op (op_end), mode (0), a (0), b (0)
+	, jump (0), jump2 (0), handler (0), value (0), decl (0)
+    {}
+};
+
+
+// ------------------------------------------------------------------
+// registers
+
+enum { r_value, r_integer, r_boolean };
+
+// a register holds a YCPValue or an integer or boolean not boxed
+//  yet, value is YCPNull () unless tag is r_value
+struct Reg
+{
+    YCPValue value;
+    long long i;
+    int tag;
+
+    Reg () : i (0), tag (r_value) {}
+};
+
+
+static inline void
+release (Reg & r)
+{
+    if (! r.value.isNull ())
+    {
+	r.value = YCPNull ();
+    }
+    r.tag = r_value;
+}
+
+
+static inline void
+setInteger (Reg & r, long long i)
+{
+    if (! r.value.isNull ())
+    {
+	r.value = YCPNull ();
+    }
+    r.tag = r_integer;
+    r.i = i;
+}
+
+
+static inline void
+setBoolean (Reg & r, bool b)
+{
+    if (! r.value.isNull ())
+    {
+	r.value = YCPNull ();
+    }
+    r.tag = r_boolean;
+    r.i = b;
+}
+
+
+static inline void
+setValue (Reg & r, const YCPValue & v)
+{
+    r.value = v;
+    r.tag = r_value;
+}
+
+
+// the register as YCPValue
+static inline const YCPValue &
+boxed (Reg & r)
+{
+    if (r.tag == r_integer)
+    {
+	r.value = YCPInteger (r.i);
+    }
+    else if (r.tag == r_boolean)
+    {
+	r.value = YCPBoolean (r.i != 0);
+    }
+    r.tag = r_value;
+    return r.value;
+}
+
+
+// the register as YCPValue, the register is empty afterwards
+static inline YCPValue
+take (Reg & r)
+{
+    YCPValue v = boxed (r);
+    r.value = YCPNull ();
+    return v;
+}
+
+
+// nil as YEBinary sees it
+static inline bool
+isNil (const Reg & r)
+{
+    return r.tag == r_value
+	&& (r.value.isNull () || r.value->isVoid ());
+}
+
+
+static inline bool
+integerOf (const Reg & r, long long & i)
+{
+    if (r.tag == r_integer)
+    {
+	i = r.i;
+	return true;
+    }
+    if (r.tag == r_value
+	&& ! r.value.isNull ()
+	&& r.value->valuetype () == YT_INTEGER)
+    {
+	i = static_cast<const YCPIntegerRep *> (r.value.operator-> ())->value ();
+	return true;
+    }
+    return false;
+}
+
+
+static inline bool
+booleanOf (const Reg & r, bool & b)
+{
+    if (r.tag == r_boolean)
+    {
+	b = r.i != 0;
+	return true;
+    }
+    if (r.tag == r_value
+	&& ! r.value.isNull ()
+	&& r.value->valuetype () == YT_BOOLEAN)
+    {
+	b = static_cast<const YCPBooleanRep *> (r.value.operator-> ())->value ();
+	return true;
+    }
+    return false;
+}
+
+
+static OUT_OF_LINE bool
+asTruth (Reg & r)
+{
+    return boxed (r)->asBoolean ()->value ();
+}
+
+
+// an operand of && and ||, not nil; asBoolean () complains like the
+//  builtins do about anything else
+static inline bool
+truthOf (Reg & r)
+{
+    bool b;
+    if (booleanOf (r, b))
+    {
+	return b;
+    }
+    return asTruth (r);
+}
+
+
+// a variable value goes to a register, integers and booleans unboxed
+static inline void
+load (Reg & r, const YCPValue & v)
+{
+    switch (v->valuetype ())
+    {
+	case YT_INTEGER:
+	    setInteger (r, static_cast<const YCPIntegerRep *> (v.operator-> ())->value ());
+	    break;
+	case YT_BOOLEAN:
+	    setBoolean (r, static_cast<const YCPBooleanRep *> (v.operator-> ())->value ());
+	    break;
+	default:
+	    setValue (r, v);
+	    break;
+    }
+}
+
+
+// YECompare::evaluate on values
+static YCPValue
+compareValues (const YCPValue & vl, int op, const YCPValue & vr)
+{
+    if ((vl.isNull () || vl->isVoid () || vr.isNull () || vr->isVoid ())
+	&& (op != YECompare::C_EQ && op != YECompare::C_NEQ))
+    {
+	ycp2error ("Nil can be compared only for equality and non-equality");
+	return YCPNull ();
+    }
+
+    if (vl.isNull () || vl->isVoid ())
+    {
+	if (op == YECompare::C_NEQ)
+	{
+	    return YCPBoolean (! (vr.isNull () || vr->isVoid ()));
+	}
+	return YCPBoolean (vr.isNull () || vr->isVoid ());
+    }
+
+    if (vr.isNull () || vr->isVoid ())
+    {
+	return YCPBoolean (op == YECompare::C_NEQ);
+    }
+
+    enum YCPOrder order = vl->compare (vr);
+    switch (op)
+    {
+	case YECompare::C_EQ:  return YCPBoolean (order == YO_EQUAL);
+	case YECompare::C_NEQ: return YCPBoolean (order != YO_EQUAL);
+	case YECompare::C_LT:  return YCPBoolean (order == YO_LESS);
+	case YECompare::C_GE:  return YCPBoolean (order != YO_LESS);
+	case YECompare::C_LE:  return YCPBoolean ((order == YO_EQUAL) || (order == YO_LESS));
+	case YECompare::C_GT:  return YCPBoolean (order == YO_GREATER);
+	default:
+	    break;
+    }
+    ycp2error ("YECompare unknown type");
+    return YCPBoolean (false);
+}
+
+
+static inline bool
+compareIntegers (long long i1, int op, long long i2)
+{
+    switch (op)
+    {
+	case YECompare::C_EQ:  return i1 == i2;
+	case YECompare::C_NEQ: return i1 != i2;
+	case YECompare::C_LT:  return i1 < i2;
+	case YECompare::C_GE:  return i1 >= i2;
+	case YECompare::C_LE:  return i1 <= i2;
+	default:	       return i1 > i2;
+    }
+}
+
+
+// ------------------------------------------------------------------
+// the slow paths of run (), out of line: run () recurses with the
+//  function calls of YCP, its stack frame must stay small
+
+static OUT_OF_LINE void
+warning (const char *message)
+{
+    ycp2warning (ee.filename ().c_str (), ee.linenumber (), "%s", message);
+}
+
+
+static OUT_OF_LINE void
+nilArgument (const YCodePtr & argument, const declaration_t *decl)
+{
+    ycp2error ("Argument (%s) to %s(...) evaluates to nil", argument->toString ().c_str (), decl->name);
+}
+
+
+// op_load of a variable without a value in a frame
+static OUT_OF_LINE void
+loadEntry (const YProgram::Insn *pc, Reg & r, bool framed)
+{
+    YCPValue value = framed ? YCPNull () : pc->entry->value ();
+    if (value.isNull ())
+    {
+	// not initialized, or a function
+	setValue (r, pc->code->evaluate ());
+    }
+    else
+    {
+	load (r, value);
+    }
+}
+
+
+// op_binary calling the builtin
+static OUT_OF_LINE void
+callBinary (const YProgram::Insn *pc, Reg & r1, Reg & r2)
+{
+    if ((pc->decl->flags & DECL_NIL) == 0
+	&& (isNil (r1) || isNil (r2)))
+    {
+	nilArgument (isNil (r1) ? pc->code : pc->code2, pc->decl);
+	release (r1);
+	release (r2);
+	return;
+    }
+    YCPValue value = (*(v2vv)pc->decl->ptr) (boxed (r1), boxed (r2));
+    setValue (r1, value);
+    release (r2);
+}
+
+
+// op_unary calling the builtin
+static OUT_OF_LINE void
+callUnary (const YProgram::Insn *pc, Reg & r)
+{
+    if (r.tag == r_value
+	&& r.value.isNull ()
+	&& (pc->decl->flags & DECL_NIL) == 0)
+    {
+	ycp2error ("Argument (%s) to %s(...) is nil", pc->code->toString ().c_str (), pc->decl->name);
+	return;
+    }
+    YCPValue value = (*(v2v)pc->decl->ptr) (boxed (r));
+    setValue (r, value);
+}
+
+
+// op_compare of anything but integers
+static OUT_OF_LINE void
+compareRegisters (Reg & r1, int op, Reg & r2)
+{
+    YCPValue value = compareValues (boxed (r1), op, boxed (r2));
+    setValue (r1, value);
+}
+
+
+// the condition of ?: is no boolean
+static OUT_OF_LINE void
+tripleError (Reg & r)
+{
+    ycp2error ("Condition expression evaluates to a non boolean value %s in ?: expression", boxed (r)->toString ().c_str ());
+    release (r);
+}
+
+
+// the condition of op_test is nil or no boolean
+static OUT_OF_LINE void
+conditionError (const YProgram::Insn *pc, Reg & r)
+{
+    if (r.tag == r_value && r.value.isNull ())
+    {
+	ycp2error (pc->mode == t_if ? "if condition is nil."
+		   : (pc->mode == t_repeat ? "until condition is nil." : "while condition is nil."));
+	return;
+    }
+
+    const YCPValue & v = boxed (r);
+    switch (pc->mode)
+    {
+	case t_if:
+	    ycp2warning (ee.filename ().c_str (), ee.linenumber (), "'if (%s)' evaluates to non-boolean '%s' (%s), using 'false' instead.", pc->code->toString ().c_str (), v->toString ().c_str (), v->valuetype_str ());
+	    break;
+	case t_while:
+	    ycp2error ("'while (%s)' evaluates to non-boolean '(%s)'.", pc->code->toString ().c_str (), v->toString ().c_str ());
+	    break;
+	case t_do:
+	    ycp2error ("'do (%s)' evaluates to non-boolean '(%s)'.", pc->code->toString ().c_str (), v->toString ().c_str ());
+	    break;
+	default:
+	    ycp2error ("'repeat ... until (%s)' evaluates to non-boolean '(%s)'.", pc->code->toString ().c_str (), v->toString ().c_str ());
+	    break;
+    }
+    release (r);
+}
+
+
+// ------------------------------------------------------------------
+// lowering
+
+// the integer operation of a binary operator, i_none if it is no
+//  builtin of YCPBuiltinInteger
+static int
+integerOperation (const declaration_t *decl)
+{
+    static const char *names[] = { "+", "-", "*", "/", "%", "&", "^", "|", "<<", ">>", 0 };
+
+    if (decl->signature == 0
+	|| strcmp (decl->signature, "integer (integer, integer)") != 0)
+    {
+	return i_none;
+    }
+    for (int i = 0; names[i] != 0; i++)
+    {
+	if (strcmp (decl->name, names[i]) == 0)
+	{
+	    return i_plus + i;
+	}
+    }
+    return i_none;
+}
+
+
+static int
+unaryOperation (const declaration_t *decl)
+{
+    if (decl->signature == 0)
+    {
+	return u_none;
+    }
+    if (strcmp (decl->signature, "integer (integer)") == 0)
+    {
+	if (strcmp (decl->name, "-") == 0)
+	    return u_neg;
+	if (strcmp (decl->name, "~") == 0)
+	    return u_bnot;
+    }
+    else if (strcmp (decl->signature, "boolean (boolean)") == 0
+	     && strcmp (decl->name, "!") == 0)
+    {
+	return u_lnot;
+    }
+    return u_none;
+}
+
+
+// && or || of YCPBuiltinBoolean, they evaluate their operands themselves
+static bool
+isLogical (const declaration_t *decl, const char *name)
+{
+    return decl->signature != 0
+	&& strcmp (decl->signature, "boolean (boolean, boolean)") == 0
+	&& strcmp (decl->name, name) == 0;
+}
+
+
+class YProgram::Compiler
+{
+public:
+    Compiler (YBlock *root, vector<YCPValue> & constants);
+
+    vector<Insn> code;
+    unsigned int registers;
+
+private:
+    // a part of the program a value ending a statement leaves through
+    //  the handler of the scope
+    struct Scope
+    {
+	enum { s_root, s_block, s_loop } kind;
+	YBlock *block;			// s_block: block with a frame, or 0
+	vector<unsigned int> handled;	// instructions going to the handler
+	vector<unsigned int> breaks;	// s_loop: jumps to the end
+	vector<unsigned int> continues;	//  and to the next iteration
+    };
+    vector<Scope> m_scopes;
+
+    vector<YCPValue> & m_constants;
+    const std::string *m_filename;	// of the root block
+
+    unsigned int emit (int op, unsigned int a = 0);
+    unsigned int here () const { return code.size (); }
+    void handled (unsigned int insn);
+    void patch (const vector<unsigned int> & insns, unsigned int target);
+
+    bool inlined (YBlock *block);
+    void block (YBlock *block);
+    void body (YCodePtr node);
+    void statement (YCodePtr stmt);
+    void loop (YCodePtr stmt);
+    void leave (int signal);
+    void expression (YCodePtr node, unsigned int dest);
+};
+
+
+YProgram::Compiler::Compiler (YBlock *root, vector<YCPValue> & constants)
+    : registers (1)
+    , m_constants (constants)
+{
+    if (root->m_filename == 0)
+    {
+	root->m_filename = ExecutionEnvironment::intern (root->filename ());
+    }
+    m_filename = root->m_filename;
+
+    // the caller pushes the frame of the root
+    Scope scope;
+    scope.kind = Scope::s_root;
+    scope.block = 0;
+    m_scopes.push_back (scope);
+
+    for (YBlock::stmtlist_t *stmt = root->m_statements; stmt; stmt = stmt->next)
+    {
+	unsigned int insn = emit (op_statement);
+	code[insn].statement = stmt->stmt;
+	statement (stmt->stmt);
+    }
+    emit (op_end);
+
+    if (! m_scopes.back ().handled.empty ())
+    {
+	patch (m_scopes.back ().handled, here ());
+	emit (op_exit);
+    }
+    m_scopes.pop_back ();
+}
+
+
+unsigned int
+YProgram::Compiler::emit (int op, unsigned int a)
+{
+    code.push_back (Insn ());
+    code.back ().op = op;
+    code.back ().a = a;
+    return code.size () - 1;
+}
+
+
+void
+YProgram::Compiler::handled (unsigned int insn)
+{
+    m_scopes.back ().handled.push_back (insn);
+}
+
+
+void
+YProgram::Compiler::patch (const vector<unsigned int> & insns, unsigned int target)
+{
+    for (vector<unsigned int>::const_iterator it = insns.begin (); it != insns.end (); ++it)
+    {
+	if (code[*it].op == op_jump)
+	{
+	    code[*it].jump = target;
+	}
+	else
+	{
+	    code[*it].handler = target;
+	}
+    }
+}
+
+
+// blocks used as statements are inlined, unless they switch to
+//  another file
+bool
+YProgram::Compiler::inlined (YBlock *block)
+{
+    if (block->m_kind != YBlock::b_statement)
+    {
+	return false;
+    }
+    if (block->m_filename == 0)
+    {
+	block->m_filename = ExecutionEnvironment::intern (block->filename ());
+    }
+    return block->m_filename->empty () || block->m_filename == m_filename;
+}
+
+
+// an inlined block, as YBlock::evaluate
+void
+YProgram::Compiler::block (YBlock *block)
+{
+    bool framed = block->symbolCount () > 0;
+
+    Scope scope;
+    scope.kind = Scope::s_block;
+    scope.block = framed ? block : 0;
+    m_scopes.push_back (scope);
+
+    if (framed)
+    {
+	emit (op_push);
+	code.back ().block = block;
+    }
+
+    for (YBlock::stmtlist_t *stmt = block->m_statements; stmt; stmt = stmt->next)
+    {
+	unsigned int insn = emit (op_statement);
+	code[insn].statement = stmt->stmt;
+	statement (stmt->stmt);
+    }
+
+    if (framed)
+    {
+	emit (op_pop);
+	code.back ().block = block;
+    }
+
+    vector<unsigned int> pending;
+    pending.swap (m_scopes.back ().handled);
+    m_scopes.pop_back ();
+
+    if (pending.empty ())
+    {
+	return;
+    }
+    if (! framed)
+    {
+	// nothing to clean up, the enclosing handler takes it
+	m_scopes.back ().handled.insert (m_scopes.back ().handled.end (), pending.begin (), pending.end ());
+	return;
+    }
+
+    unsigned int skip = emit (op_jump);
+    patch (pending, here ());
+    emit (op_pop);
+    code.back ().block = block;
+    handled (emit (op_propagate));
+    code[skip].jump = here ();
+}
+
+
+// the body of if or of a loop: a statement or a block
+void
+YProgram::Compiler::body (YCodePtr node)
+{
+    if (node == 0)
+    {
+	return;
+    }
+    if (node->kind () == YCode::yeBlock)
+    {
+	YBlockPtr b = node;
+	if (inlined (b.operator-> ()))
+	{
+	    block (b.operator-> ());
+	}
+	else
+	{
+	    handled (emit (op_execute));
+	    code.back ().code = node;
+	}
+	return;
+    }
+    statement (node);
+}
+
+
+void
+YProgram::Compiler::statement (YCodePtr stmt)
+{
+    switch (stmt->kind ())
+    {
+	case YCode::ysBlock:
+	{
+	    YSBlockPtr s = stmt;
+	    if (inlined (s->m_block.operator-> ()))
+	    {
+		block (s->m_block.operator-> ());
+		return;
+	    }
+	    break;
+	}
+	case YCode::ysAssign:
+	case YCode::ysVariable:
+	{
+	    // l = add (l, v) and the like are done in place by YSAssign
+	    YSAssignPtr s = stmt;
+	    YCode::ykind kind = s->m_code->kind ();
+	    if (kind == YCode::yeBuiltin
+		|| (kind == YCode::yeBinary
+		    && (((YEBinaryPtr)s->m_code)->decl ()->flags & (DECL_APPEND|DECL_PREPEND))))
+	    {
+		break;
+	    }
+	    expression (s->m_code, 0);
+	    emit (op_store, 0);
+	    code.back ().entry = s->m_entry;
+	    return;
+	}
+	case YCode::ysIf:
+	{
+	    YSIfPtr s = stmt;
+	    expression (s->m_condition, 0);
+	    unsigned int test = emit (op_test, 0);
+	    code[test].mode = t_if;
+	    code[test].code = s->m_condition;
+	    body (s->m_true);
+	    if (s->m_false != 0)
+	    {
+		unsigned int skip = emit (op_jump);
+		code[test].jump = here ();
+		body (s->m_false);
+		code[skip].jump = here ();
+	    }
+	    else
+	    {
+		code[test].jump = here ();
+	    }
+	    code[test].jump2 = here ();
+	    return;
+	}
+	case YCode::ysWhile:
+	case YCode::ysDo:
+	case YCode::ysRepeat:
+	    loop (stmt);
+	    return;
+	case YCode::ysReturn:
+	{
+	    YSReturnPtr s = stmt;
+	    if (s->m_value != 0)
+	    {
+		expression (s->m_value, 0);
+		handled (emit (op_return, 0));
+		code.back ().mode = 1;
+	    }
+	    else
+	    {
+		handled (emit (op_return));
+	    }
+	    return;
+	}
+	case YCode::ysBreak:
+	    leave (s_break);
+	    return;
+	case YCode::ysContinue:
+	    leave (s_continue);
+	    return;
+	default:
+	    break;
+    }
+
+    handled (emit (op_execute));
+    code.back ().code = stmt;
+}
+
+
+// while, do and repeat
+void
+YProgram::Compiler::loop (YCodePtr stmt)
+{
+    YCode::ykind kind = stmt->kind ();
+    YCodePtr condition;
+    YCodePtr loop;
+    if (kind == YCode::ysWhile)
+    {
+	YSWhilePtr s = stmt;
+	condition = s->m_condition;
+	loop = s->m_loop;
+    }
+    else if (kind == YCode::ysDo)
+    {
+	YSDoPtr s = stmt;
+	condition = s->m_condition;
+	loop = s->m_loop;
+    }
+    else
+    {
+	YSRepeatPtr s = stmt;
+	condition = s->m_condition;
+	loop = s->m_loop;
+    }
+
+    Scope scope;
+    scope.kind = Scope::s_loop;
+    scope.block = 0;
+
+    unsigned int top = here ();
+    unsigned int test = 0;
+    unsigned int next;		// where continue goes
+
+    if (kind == YCode::ysWhile)
+    {
+	next = top;
+	expression (condition, 0);
+	test = emit (op_test, 0);
+	code[test].mode = t_while;
+	code[test].code = condition;
+
+	m_scopes.push_back (scope);
+	body (loop);
+	emit (op_jump);
+	code.back ().jump = top;
+    }
+    else
+    {
+	m_scopes.push_back (scope);
+	body (loop);
+
+	next = here ();
+	expression (condition, 0);
+	test = emit (op_test, 0);
+	code[test].mode = (kind == YCode::ysDo) ? t_do : t_repeat;
+	code[test].code = condition;
+	emit (op_jump);
+	code.back ().jump = top;
+    }
+
+    Scope & current = m_scopes.back ();
+    patch (current.continues, next);
+    vector<unsigned int> breaks;
+    breaks.swap (current.breaks);
+    vector<unsigned int> pending;
+    pending.swap (current.handled);
+    m_scopes.pop_back ();
+
+    unsigned int handler = 0;
+    if (! pending.empty ())
+    {
+	patch (pending, here ());
+	handler = emit (op_handle);
+	code[handler].mode = (kind == YCode::ysWhile) ? h_while : h_do;
+	code[handler].jump2 = next;
+	handled (handler);
+    }
+
+    unsigned int end = here ();
+    code[test].jump = end;
+    code[test].jump2 = end;
+    if (! pending.empty ())
+    {
+	code[handler].jump = end;
+    }
+    patch (breaks, end);
+}
+
+
+// break or continue: straight to the enclosing loop, popping the
+//  frames of the inlined blocks on the way; without an enclosing
+//  loop the value leaves the program like with the tree
+void
+YProgram::Compiler::leave (int signal)
+{
+    int s = m_scopes.size () - 1;
+    while (s >= 0 && m_scopes[s].kind == Scope::s_block)
+    {
+	s--;
+    }
+    if (s < 0 || m_scopes[s].kind != Scope::s_loop)
+    {
+	handled (emit (op_signal));
+	code.back ().mode = signal;
+	return;
+    }
+
+    for (int i = m_scopes.size () - 1; i > s; i--)
+    {
+	if (m_scopes[i].block != 0)
+	{
+	    emit (op_pop);
+	    code.back ().block = m_scopes[i].block;
+	}
+    }
+    unsigned int jump = emit (op_jump);
+    if (signal == s_break)
+    {
+	m_scopes[s].breaks.push_back (jump);
+    }
+    else
+    {
+	m_scopes[s].continues.push_back (jump);
+    }
+}
+
+
+// the value of node to register dest, the registers above dest are
+//  free for temporaries
+void
+YProgram::Compiler::expression (YCodePtr node, unsigned int dest)
+{
+    if (dest + 1 > registers)
+    {
+	registers = dest + 1;
+    }
+
+    switch (node->kind ())
+    {
+	case YCode::ycInteger:
+	    emit (op_integer, dest);
+	    code.back ().value = ((YConstPtr)node)->value ()->asInteger ()->value ();
+	    return;
+	case YCode::ycBoolean:
+	    emit (op_boolean, dest);
+	    code.back ().value = ((YConstPtr)node)->value ()->asBoolean ()->value ();
+	    return;
+	case YCode::ycVoid:
+	case YCode::ycFloat:
+	case YCode::ycString:
+	case YCode::ycByteblock:
+	case YCode::ycPath:
+	case YCode::ycSymbol:
+	case YCode::ycList:
+	case YCode::ycMap:
+	case YCode::ycTerm:
+	    emit (op_constant, dest);
+	    code.back ().value = m_constants.size ();
+	    m_constants.push_back (((YConstPtr)node)->value ());
+	    return;
+	case YCode::yeVariable:
+	    emit (op_load, dest);
+	    code.back ().code = node;
+	    code.back ().entry = ((YEVariablePtr)node)->entry ();
+	    return;
+	case YCode::yeBinary:
+	{
+	    YEBinaryPtr e = node;
+	    declaration_t *decl = e->decl ();
+	    if (decl->flags & DECL_NOEVAL)
+	    {
+		bool conjunction = isLogical (decl, "&&");
+		if (! conjunction && ! isLogical (decl, "||"))
+		{
+		    break;
+		}
+		expression (e->arg1 (), dest);
+		unsigned int first = emit (op_logical, dest);
+		code[first].mode = conjunction ? l_and1 : l_or1;
+		expression (e->arg2 (), dest);
+		emit (op_logical, dest);
+		code.back ().mode = conjunction ? l_and2 : l_or2;
+		code[first].jump = here ();
+		return;
+	    }
+
+	    expression (e->arg1 (), dest);
+	    // the first argument is checked before the second one is
+	    //  evaluated, unless that is a constant: op_binary checks
+	    //  both then
+	    YCode::ykind kind = e->arg2 ()->kind ();
+	    bool checked = (decl->flags & DECL_NIL) == 0
+		&& ! (kind >= YCode::ycVoid && kind <= YCode::ycTerm);
+	    unsigned int argument = 0;
+	    if (checked)
+	    {
+		argument = emit (op_argument, dest);
+		code[argument].code = e->arg1 ();
+		code[argument].decl = decl;
+	    }
+	    expression (e->arg2 (), dest + 1);
+	    emit (op_binary, dest);
+	    code.back ().b = dest + 1;
+	    code.back ().mode = integerOperation (decl);
+	    code.back ().code = e->arg1 ();
+	    code.back ().code2 = e->arg2 ();
+	    code.back ().decl = decl;
+	    if (checked)
+	    {
+		code[argument].jump = here ();
+	    }
+	    return;
+	}
+	case YCode::yeUnary:
+	{
+	    YEUnaryPtr e = node;
+	    expression (e->m_arg, dest);
+	    emit (op_unary, dest);
+	    code.back ().mode = unaryOperation (e->m_decl);
+	    code.back ().code = e->m_arg;
+	    code.back ().decl = e->m_decl;
+	    return;
+	}
+	case YCode::yeCompare:
+	{
+	    YEComparePtr e = node;
+	    expression (e->m_left, dest);
+	    expression (e->m_right, dest + 1);
+	    emit (op_compare, dest);
+	    code.back ().b = dest + 1;
+	    code.back ().mode = e->m_op;
+	    return;
+	}
+	case YCode::yeTriple:
+	{
+	    YETriplePtr e = node;
+	    expression (e->m_expr, dest);
+	    unsigned int test = emit (op_triple, dest);
+	    expression (e->m_true, dest);
+	    unsigned int skip = emit (op_jump);
+	    code[test].jump = here ();
+	    expression (e->m_false, dest);
+	    code[skip].jump = here ();
+	    code[test].jump2 = here ();
+	    return;
+	}
+	default:
+	    break;
+    }
+
+    emit (op_evaluate, dest);
+    code.back ().code = node;
+}
+
+
+// ------------------------------------------------------------------
+
+YProgram::YProgram (YBlock *block)
+{
+    Compiler compiler (block, m_constants);
+
+    m_size = compiler.code.size ();
+    m_registers = compiler.registers;
+    m_code = new Insn[m_size];
+    for (unsigned int i = 0; i < m_size; i++)
+    {
+	m_code[i] = compiler.code[i];
+    }
+#if DO_DEBUG
+    y2debug ("YProgram (%s): %u instructions, %u registers", block->toString ().c_str (), m_size, m_registers);
+#endif
+}
+
+
+YProgram::~YProgram ()
+{
+    delete [] m_code;
+}
+
+
+bool
+YProgram::enabled ()
+{
+    static int enabled = -1;
+    if (enabled < 0)
+    {
+	const char *s = getenv (Y2VM);
+	enabled = (s == 0 || strcmp (s, "0") != 0) ? 1 : 0;
+    }
+    return enabled;
+}
+
+
+#ifdef THREADED_DISPATCH
+#define CASE(op)	case op: l_##op
+#define NEXT		goto *labels[pc->op]
+#else
+#define CASE(op)	case op
+#define NEXT		continue
+#endif
+
+YCPValue
+YProgram::run () const
+{
+#ifdef THREADED_DISPATCH
+    // in the order of the op_* codes
+    static void *labels[] = {
+	&&l_op_statement, &&l_op_execute, &&l_op_evaluate,
+	&&l_op_integer, &&l_op_boolean, &&l_op_constant,
+	&&l_op_load, &&l_op_store, &&l_op_argument, &&l_op_binary,
+	&&l_op_unary, &&l_op_compare, &&l_op_logical, &&l_op_triple,
+	&&l_op_test, &&l_op_jump, &&l_op_push, &&l_op_pop,
+	&&l_op_signal, &&l_op_return, &&l_op_propagate, &&l_op_handle,
+	&&l_op_exit, &&l_op_end
+    };
+#endif
+
+    Reg regs[m_registers];
+    YCPValue sig = YCPNull ();		// the value ending a statement
+    const Insn *code = m_code;
+    const Insn *pc = code;
+
+    for (;;)
+    {
+	switch (pc->op)
+	{
+	    CASE (op_statement):
+		ee.setStatement (pc->statement);
+		pc++;
+		NEXT;
+
+	    CASE (op_execute):
+		sig = pc->code->evaluate ();
+		if (sig.isNull ())
+		{
+		    pc++;
+		}
+		else
+		{
+		    pc = code + pc->handler;
+		}
+		NEXT;
+
+	    CASE (op_evaluate):
+		setValue (regs[pc->a], pc->code->evaluate ());
+		pc++;
+		NEXT;
+
+	    CASE (op_integer):
+		setInteger (regs[pc->a], pc->value);
+		pc++;
+		NEXT;
+
+	    CASE (op_boolean):
+		setBoolean (regs[pc->a], pc->value != 0);
+		pc++;
+		NEXT;
+
+	    CASE (op_constant):
+		setValue (regs[pc->a], m_constants[pc->value]);
+		pc++;
+		NEXT;
+
+	    CASE (op_load):
+	    {
+		// as YEVariable::evaluate
+		Reg & r = regs[pc->a];
+		const YCPValue *slot = pc->entry->slot ();
+		if (slot != 0 && ! slot->isNull ())
+		{
+		    load (r, *slot);
+		}
+		else
+		{
+		    loadEntry (pc, r, slot != 0);
+		}
+		pc++;
+		NEXT;
+	    }
+
+	    CASE (op_store):
+	    {
+		// as YSAssign::evaluate
+		YCPValue value = take (regs[pc->a]);
+		if (value.isNull ())
+		{
+		    value = YCPVoid ();
+		}
+		YCPValue *slot = pc->entry->slot ();
+		if (slot)
+		{
+		    *slot = value;
+		}
+		else
+		{
+		    pc->entry->setValue (value);
+		}
+		pc++;
+		NEXT;
+	    }
+
+	    CASE (op_argument):
+		if (isNil (regs[pc->a]))
+		{
+		    nilArgument (pc->code, pc->decl);
+		    release (regs[pc->a]);
+		    pc = code + pc->jump;
+		}
+		else
+		{
+		    pc++;
+		}
+		NEXT;
+
+	    CASE (op_binary):
+	    {
+		// as YEBinary::evaluate
+		Reg & r1 = regs[pc->a];
+		Reg & r2 = regs[pc->b];
+		long long i1, i2;
+		if (pc->mode != i_none
+		    && integerOf (r1, i1)
+		    && integerOf (r2, i2))
+		{
+		    long long i = 0;
+		    bool done = true;
+		    switch (pc->mode)
+		    {
+			case i_plus:	i = i1 + i2; break;
+			case i_minus:	i = i1 - i2; break;
+			case i_mult:	i = i1 * i2; break;
+			case i_div:	if (i2 == 0) done = false; else i = i1 / i2; break;
+			case i_mod:	if (i2 == 0) done = false; else i = i1 % i2; break;
+			case i_and:	i = i1 & i2; break;
+			case i_xor:	i = i1 ^ i2; break;
+			case i_or:	i = i1 | i2; break;
+			case i_left:	i = i1 << i2; break;
+			case i_right:	i = i1 >> i2; break;
+		    }
+		    if (done)
+		    {
+			setInteger (r1, i);
+			pc++;
+			NEXT;
+		    }
+		}
+		callBinary (pc, r1, r2);
+		pc++;
+		NEXT;
+	    }
+
+	    CASE (op_unary):
+	    {
+		// as YEUnary::evaluate
+		Reg & r = regs[pc->a];
+		long long i;
+		bool b;
+		if (pc->mode == u_neg && integerOf (r, i))
+		{
+		    setInteger (r, -i);
+		}
+		else if (pc->mode == u_bnot && integerOf (r, i))
+		{
+		    setInteger (r, ~i);
+		}
+		else if (pc->mode == u_lnot && booleanOf (r, b))
+		{
+		    setBoolean (r, !b);
+		}
+		else
+		{
+		    callUnary (pc, r);
+		}
+		pc++;
+		NEXT;
+	    }
+
+	    CASE (op_compare):
+	    {
+		// as YECompare::evaluate
+		Reg & r1 = regs[pc->a];
+		Reg & r2 = regs[pc->b];
+		long long i1, i2;
+		if (integerOf (r1, i1) && integerOf (r2, i2))
+		{
+		    setBoolean (r1, compareIntegers (i1, pc->mode, i2));
+		}
+		else
+		{
+		    compareRegisters (r1, pc->mode, r2);
+		}
+		release (r2);
+		pc++;
+		NEXT;
+	    }
+
+	    CASE (op_logical):
+	    {
+		// as b_and and b_or of YCPBuiltinBoolean
+		Reg & r = regs[pc->a];
+		switch (pc->mode)
+		{
+		    case l_and1:
+			if (isNil (r))
+			{
+			    warning ("First operand of '&&' evaluates to nil, using 'false' instead.");
+			    setBoolean (r, false);
+			    pc = code + pc->jump;
+			    NEXT;
+			}
+			if (! truthOf (r))
+			{
+			    setBoolean (r, false);
+			    pc = code + pc->jump;
+			    NEXT;
+			}
+			break;
+		    case l_or1:
+			if (isNil (r))
+			{
+			    warning ("First operand of '||' evaluates to nil, using 'false' instead.");
+			}
+			else if (truthOf (r))
+			{
+			    setBoolean (r, true);
+			    pc = code + pc->jump;
+			    NEXT;
+			}
+			break;
+		    case l_and2:
+		    case l_or2:
+			if (isNil (r))
+			{
+			    warning (pc->mode == l_and2
+				     ? "Second operand of '&&' evaluates to nil, using 'false' instead."
+				     : "Second operand of '||' evaluates to nil, using 'false' instead.");
+			    setBoolean (r, false);
+			}
+			else
+			{
+			    setBoolean (r, truthOf (r));
+			}
+			break;
+		}
+		pc++;
+		NEXT;
+	    }
+
+	    CASE (op_triple):
+	    {
+		// as YETriple::evaluate
+		Reg & r = regs[pc->a];
+		bool b;
+		if (isNil (r))
+		{
+		    warning ("Condition expression evaluates to nil in ?: expression, using false instead.");
+		    pc = code + pc->jump;
+		}
+		else if (booleanOf (r, b))
+		{
+		    pc = b ? pc + 1 : code + pc->jump;
+		}
+		else
+		{
+		    tripleError (r);
+		    pc = code + pc->jump2;
+		}
+		NEXT;
+	    }
+
+	    CASE (op_test):
+	    {
+		// the condition of YSIf, YSWhile, YSDo and YSRepeat
+		Reg & r = regs[pc->a];
+		if (r.tag == r_value && r.value.isNull ())
+		{
+		    conditionError (pc, r);
+		    pc = code + pc->jump2;
+		    NEXT;
+		}
+		bool b;
+		if (! booleanOf (r, b))
+		{
+		    conditionError (pc, r);
+		    pc = code + (pc->mode == t_if ? pc->jump : pc->jump2);
+		    NEXT;
+		}
+		release (r);
+		if (pc->mode == t_repeat ? b : !b)
+		{
+		    pc = code + pc->jump;
+		}
+		else
+		{
+		    pc++;
+		}
+		NEXT;
+	    }
+
+	    CASE (op_jump):
+		pc = code + pc->jump;
+		NEXT;
+
+	    CASE (op_push):
+		pc->block->pushFrame ();
+		pc++;
+		NEXT;
+
+	    CASE (op_pop):
+		pc->block->popFrame (true);
+		pc++;
+		NEXT;
+
+	    CASE (op_signal):
+		if (pc->mode == s_break)
+		{
+		    sig = YCPBreak ();
+		}
+		else
+		{
+		    sig = YCPVoid ();
+		}
+		pc = code + pc->handler;
+		NEXT;
+
+	    CASE (op_return):
+	    {
+		// as YSReturn::evaluate, 'return nil;' is 'return;'
+		sig = pc->mode ? take (regs[pc->a]) : YCPNull ();
+		if (sig.isNull ()
+		    || sig->isVoid ())
+		{
+		    sig = YCPReturn ();
+		}
+		pc = code + pc->handler;
+		NEXT;
+	    }
+
+	    CASE (op_propagate):
+		pc = code + pc->handler;
+		NEXT;
+
+	    CASE (op_handle):
+		// as the loops treat the value of their body
+		if (pc->mode == h_while)
+		{
+		    if (sig->isBreak ())
+		    {
+			sig = YCPNull ();
+			pc = code + pc->jump;
+		    }
+		    else if (sig->isReturn ())	// also void, keep the order
+		    {
+			pc = code + pc->handler;
+		    }
+		    else if (sig->isVoid ())	// continue
+		    {
+			sig = YCPNull ();
+			pc = code + pc->jump2;
+		    }
+		    else
+		    {
+			pc = code + pc->handler;
+		    }
+		}
+		else
+		{
+		    // do and repeat take 'return;' for 'continue'
+		    if (sig->isVoid ())
+		    {
+			sig = YCPNull ();
+			pc = code + pc->jump2;
+		    }
+		    else if (sig->isBreak ())
+		    {
+			sig = YCPNull ();
+			pc = code + pc->jump;
+		    }
+		    else
+		    {
+			pc = code + pc->handler;
+		    }
+		}
+		NEXT;
+
+	    CASE (op_exit):
+		return sig;
+
+	    CASE (op_end):
+		return YCPNull ();
+
+	    default:
+		y2internal ("YProgram: unknown operation %d", pc->op);
+		return YCPNull ();
+	}
+    }
+}
@@ -35,6 +35,7 @@
 
 #include "ycp/y2log.h"
 #include "ycp/ExecutionEnvironment.h"
+#include "ycp/Profiler.h"
 
 #include "y2/Y2Component.h"
 #include "y2/Y2ComponentBroker.h"
@@ -271,6 +272,20 @@ YSExpression::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSExpression::optimize (int & removed)
+{
+    optimizeChild (m_expr, removed);
+
+    // a constant expression statement has no effect
+    if (m_expr->isConstant ())
+    {
+	return 0;
+    }
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // block as statement
 
@@ -327,6 +342,19 @@ YSBlock::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSBlock::optimize (int & removed)
+{
+    m_block->optimize (removed);
+
+    if (m_block->statementCount () == 0)
+    {
+	return 0;
+    }
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // return
 
@@ -448,6 +476,14 @@ YSReturn::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSReturn::optimize (int & removed)
+{
+    optimizeChild (m_value, removed);
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // function definition
 
@@ -497,6 +533,18 @@ YSFunction::evaluate (bool /*cse*/)
 }
 
 
+YCodePtr
+YSFunction::optimize (int & removed)
+{
+    YFunctionPtr func = function ();
+    if (func != 0)
+    {
+	func->optimize (removed);
+    }
+    return this;
+}
+
+
 YSFunction::YSFunction (bytecodeistream & str)
     : YStatement (str)
     , m_entry (Bytecode::readEntry (str))
@@ -597,12 +645,18 @@ YSAssign::YSAssign (SymbolEntryPtr entry, YCodePtr code, int line)
     : YStatement (line)
     , m_entry (entry)
     , m_code (code)
+    , m_extend (extend_unknown)
+    , m_extenddecl (0)
+    , m_extendvalue (0)
 {
 }
 
 
 YSAssign::YSAssign (bytecodeistream & str)
     : YStatement (str)
+    , m_extend (extend_unknown)
+    , m_extenddecl (0)
+    , m_extendvalue (0)
 {
     m_entry = Bytecode::readEntry (str);
     m_code = Bytecode::readCode (str);
@@ -643,6 +697,124 @@ YSAssign::toXml( std::ostream & str, int /*indent*/ ) const
 }
 
 
+// check for <m_entry> = add (<m_entry>, value) and the like
+
+void
+YSAssign::resolveExtend ()
+{
+    m_extend = extend_none;
+
+    YCodePtr list = 0;
+    if (m_code->kind () == yeBuiltin)
+    {
+	YEBuiltinPtr builtin = m_code;
+	ycodelist_t *params = builtin->parameters ();
+	if (params == 0
+	    || params->next == 0
+	    || params->next->next != 0)
+	{
+	    return;
+	}
+	m_extenddecl = builtin->decl ();
+	list = params->code;
+	m_extendvalue = params->next->code;
+    }
+    else if (m_code->kind () == yeBinary)
+    {
+	YEBinaryPtr binary = m_code;
+	m_extenddecl = binary->decl ();
+	list = binary->arg1 ();
+	m_extendvalue = binary->arg2 ();
+    }
+    else
+    {
+	return;
+    }
+
+    if (list->kind () != yeVariable
+	|| ((YEVariablePtr)list)->entry () != m_entry)
+    {
+	m_extendvalue = 0;
+	return;
+    }
+
+    if (m_extenddecl->flags & DECL_APPEND)
+    {
+	m_extend = extend_append;
+    }
+    else if (m_extenddecl->flags & DECL_PREPEND)
+    {
+	m_extend = extend_prepend;
+    }
+    else
+    {
+	m_extendvalue = 0;
+    }
+}
+
+
+// l = add (l, v): take the list out of the variable while adding, so
+// it is not copied if the variable is its only owner. Then add () is
+// amortized O(1) instead of copying the list each time.
+// Returns false if the variable holds no list, the caller evaluates
+// the builtin as usual then.
+
+bool
+YSAssign::evaluateExtend ()
+{
+    YCPValue current = m_entry->value ();
+    if (current.isNull ()
+	|| !current->isList ())
+    {
+	return false;
+    }
+
+    YCPValue value = m_extendvalue->evaluate ();
+    if ((value.isNull () || value->isVoid ())
+	&& (m_extenddecl->flags & DECL_NIL) == 0)
+    {
+	if (m_code->kind () == yeBinary)
+	{
+	    ycp2error ("Argument (%s) to %s(...) evaluates to nil", m_extendvalue->toString().c_str(), m_extenddecl->name);
+	}
+	else
+	{
+	    ycp2error ("Argument (%s) to %s(...) is nil", m_extendvalue->toString().c_str(), m_extenddecl->name);
+	}
+	m_entry->setValue (YCPVoid ());
+	return true;
+    }
+
+    if (profiler_instance)
+    {
+	profiler_instance->enterBuiltin (m_extenddecl);
+    }
+
+    // not nil, setValue would overwrite a reference instead of
+    // assigning through it
+    m_entry->setValue (YCPVoid ());
+
+    YCPList list = current->asList ();
+    current = YCPNull ();
+    if (m_extend == extend_append)
+    {
+	list->add (value);
+    }
+    else
+    {
+	list->prepend (value);
+    }
+    m_entry->setValue (list);
+
+    if (profiler_instance)
+    {
+	profiler_instance->leave ();
+    }
+
+    return true;
+}
+
+
 YCPValue
 YSAssign::evaluate (bool cse)
 {
@@ -650,8 +822,32 @@ YSAssign::evaluate (bool cse)
 #if DO_DEBUG
     y2debug ("YSAssign::evaluate(%s)\n", toString().c_str());
 #endif
+    if (m_extend == extend_unknown)
+    {
+	resolveExtend ();
+    }
+    if (m_extend != extend_none
+	&& evaluateExtend ())
+    {
+	return YCPNull();
+    }
+
     YCPValue value = m_code->evaluate ();
-    m_entry->setValue (value.isNull() ? YCPVoid() : value);
+    if (value.isNull())
+    {
+	value = YCPVoid();
+    }
+
+    // a local variable is assigned in its slot in the active frame
+    YCPValue *slot = m_entry->slot ();
+    if (slot)
+    {
+	*slot = value;
+    }
+    else
+    {
+	m_entry->setValue (value);
+    }
 #if DO_DEBUG
     y2debug ("YSAssign::evaluate (%s) = '%s'\n", m_code->toString().c_str(), value.isNull() ? "NULL" : value->toString().c_str());
 #endif
@@ -660,6 +856,16 @@ YSAssign::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSAssign::optimize (int & removed)
+{
+    optimizeChild (m_code, removed);
+    m_extend = extend_unknown;
+    m_extendvalue = 0;
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // variable definition
 
@@ -757,19 +963,27 @@ YSBracket::toXml( std::ostream & str, int indent ) const
 
 
 // commit bracket assign recursively
+//
+// current is updated in place. Each level takes the element it descends
+// into out of its container before recursing, so a structure which is
+// not shared with other values is uniquely owned on every level and
+// gets modified without copying. Only shared levels are copied (by
+// the copy-on-write of set () and add ()).
+// On error, current is left holding the (unmodified) structure.
 
-YCPValue
-YSBracket::commit (YCPValue current, int idx, YCPList arg, YCPValue value)
+bool
+YSBracket::commit (YCPValue & current, int idx, const YCPList & arg, const YCPValue & value)
 {
     if (arg.isNull()
 	|| (idx > arg->size()))
     {
-	return YCPNull();
+	return false;
     }
 
     if (idx == arg->size())
     {
-	return value;
+	current = value;
+	return true;
     }
 
     if (current.isNull ())
@@ -782,7 +996,7 @@ YSBracket::commit (YCPValue current, int idx, YCPList arg, YCPValue value)
 	}
 
 	ycp2error ("Intermediate structure with index %s does not exist", correct_until->toString ().c_str ());
-	return YCPNull ();
+	return false;
     }
 #if DO_DEBUG	
     y2debug ("commit (%s, %d, %s, %s)", current->toString().c_str(), idx, arg->toString().c_str(), value.isNull () ? "nil" : value->toString().c_str());
@@ -791,29 +1005,42 @@ YSBracket::commit (YCPValue current, int idx, YCPList arg, YCPValue value)
     if (argval.isNull())
     {
 	ycp2error ("Invalid bracket parameter 'nil'");
-	return YCPNull ();
+	return false;
     }
 
+    // not the end of the argument list, continue
+    bool descend = (idx < arg->size ()-1);
+
     if (current->isList())
     {
 	if (!argval->isInteger())
 	{
 	    ycp2error ("Invalid bracket parameter for list, expected integer, seen '%s'", argval->toString().c_str());
-	    return YCPNull ();
+	    return false;
 	}
 
+	// drop our second handle, the list must only be held by 'list'
 	YCPList list = current->asList();
+	current = YCPNull ();
 	int argint = argval->asInteger()->value();
 	
 	YCPValue val = value;
 
-	//  not the end of the argument list, continue
-	if (idx < arg->size ()-1)
+	if (descend)
 	{
-	    val = commit (list->value (argint), idx+1, arg, value);		// recurse
-	    if (val.isNull ())
+	    val = list->value (argint);
+	    if (!val.isNull ())
+	    {
+		list->set (argint, YCPVoid ());
+	    }
+	    if (!commit (val, idx+1, arg, value))		// recurse
 	    {
-		return val;
+		if (!val.isNull ())
+		{
+		    list->set (argint, val);
+		}
+		current = list;
+		return false;
 	    }
 	}
 	
@@ -821,52 +1048,76 @@ YSBracket::commit (YCPValue current, int idx, YCPList arg, YCPValue value)
 #if DO_DEBUG	
     y2debug ("list[%d] = %s -> %s", argint, val->toString().c_str(), list->toString().c_str());
 #endif
-	return list;
+	current = list;
+	return true;
     }
     else if (current->isMap())
     {
 	YCPMap map = current->asMap();
+	current = YCPNull ();
 	
 	YCPValue val = value;
 	
-	if (idx < arg->size ()-1)
+	if (descend)
 	{
-	    val = commit (map->value (argval), idx+1, arg, value);		// recurse
-	    if (val.isNull ())
+	    val = map->value (argval);
+	    if (!val.isNull ())
+	    {
+		map->add (argval, YCPVoid ());
+	    }
+	    if (!commit (val, idx+1, arg, value))		// recurse
 	    {
-		return val;
+		if (!val.isNull ())
+		{
+		    map->add (argval, val);
+		}
+		current = map;
+		return false;
 	    }
 	}
-	map = map->functionalAdd (argval, val.isNull() ? YCPVoid() : val);
+	map->add (argval, val.isNull() ? YCPVoid() : val);
 #if DO_DEBUG	
     y2debug ("map[%s] = %s -> %s", argval->toString().c_str(), val->toString().c_str(), map->toString().c_str());
 #endif
-	return map;
+	current = map;
+	return true;
     }
     else if (current->isTerm())
     {
 	if (!argval->isInteger())
 	{
 	    ycp2error ("Invalid bracket parameter for term, expected integer, seen '%s'", argval->toString().c_str());
-	    return YCPNull ();
+	    return false;
 	}
 	YCPTerm term = current->asTerm();
+	current = YCPNull ();
 	int argint = argval->asInteger()->value();
 	
 	YCPValue val = value;
 	
-	// not the end of the argument list, continue
-	if (idx < arg->size ()-1)
+	if (descend)
 	{
-	    val = commit (term->value (argint), idx+1, arg, value);
-	    if (val.isNull ())
-		return val;
+	    val = term->value (argint);
+	    if (!val.isNull ())
+	    {
+		term->set (argint, YCPVoid ());
+	    }
+	    if (!commit (val, idx+1, arg, value))
+	    {
+		if (!val.isNull ())
+		{
+		    term->set (argint, val);
+		}
+		current = term;
+		return false;
+	    }
 	}
-	term->set (argval->asInteger()->value(), val.isNull() ? YCPVoid() : val);
-	return term;
+	term->set (argint, val.isNull() ? YCPVoid() : val);
+	current = term;
+	return true;
     }
     ycp2error ("Bracket assignment '%s'['%s'] = '%s', not to list, map, or term", current->toString().c_str(), argval->toString().c_str(), value->toString().c_str());
-    return YCPNull ();
+    return false;
 }
 
 
@@ -910,18 +1161,30 @@ YSBracket::evaluate (bool cse)
 	return YCPNull ();
     }
 
-    result = commit (result, 0, arg_value->asList(), newvalue.isNull() ? YCPVoid() : newvalue);
+    // take the value out of the variable while it is modified, so it
+    // is not copied just because the variable still refers to it.
+    // (not nil, setValue would overwrite a reference instead of
+    // assigning through it)
+    m_entry->setValue (YCPVoid ());
 
-    if (!result.isNull())
-    {
-	m_entry->setValue (result);
+    // on error result holds the unchanged value, put it back
+    commit (result, 0, arg_value->asList(), newvalue.isNull() ? YCPVoid() : newvalue);
+
+    m_entry->setValue (result);
 #if DO_DEBUG
 y2debug ("%s = %s", m_entry->name(), result->toString().c_str());
 #endif
-	result = YCPNull();
-    }
 
-    return result;
+    return YCPNull();
+}
+
+
+YCodePtr
+YSBracket::optimize (int & removed)
+{
+    optimizeChild (m_arg, removed);
+    optimizeChild (m_code, removed);
+    return this;
 }
 
 
@@ -1065,6 +1328,29 @@ YSIf::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSIf::optimize (int & removed)
+{
+    optimizeChild (m_condition, removed);
+    optimizeChild (m_true, removed);
+    optimizeChild (m_false, removed);
+
+    if (m_condition->kind () != ycBoolean)
+    {
+	return this;
+    }
+
+    // constant condition, only one branch is ever taken
+    YCodePtr taken = ((YConstPtr)m_condition)->value ()->asBoolean ()->value () ? m_true : m_false;
+    if (taken != 0)
+    {
+	removed += 2;			// the 'if' and its condition
+	return taken;
+    }
+    return 0;
+}
+
+
 // ------------------------------------------------------------------
 // while-do statement (-> bool condition, loop statement)
 
@@ -1237,6 +1523,22 @@ YSWhile::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSWhile::optimize (int & removed)
+{
+    optimizeChild (m_condition, removed);
+    optimizeChild (m_loop, removed);
+
+    // 'while (false)' never executes its body
+    if (m_condition->kind () == ycBoolean
+	&& ! ((YConstPtr)m_condition)->value ()->asBoolean ()->value ())
+    {
+	return 0;
+    }
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // repeat-until statement (-> loop statement, bool condition)
 
@@ -1376,6 +1678,15 @@ YSRepeat::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSRepeat::optimize (int & removed)
+{
+    optimizeChild (m_loop, removed);
+    optimizeChild (m_condition, removed);
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // do-while statement (-> loop statement, bool condition)
 
@@ -1513,6 +1824,15 @@ YSDo::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSDo::optimize (int & removed)
+{
+    optimizeChild (m_loop, removed);
+    optimizeChild (m_condition, removed);
+    return this;
+}
+
+
 // ------------------------------------------------------------------
 // textdomain
 
@@ -1761,6 +2081,10 @@ YSImport::toStream (std::ostream & str) const
 {
     YStatement::toStream (str);
     Bytecode::writeUstring (str, m_name);
+    if (Bytecode::writingSections ())
+    {
+	Bytecode::writeImport (m_name.asString ());
+    }
 
     SymbolTable *table = m_module->second->table();
     table->writeUsage (str);
@@ -2008,6 +2332,20 @@ YSSwitch::evaluate (bool cse)
 }
 
 
+YCodePtr
+YSSwitch::optimize (int & removed)
+{
+    optimizeChild (m_condition, removed);
+
+    // the cases refer to statement positions, don't drop any
+    if (m_block != 0)
+    {
+	m_block->optimizeStatements (removed, true);
+    }
+    return this;
+}
+
+
 bool
 YSSwitch::setCase (YCPValue value)
 {
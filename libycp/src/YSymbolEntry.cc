@@ -84,16 +84,10 @@ YSymbolEntry::YSymbolEntry (bytecodeistream & str, const Y2Namespace *name_space
     m_global = Bytecode::readBool (str);
     m_namespace = name_space;
     m_position = Bytecode::readInt32 (str);
-    m_name = Ustring (*_nameHash, "");		// no default constructor for Ustring available
     m_value = YCPNull();			// value stays NULL to enforce re-initialization from payload
 
-    // read name, put to Ustring, delete name
-    //  thats the only way to preserve the argument to Ustring
-    //  without breaking existing bytecode
-
-    char *mname = Bytecode::readCharp (str);
-    m_name = Ustring (*_nameHash, mname);
-    delete [] mname;
+    // written by writeCharp, which readUstring reads as well
+    m_name = Bytecode::readUstring (str);
 
     m_category  = (category_t)Bytecode::readInt32 (str);
     m_type = Bytecode::readType (str);
@@ -151,7 +145,7 @@ bool
 YSymbolEntry::onlyDeclared () const
 {
     return (m_category == c_function)			// only functions may be 'only declared'
-	   && (((YFunctionPtr)m_code)->definition() == 0);
+	   && !((YFunctionPtr)m_code)->hasDefinition();
 }
 
 
@@ -31,29 +31,203 @@
 #include "ycp/Type.h"
 
 class Y2Namespace;
+class TableEntry;
 
 #include <iosfwd>
 #include <string>
 #include <map>
+#include <vector>
 
 #include <fstream>
 
-/// An istream that remembers some data about the bytecode.
-class bytecodeistream : public std::ifstream
+/**
+ * Input of a .ybc file, remembering some data about the bytecode.
+ *
+ * A large regular file is mapped into memory as a whole and decoded
+ * in place, small files and other inputs (pipes, devices) are read
+ * into memory first.
+ * Both behave like an istream for the few operations used here:
+ * reading beyond the end fails, the stream is no longer good () and
+ * converts to false, as does every later read.
+ *
+ * Files of version 1.5 and later consist of sections, listed in an
+ * index after the header (see Bytecode::writeFile). The index and the
+ * string table are read when the stream is opened, a Section moves
+ * the stream to another section for a while.
+ *
+ * Function definitions of such files are read on first use, see
+ * LazyDefinition; they keep the stream open (ref () and unref ()).
+ */
+class bytecodeistream
 {
 	int m_major, m_minor, m_release;
+	string m_filename;
+	int m_users;
+
+	// the file, mapped or read into m_buffer
+	const char *m_data;
+	size_t m_size;
+	bool m_mapped;
+	std::vector<char> m_buffer;
+
+	size_t m_pos;
+	size_t m_end;			// of the current section
+
+	bool m_open;
+	bool m_good;
+
+	struct sectionentry_t {
+	    u_int32_t kind;
+	    u_int32_t offset;
+	    u_int32_t length;
+	};
+	std::vector<sectionentry_t> m_sections;
+
+	// the string table, pointing into m_data
+	std::vector<std::pair<const char *, u_int32_t> > m_strings;
+	// the strings already made unique
+	std::map<u_int32_t, Ustring> m_ustrings;
+
+	void init ();
+	bool readIndex ();
+
+	bytecodeistream (const bytecodeistream &);
+	bytecodeistream & operator= (const bytecodeistream &);
+
     public:
 	bytecodeistream (string filename);
+	~bytecodeistream ();
+
 	bool isVersion (int major, int minor, int revision);
 	bool isVersionAtMost (int major, int minor, int revision);
 	
 	int major () const { return m_major; }
 	int minor () const { return m_minor; }
 	int release () const { return m_release; }
+
+	const string & filename () const { return m_filename; }
+
+	/**
+	 * Keep a stream created by new open for one more user, the last
+	 * unref () deletes it.
+	 */
+	void ref () { m_users++; }
+	void unref () { if (--m_users == 0) delete this; }
+
+	bool is_open () const { return m_open; }
+	bool good () const { return m_good; }
+	operator void * () const { return m_good ? const_cast<bytecodeistream *> (this) : 0; }
+
+	bytecodeistream & get (char & c);
+	bytecodeistream & read (char * buf, size_t len);
+
+	/**
+	 * Skip the next len bytes and return a pointer to them, valid
+	 * as long as the stream. 0 if there are fewer left.
+	 */
+	const char * take (size_t len);
+
+	/**
+	 * Is the file in sections, with a string table?
+	 */
+	bool hasSections () const { return !m_sections.empty (); }
+
+	/**
+	 * The number of the first section of the given kind
+	 * (Bytecode::section_t), 0 if there is none.
+	 */
+	u_int32_t findSection (int kind) const;
+
+	/**
+	 * Entry index of the string table: data and length. False (and
+	 * the stream fails) if there is no such entry.
+	 */
+	bool stringAt (u_int32_t index, const char * & data, u_int32_t & len);
+
+	/**
+	 * Entry index of the string table as unique string, made unique
+	 * only once per file.
+	 */
+	Ustring ustringAt (u_int32_t index);
+
+	/**
+	 * Read a section of the file until the Section is destroyed,
+	 * continue where the stream was then. Reading beyond the end of
+	 * the section fails. Section number 0 stays where the stream is.
+	 */
+	class Section
+	{
+	    bytecodeistream & m_stream;
+	    size_t m_pos;
+	    size_t m_end;
+	    bool m_moved;
+	public:
+	    Section (bytecodeistream & stream, u_int32_t section);
+	    ~Section ();
+	};
+};
+
+/**
+ * A function definition in a section of its own (files of version 1.5
+ * and later), read when it is used for the first time, see
+ * YFunction::definition (). Startup does not pay for the many
+ * functions of a module a client never calls.
+ *
+ * Remembers the namespaces the definition refers to as they were on
+ * the stack of Bytecode when the definition was found, including the
+ * references (xrefs) to imported modules.
+ */
+class LazyDefinition
+{
+public:
+    /// a copy of the xrefs of an import, shared by the definitions after it
+    struct XRefs {
+	std::vector<TableEntry *> refs;
+	int users;
+    };
+
+private:
+    struct scope_t {
+	const Y2Namespace *name_space;
+	XRefs *xrefs;		// 0 unless imported
+    };
+
+    bytecodeistream *m_stream;
+    u_int32_t m_section;
+    std::vector<scope_t> m_scopes;
+
+    static unsigned int m_available;
+    static unsigned int m_loaded;
+
+    LazyDefinition (const LazyDefinition &);
+    LazyDefinition & operator= (const LazyDefinition &);
+
+public:
+    /**
+     * The definition in section of str, with the current namespaces.
+     */
+    LazyDefinition (bytecodeistream & str, u_int32_t section);
+    ~LazyDefinition ();
+
+    /**
+     * Read the definition, 0 on errors. Only once.
+     */
+    YCodePtr read ();
+
+    static void release (XRefs *xrefs);
+
+    /**
+     * The number of definitions found in files in sections so far,
+     * and how many of them were read.
+     */
+    static unsigned int available () { return m_available; }
+    static unsigned int loaded () { return m_loaded; }
 };
 
 /// *.ybc I/O
 class Bytecode {
+    friend class LazyDefinition;
+
     static int m_namespace_nesting_level;
     static int m_namespace_nesting_array_size;
     static int m_namespace_tare_level;
@@ -62,10 +236,18 @@ class Bytecode {
     struct namespaceentry_t {
 	const Y2Namespace *name_space;
 	bool with_xrefs;	///< external references... ???
+	LazyDefinition::XRefs *xrefs;	///< their copy for LazyDefinitions, 0 if none yet
     };
     static namespaceentry_t *m_namespace_nesting_array;
     static map<string, YBlockPtr>* m_bytecodeCache;
 
+    /// the file being written, see writeFile
+    struct filewriter_t;
+    static filewriter_t *m_writer;
+
+    /// read the file of stream, unref it afterwards
+    static YCodePtr readStream (bytecodeistream *stream);
+
     public:
     /** Thrown when it does not make sense to parse more bytecode.
      * Formerly we used to unset YCode::valid instead.
@@ -75,6 +257,22 @@ class Bytecode {
      */
     class Invalid {};
 
+    /**
+     * The kinds of sections of a file of version 1.5 and later. The
+     * outermost block of a file has its symbols and (for a module)
+     * its global declarations in separate sections, each function
+     * definition is a section of its own. The modules a file imports
+     * are listed separately too, for ModulePrefetch.
+     */
+    enum section_t {
+	sStrings = 1,		///< string table
+	sSymbols,		///< symbol entries
+	sGlobals,		///< table entries (global declarations)
+	sBody,			///< function definition
+	sCode,			///< the code, starting at the outermost block
+	sImports		///< names of the modules imported
+    };
+
 	// bool I/O
 	static std::ostream & writeBool (std::ostream & streamref, bool value);
 	static bool readBool (bytecodeistream & streamref);
@@ -111,6 +309,13 @@ class Bytecode {
 	static std::ostream & writeYCodelist (std::ostream & str, const ycodelist_t *codelist);
 	static bool readYCodelist (bytecodeistream & str, ycodelist_t **anchor);
 
+	// sections, while writing a file
+	static bool writingSections () { return m_writer != 0; }
+	// add a section with the given data to the file, write its number to str
+	static std::ostream & writeSection (std::ostream & str, section_t kind, const std::string & data);
+	// note an import of the file being written (sImports)
+	static void writeImport (const std::string & name);
+
 	//-----------------------------------------------------------
 	// block nesting handling
 	//
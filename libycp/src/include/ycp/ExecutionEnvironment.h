@@ -29,11 +29,11 @@ using namespace std;
 /// Function and source location, for backtraces
 struct CallFrame {
     YECallPtr function;
-    string filename;
+    const string *filename;	// interned, see ExecutionEnvironment::intern
     int linenumber;
     YCPValue* params;
 
-    CallFrame (string f, int l, YECallPtr func, YCPValue* p):
+    CallFrame (const string *f, int l, YECallPtr func, YCPValue* p):
         function (func),
         filename (f),
         linenumber (l)
@@ -49,6 +49,10 @@ struct CallFrame {
  * m_forced_filename is a way to enforce a given filename until another
  * block is entered (or the current one is left). Used for include statements,
  * where top level block does not exist.
+ *
+ * The interpreter uses the process wide instance 'ee'. While an
+ * interpreter context is active in a thread (see YCPInterpreterContext),
+ * the methods of 'ee' act on the environment of that context instead.
  */
 class ExecutionEnvironment {
 
@@ -57,10 +61,15 @@ public:
     
 private:
     int m_linenumber;
-    string m_filename;
+    const string *m_filename;	// interned
     bool m_forced_filename;
     YStatementPtr m_statement;
+    /**
+     * Call frames are allocated once and reused, only the first
+     * m_depth entries are active.
+     */
     CallStack m_backtrace;
+    size_t m_depth;
     /**
      * There is a limit of 1001 call frames (overridable by
      * Y2RECURSIONLIMIT in the environment). After that, a call is
@@ -69,8 +78,21 @@ private:
     size_t m_recursion_limit;
 
 public:
+    /**
+     * The environment of the interpreter context active in the
+     * current thread, 0 if none is.
+     */
+    static __thread ExecutionEnvironment *_current;
+
     ExecutionEnvironment ();
-    ~ExecutionEnvironment() {};
+    ~ExecutionEnvironment();
+
+    /**
+     * Return a unique, never freed copy of the file name. Equal names
+     * map to the same pointer, so it can be stored and compared
+     * without copying the string.
+     */
+    static const string * intern (const string & filename);
 
     /**
      * Get the current line number.
@@ -87,11 +109,25 @@ public:
      */
     const string filename () const;
 
+    /**
+     * Get the current file name as interned pointer, suitable
+     * for a later setFilename (const string *). Unlike filename ()
+     * this does not copy the name, use it on the hot paths.
+     */
+    const string * internedFilename () const;
+
     /**
      * Set the current file name for error outputs.
      */
     void setFilename (const string & filename);
 
+    /**
+     * Set the current file name for error outputs.
+     *
+     * @param filename	interned file name, see intern ()
+     */
+    void setFilename (const string * filename);
+
     /**
      * Return the currently evaluated statement.
      */
@@ -0,0 +1,72 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	ModulePrefetch.h
+
+   Opening the bytecode of imported modules ahead, in the background
+
+/-*/
+// -*- c++ -*-
+
+#ifndef ModulePrefetch_h
+#define ModulePrefetch_h
+
+#include <string>
+
+using std::string;
+
+class bytecodeistream;
+
+/**
+ * When a bytecode file is read, the modules it imports (listed in its
+ * Bytecode::sImports section) and the modules these import are
+ * searched, mapped and read ahead by a thread in the background, in
+ * the order the reading will need them. Bytecode::readModule takes
+ * the stream of a module from there, waiting if it is being opened
+ * right now, instead of opening the file itself.
+ *
+ * The code of a module is still read where it is imported, reading
+ * resolves symbols and imports, which changes the shared symbol
+ * tables, and imports run module constructors.
+ *
+ * There is no prefetching if $Y2PREFETCH is 0.
+ */
+class ModulePrefetch
+{
+public:
+    /**
+     * Start prefetching the modules imported by the file of stream,
+     * which is about to be read. Each call is followed by one of
+     * read ().
+     */
+    static void imports (bytecodeistream & stream);
+
+    /**
+     * The file of the last imports () call is read, including the
+     * modules it imports. After the outermost file, the prefetched
+     * streams not taken are closed, nothing will read them.
+     */
+    static void read ();
+
+    /**
+     * The prefetched stream of module name in file filename, 0 if
+     * there is none. The module is not prefetched any more afterwards.
+     */
+    static bytecodeistream *take (const string & name, const string & filename);
+
+    /**
+     * The number of prefetched modules read so far.
+     */
+    static unsigned int used ();
+};
+
+#endif // ModulePrefetch_h
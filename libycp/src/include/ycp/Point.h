@@ -26,6 +26,7 @@ using std::string;
 // MemUsage.h defines/undefines D_MEMUSAGE
 #include <y2util/MemUsage.h>
 #include "y2/SymbolEntry.h"
+#include "ycp/YCodeArena.h"
 
 class bytecodeistream;
 
@@ -66,6 +67,7 @@ class Point
     int m_line;				// line of definition / inclusion
     const Point *m_point;		// points to toplevel point for include files
   public:
+    YCODE_ARENA_ALLOCATED
     size_t mem_size () const { return sizeof (Point); }
     Point (std::string filename, int line = 0, const Point *point = 0);
     Point (SymbolEntryPtr sentry, int line = 0, const Point *point = 0);
@@ -0,0 +1,119 @@
+/*
+ * YaST2: Core system
+ *
+ * Description:
+ *   Profiler for YCP code. Records a call tree of YCP functions and
+ *   builtins (including SCR:: calls) and writes it at exit as folded
+ *   stacks (input for flamegraph.pl) and as a per function table.
+ *
+ *   Enabled by the environment variable Y2PROFILE:
+ *     Y2PROFILE=trace   exact call counts, inclusive and exclusive
+ *                       times (in microseconds)
+ *     Y2PROFILE=sample  statistical, a SIGPROF timer samples the call
+ *                       stack every Y2PROFILEINTERVAL microseconds of
+ *                       cpu time (default 10000)
+ *   Output goes to <prefix>.folded and <prefix>.txt, the prefix is
+ *   taken from Y2PROFILEFILE (default /tmp/ycp-profile.<pid>)
+ *
+ */
+
+#ifndef _Profiler_h
+#define _Profiler_h
+
+#include <signal.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+
+using std::string;
+
+struct declaration;
+class SymbolEntry;
+
+class Profiler
+{
+public:
+    enum mode_t { p_trace, p_sample };
+
+private:
+    // one node of the call tree, i.e. a function reached by a
+    // specific call path
+    struct Node
+    {
+	const void *id;			// SymbolEntry or declaration_t
+	Node *parent;
+	std::map<const void *, Node *> children;
+	// fast path, the child entered first in this node and the
+	// sibling entered after this one the last time
+	Node *first;
+	Node *next;
+	unsigned long calls;
+	unsigned long long self;	// exclusive microseconds (p_trace) or samples (p_sample)
+
+	Node (const void *i, Node *p)
+	    : id (i), parent (p), first (0), next (0), calls (0), self (0) {}
+	~Node ();
+    };
+
+    mode_t m_mode;
+    string m_prefix;
+    Node *m_root;
+    Node *m_current;
+    Node *m_left;			// child of m_current left last, 0 after enter
+    unsigned long long m_last;		// time of the last enter/leave, p_trace only
+
+    // printable names of all ids seen so far
+    std::map<const void *, string> m_names;
+    const string & nameOf (const void *id) const;
+
+    // set by the SIGPROF handler, consumed at the next enter/leave
+    static volatile sig_atomic_t _pending;
+    static void sampleHandler (int);
+
+    Profiler (mode_t mode, const string & prefix);
+
+    void enter (const void *id);
+    // charge the time (or samples) since the last call to m_current
+    void charge ();
+    Node *child (const void *id);
+
+    void writeFolded (FILE *out, Node *node, const string & path) const;
+    // sum up the subtree at node per function name, recursive calls
+    // are counted once in the inclusive value
+    struct Summary
+    {
+	unsigned long calls;
+	unsigned long long self;
+	unsigned long long inclusive;
+	int active;
+	Summary () : calls (0), self (0), inclusive (0), active (0) {}
+    };
+    unsigned long long summarize (Node *node, std::map<string, Summary> & summary) const;
+
+public:
+    ~Profiler ();
+
+    /**
+     * Check Y2PROFILE and start profiling, sets profiler_instance.
+     * Called once from the ExecutionEnvironment constructor.
+     */
+    static void initialize ();
+
+    // a YCP function is called (see ExecutionEnvironment::pushframe)
+    void enterFunction (const SymbolEntry & entry);
+    // a builtin is called (see YEBuiltin::evaluate)
+    void enterBuiltin (const declaration *decl);
+    // the function or builtin entered last returns
+    void leave ();
+
+    /**
+     * Write <prefix>.folded and <prefix>.txt
+     */
+    void report ();
+};
+
+// the active profiler, 0 if profiling is off
+extern Profiler *profiler_instance;
+
+#endif /* _Profiler_h */
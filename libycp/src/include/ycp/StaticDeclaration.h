@@ -57,7 +57,10 @@ enum DeclFlags
     DECL_NOEVAL =	0x00000200,	// function will evaluate its parameters on its own (boolean functions for shortcut eval)
     DECL_CALL_HANDLER =	0x00000400,	// ptr is a call handler (only together with DECL_NAMESPACE)
     DECL_DEPRECATED =	0x00000800,	// deprecated function
-    DECL_FORMATTED =	0x00001000	// has format string with "%1" as first arg
+    DECL_FORMATTED =	0x00001000,	// has format string with "%1" as first arg
+    DECL_APPEND =	0x00002000,	// returns the list parameter with the second parameter appended
+    DECL_PREPEND =	0x00004000,	// returns the list parameter with the second parameter prepended
+    DECL_PURE =		0x00008000	// no side effects, may be evaluated by several threads at once
 };
 
 // declaration::ptr is a function pointer of this type if the first entry of a StaticDeclaration
@@ -191,6 +191,12 @@ public:
     // start tracking references, keep a list of actually referenced (-> find()) entries
     void openXRefs ();
 
+    // push a copy of refs on top of m_references (to resolve references again later)
+    void openXRefs (const std::vector<TableEntry *> & refs);
+
+    // the list of references on top of m_references, 0 if none
+    const std::vector<TableEntry *> *currentXRefs () const;
+
     // pop current list of references from top of m_references
     void closeXRefs ();
 
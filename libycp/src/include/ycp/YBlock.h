@@ -24,6 +24,7 @@
 
 #include <string>
 #include <list>
+#include <vector>
 using std::string;
 #include <y2util/Ustring.h>
 
@@ -41,6 +42,7 @@ using std::string;
 
 
 class YSImport;
+class YProgram;
 
 /**
  * block (-> list of statements, list of symbols)
@@ -49,6 +51,7 @@ class YSImport;
 class YBlock : public YCode, public Y2Namespace
 {
     REP_BODY (YBlock);
+    friend class YProgram;		// lowers it, see YProgram.h
 
 public:
     // block kinds
@@ -105,12 +108,17 @@ private:
     // a chain <include file> -> <toplevel file>. See Point.h
     const Point *m_point;
 
+    // interned filename of m_point, set up on first evaluation
+    //   (see ExecutionEnvironment::intern), reset when m_point changes
+    const std::string *m_filename;
+
     // --------------------------------
     // Block content
 
     struct stmtlist {
 	YStatementPtr stmt;
 	struct stmtlist *next;
+	YCODE_ARENA_ALLOCATED
     };
     typedef struct stmtlist stmtlist_t;
 
@@ -120,6 +128,20 @@ private:
     // pointer to last statement for easier append
     stmtlist_t *m_last_statement;
 
+    // the statements as a flat array, this is what evaluate() walks
+    //   built from m_statements on first evaluation, see linkStatements()
+    typedef std::vector<YStatementPtr> stmtvector_t;
+    stmtvector_t m_statementvector;
+    bool m_linked;
+
+    // (re)build m_statementvector from m_statements
+    void linkStatements ();
+
+    // the statements lowered to register code, built on first
+    //   evaluation and dropped by linkStatements(), see YProgram.h
+    YProgram *m_program;
+    void buildProgram ();
+
     /**
      * List of all included files so far.
      */
@@ -128,8 +150,6 @@ private:
     
     constTypePtr m_type;
     
-    bool m_running;
-    
 public:
     //---------------------------------------------------------------
     // Constructor / Destructor
@@ -163,6 +183,14 @@ public:
     // evaluate the block from the given statement (switch)
     YCPValue evaluateFrom (int statement_index);
 
+    // compile time optimization of all statements, see YCode::optimize
+    //   statements without effect are dropped
+    virtual YCodePtr optimize (int & removed);
+
+    // optimize the statements, but keep all of them in place
+    //   (the statement index is used by switch)
+    void optimizeStatements (int & removed, bool keep_positions);
+
     // evaluate a single statement
     // this is a special purpose interface for macro player
     // does not handle break, return
@@ -51,6 +51,8 @@ protected:
     YCPBooleanRep(const char *r);
 
 public:
+    YCP_POOL_ALLOCATED (YT_BOOLEAN)
+
     /**
      * Returns the value of this YCPBooleanRep in form
      * of a bool value.
@@ -99,7 +101,7 @@ class YCPBoolean : public YCPValue
     
 public:
     YCPBoolean(bool v);
-    YCPBoolean(const char *r) : YCPValue(new YCPBooleanRep(r)) {}
+    YCPBoolean(const char *r);
     YCPBoolean(bytecodeistream & str);
 };
 
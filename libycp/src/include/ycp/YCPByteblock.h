@@ -63,6 +63,8 @@ protected:
     ~YCPByteblockRep();
 
 public:
+    YCP_POOL_ALLOCATED (YT_BYTEBLOCK)
+
     /**
      * Returns the bytes of the block.
      */
@@ -56,6 +56,8 @@ protected:
     ~YCPCodeRep();
 
 public:
+    YCP_POOL_ALLOCATED (YT_CODE)
+
     YCodePtr code() const;
 
     /**
@@ -131,6 +133,8 @@ protected:
     ~YCPBreakRep() {}
 
 public:
+    YCP_POOL_ALLOCATED (YT_BREAK)
+
     /**
      * Compares two YBreaks for equality, greaterness or smallerness.
      * 
@@ -200,6 +204,8 @@ protected:
     ~YCPReturnRep() {}
 
 public:
+    YCP_POOL_ALLOCATED (YT_RETURN)
+
     /**
      * Compares two YReturns for equality, greaterness or smallerness.
      * 
@@ -265,6 +271,8 @@ protected:
     ~YCPEntryRep() {}
 
 public:
+    YCP_POOL_ALLOCATED (YT_ENTRY)
+
     SymbolEntryPtr entry() const;
 
     /**
@@ -337,6 +345,8 @@ protected:
     ~YCPReferenceRep() {}
 
 public:
+    YCP_POOL_ALLOCATED (YT_REFERENCE)
+
     SymbolEntryPtr entry() const;
 
     /**
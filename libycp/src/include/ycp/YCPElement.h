@@ -23,6 +23,7 @@
 
 // MemUsage.h defines/undefines D_MEMUSAGE
 #include <y2util/MemUsage.h>
+#include "ycp/YCPPool.h"
 
 // include only forward declarations of iostream
 #include <iosfwd>
@@ -244,6 +245,12 @@ class YCPElementRep
      */
     mutable int reference_counter;
 
+    /**
+     * Number of YCPElementReps created so far, counted atomically
+     * while _atomic is set
+     */
+    static unsigned long long _allocated;
+
 protected:
 
     friend class YCPElement;
@@ -261,6 +268,38 @@ protected:
     virtual ~YCPElementRep();
 
 public:
+    // subclasses count as their value type, see YCPPool
+    YCP_POOL_ALLOCATED (YCPPool::other)
+
+    /**
+     * Returns the number of YCPElementReps created so far,
+     * used by benchmarks to count allocations.
+     */
+    static unsigned long long allocated () { return _allocated; }
+
+    /**
+     * Nonzero while values are shared by several threads (see
+     * YCPParallel and YCPInterpreterContext), the reference counters
+     * are then changed atomically. Change it like Rep::_atomic.
+     */
+    static int _atomic;
+
+    /**
+     * Reference counting of the trees shared between the copies of
+     * large lists and maps, atomic while _atomic is set.
+     */
+    static void refShared (int & refs)
+    {
+	if (_atomic)
+	    __sync_add_and_fetch (&refs, 1);
+	else
+	    refs++;
+    }
+    static int unrefShared (int & refs)
+    {
+	return _atomic ? __sync_sub_and_fetch (&refs, 1) : --refs;
+    }
+
     /**
      * Casts this element into a pointer of type YCPValueRep
      */
@@ -54,6 +54,8 @@ protected:
     ~YCPExternalRep();
 
 public:
+    YCP_POOL_ALLOCATED (YT_EXTERNAL)
+
     /**
      */
     void * payload() const;
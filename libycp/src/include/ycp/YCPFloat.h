@@ -55,6 +55,8 @@ protected:
     YCPFloatRep(const char *r);
 
 public:
+    YCP_POOL_ALLOCATED (YT_FLOAT)
+
     /**
      * Returns the value of this object in form of a
      * C value of type double.
@@ -49,6 +49,8 @@ protected:
     YCPIntegerRep(const char *r, bool *valid);
 
 public:
+    YCP_POOL_ALLOCATED (YT_INTEGER)
+
     /**
      * Returns the value of this object in form of a long long
      * C value.
@@ -92,8 +94,14 @@ public:
 class YCPInteger : public YCPValue
 {
     DEF_COMMON(Integer, Value);
+
+    // values in this range share one instance each, see cached()
+    enum { cache_min = -128, cache_max = 1023 };
+    static YCPInteger* smallints[cache_max - cache_min + 1];
+    static const YCPIntegerRep* cached(long long v);
 public:
-    YCPInteger(long long v) : YCPValue(new YCPIntegerRep(v)) {}
+    YCPInteger(long long v)
+	: YCPValue((v >= cache_min && v <= cache_max) ? cached(v) : new YCPIntegerRep(v)) {}
     YCPInteger(const char *r, bool *valid = NULL) : YCPValue(new YCPIntegerRep(r, valid)) {}
     YCPInteger(bytecodeistream & str);
 };
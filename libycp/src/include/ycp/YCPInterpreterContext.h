@@ -0,0 +1,96 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCPInterpreterContext.h
+
+   State of one evaluation of YCP code, for running code concurrently
+
+/-*/
+// -*- c++ -*-
+
+#ifndef YCPInterpreterContext_h
+#define YCPInterpreterContext_h
+
+#include "ycp/YCode.h"
+#include "ycp/ExecutionEnvironment.h"
+#include "y2/SymbolEntry.h"
+
+/**
+ * The mutable state of the interpreter for one independent evaluation,
+ * e.g. one request served by a long running agent: the values of all
+ * variables (including the state of imported modules, whose
+ * constructors run once per context) and the execution environment
+ * (file, line, call stack) which 'ee' stands for.
+ *
+ * Several contexts can evaluate code on different threads at the same
+ * time, also the same code: the code trees, the symbol tables and the
+ * loaded modules are shared and not changed by evaluation. Loading
+ * code (parsing, reading bytecode, importing) is serialized, see
+ * Y2Namespace::LoadLock.
+ *
+ * A context is active in at most one thread at a time. While any
+ * context exists, reference counting is atomic (see Rep::_atomic and
+ * YCPElementRep::_atomic). The debugger and the profiler do not follow
+ * the evaluation in contexts.
+ *
+ * <PRE>
+ *   YCPInterpreterContext context;
+ *   YCPValue result = context.evaluate (code);
+ * </PRE>
+ */
+class YCPInterpreterContext
+{
+    ExecutionEnvironment m_environment;
+    SymbolEntry::ValueStore m_values;
+
+    // the context active in the current thread
+    static __thread YCPInterpreterContext *_current;
+
+    static void activate (YCPInterpreterContext *context);
+
+    YCPInterpreterContext (const YCPInterpreterContext &);
+    YCPInterpreterContext & operator= (const YCPInterpreterContext &);
+
+public:
+    YCPInterpreterContext ();
+    ~YCPInterpreterContext ();
+
+    /**
+     * Evaluate code with this context active in the calling thread.
+     */
+    YCPValue evaluate (const YCodePtr & code);
+
+    /**
+     * The execution environment of this context.
+     */
+    ExecutionEnvironment & environment () { return m_environment; }
+
+    /**
+     * The context active in the calling thread, 0 if there is none.
+     */
+    static YCPInterpreterContext *current () { return _current; }
+
+    /**
+     * Activate a context in the calling thread until the scope is
+     * left, the previous one (or none) is active again afterwards.
+     * A scope for context 0 runs code outside of any context.
+     */
+    class Scope
+    {
+	YCPInterpreterContext *m_previous;
+    public:
+	Scope (YCPInterpreterContext *context);
+	~Scope ();
+    };
+};
+
+#endif // YCPInterpreterContext_h
@@ -23,10 +23,74 @@
 #define YCPList_h
 
 
+#include <iterator>
 #include "YCPValue.h"
 
 
 class YCPCodeCompare;
+class YCPListRep;
+struct YCPListNode;
+struct YCPListIndex;
+
+
+/**
+ * Random access iterator over the values of a YCPList.
+ *
+ * Small lists keep their values in one vector, large ones in a tree
+ * of blocks (see YCPListRep). The iterator remembers the block of
+ * the current position, so stepping through a list only looks up
+ * the tree when it enters the next block.
+ */
+class YCPListIterator
+{
+    const YCPListRep *m_list;
+    int m_index;
+
+    // the block of consecutive values containing m_index
+    mutable const YCPValue *m_block;
+    mutable int m_blockstart;
+    mutable int m_blockend;
+
+    const YCPValue & locate () const;
+
+public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef YCPValue value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const YCPValue * pointer;
+    typedef const YCPValue & reference;
+
+    YCPListIterator ()
+	: m_list (0), m_index (0), m_block (0), m_blockstart (0), m_blockend (0) {}
+    YCPListIterator (const YCPListRep *list, int index, const YCPValue *block = 0, int blockstart = 0, int blockend = 0)
+	: m_list (list), m_index (index), m_block (block), m_blockstart (blockstart), m_blockend (blockend) {}
+
+    reference operator* () const
+    {
+	if (m_index >= m_blockstart && m_index < m_blockend)
+	    return m_block[m_index - m_blockstart];
+	return locate ();
+    }
+    pointer operator-> () const { return &**this; }
+    reference operator[] (difference_type n) const { return *(*this + n); }
+
+    YCPListIterator & operator++ () { ++m_index; return *this; }
+    YCPListIterator operator++ (int) { YCPListIterator it = *this; ++m_index; return it; }
+    YCPListIterator & operator-- () { --m_index; return *this; }
+    YCPListIterator operator-- (int) { YCPListIterator it = *this; --m_index; return it; }
+    YCPListIterator & operator+= (difference_type n) { m_index += n; return *this; }
+    YCPListIterator & operator-= (difference_type n) { m_index -= n; return *this; }
+    YCPListIterator operator+ (difference_type n) const { YCPListIterator it = *this; return it += n; }
+    YCPListIterator operator- (difference_type n) const { YCPListIterator it = *this; return it -= n; }
+    difference_type operator- (const YCPListIterator &it) const { return m_index - it.m_index; }
+
+    bool operator== (const YCPListIterator &it) const { return m_index == it.m_index; }
+    bool operator!= (const YCPListIterator &it) const { return m_index != it.m_index; }
+    bool operator< (const YCPListIterator &it) const { return m_index < it.m_index; }
+    bool operator> (const YCPListIterator &it) const { return m_index > it.m_index; }
+    bool operator<= (const YCPListIterator &it) const { return m_index <= it.m_index; }
+    bool operator>= (const YCPListIterator &it) const { return m_index >= it.m_index; }
+};
 
 
 /**
@@ -40,6 +104,12 @@ class YCPCodeCompare;
  * the types of a list's elements. If you want to declare a variable
  * or parameter to be a list of a certain signature, you can use
  * the RangeRestrictor YCP_RRList or YCP_RRTyple. object.
+ *
+ * Small lists are a vector of values. Lists with more than a few
+ * hundred elements are kept as a persistent tree of value blocks
+ * instead: copies share the tree and changing a copy only copies
+ * the blocks on the path to the change, so the functional updates
+ * of YCP (add, remove, ...) are O(log n) on large lists.
  */
 class YCPListRep : public YCPValueRep
 {
@@ -47,16 +117,37 @@ private:
 
     typedef vector<YCPValue> YCPValueList;
 
+    // the values of small lists
     YCPValueList elements;
 
+    // number of unused slots at the front of elements, kept
+    // by prepend () so it does not have to move the whole list
+    int m_front;
+
+    // the tree of large lists, 0 if elements is used
+    YCPListNode *m_tree;
+
+    // hash set of the values, built by repeated contains () on an
+    // unchanged list, and the number of those calls
+    mutable YCPListIndex *m_index;
+    mutable int m_lookups;
+
+    void toTree ();
+    void fromTree ();
+
+    // the values change, forget the index
+    void changed () { if (m_lookups) dropIndex (); }
+    void dropIndex ();
+
 protected:
 
-    typedef YCPValueList::iterator iterator;
-    typedef YCPValueList::const_iterator const_iterator;
+    typedef YCPListIterator iterator;
+    typedef YCPListIterator const_iterator;
     typedef YCPValueList::value_type value_type;
     typedef YCPValueList::const_reference const_reference;
 
     friend class YCPList;
+    friend class YCPListIterator;
 
     /**
      * Creates a new and empty list of type [ value ]
@@ -66,9 +157,17 @@ protected:
     /**
      * Cleans up.
      */
-    ~YCPListRep() {}
+    ~YCPListRep();
+
+    /**
+     * The block of consecutive values containing index n
+     * (start and end are the indices of its first and behind
+     * its last value)
+     */
+    const YCPValue *block (int n, int & start, int & end) const;
 
 public:
+    YCP_POOL_ALLOCATED (YT_LIST)
 
     /**
      * Returns the number of elements in the list.
@@ -99,6 +198,19 @@ public:
      */
     void push_back(const YCPValue& value);
 
+    /**
+     * Appends all values at once, reserving the room for them (or
+     * building the tree of a large list) in one go. Takes the values
+     * over, values is empty afterwards.
+     */
+    void addAll(vector<YCPValue>& values);
+
+    /**
+     * Inserts a value in front of the list. Amortized constant time,
+     * like add ().
+     */
+    void prepend(const YCPValue& value);
+
     /**
      * Sets a value in the list. Takes over the memory management
      * of that value. Use @ref YCPElementRep, if you need it
@@ -119,6 +231,8 @@ public:
 
     /**
      * Returns true if the list contains the value, otherwise false.
+     * Linear, but repeated calls on the same unchanged list hash
+     * its values once and are then constant time.
      */
     bool contains (const YCPValue& value) const;
 
@@ -246,6 +360,8 @@ public:
     bool isEmpty() const { return CONST_ELEMENT->isEmpty (); }
     void add(const YCPValue& value) { ELEMENT->add (value);  }
     void push_back(const YCPValue& value) { ELEMENT->push_back(value); }
+    void addAll(vector<YCPValue>& values) { ELEMENT->addAll (values); }
+    void prepend(const YCPValue& value) { ELEMENT->prepend (value); }
     void set(const int n, const YCPValue& value) { ELEMENT->set (n, value); }
     void remove(const int n) { ELEMENT->remove (n); }
     void swap(int x, int y) { ELEMENT->swap (x, y); }
@@ -23,6 +23,7 @@
 #define YCPMap_h
 
 
+#include <iterator>
 #include "YCPValue.h"
 #include "ycpless.h"
 
@@ -31,6 +32,27 @@
 // 2009-01-07. http://lists.opensuse.org/yast-devel/2009-01/msg00016.html
 typedef map<YCPValue, YCPValue, ycp_less> YCPValueYCPValueMap;
 class YCPMapIterator;
+struct YCPMapNode;
+struct YCPMapOrder;
+
+
+/**
+ * Orders the keys of a map exactly like ycp_less. While all keys of
+ * the map are strings or all are integers (see YCPMapRep::m_keytype)
+ * they are compared directly, without the type dispatch of
+ * YCPValueRep::compare ().
+ */
+class YCPMapKeyLess
+{
+    const YCPValueType *m_keytype;
+
+public:
+    YCPMapKeyLess(const YCPValueType *keytype) : m_keytype(keytype) {}
+
+    bool operator()(const YCPValue& k1, const YCPValue& k2) const;
+};
+
+typedef map<YCPValue, YCPValue, YCPMapKeyLess> YCPSmallMap;
  
 
 /**
@@ -41,17 +63,51 @@ class YCPMapIterator;
  * constants.
  * Elements inside a map are kept in a sorted order based on the
  * key value.
+ *
+ * Small maps are a std::map. Maps with more than a few hundred
+ * entries are kept as a persistent hash trie instead: copies share
+ * the trie and changing a copy only copies the nodes on the path to
+ * the change, so the functional updates of YCP (add, remove, ...)
+ * are O(log n) on large maps. Iterating such a map goes through the
+ * entries sorted once by key, the order is kept until the set of
+ * keys changes.
  */
 class YCPMapRep : public YCPValueRep
 {
 private:
 
-    YCPValueYCPValueMap stl_map;
+    // the type of all keys (YT_STRING, YT_INTEGER or YT_SYMBOL),
+    // YT_VOID for an empty map and YT_ERROR for mixed key types
+    YCPValueType m_keytype;
+
+    // the entries of small maps
+    YCPSmallMap stl_map;
+
+    // the trie of large maps, 0 if stl_map is used
+    YCPMapNode *m_trie;
+
+    // number of entries in m_trie
+    long m_size;
+
+    // the entries of m_trie sorted by key, built on demand
+    mutable YCPMapOrder *m_order;
+
+    void toTrie ();
+    void fromTrie ();
+
+    // false if no key of the map has the type of key
+    bool mayHaveKey (const YCPValue& key) const
+    {
+	return m_keytype == YT_ERROR || key->valuetype() == m_keytype;
+    }
+
+    const YCPMapOrder *order () const;
+    void dropOrder ();
 
 protected:
 
-    typedef YCPValueYCPValueMap::iterator iterator;
-    typedef YCPValueYCPValueMap::const_iterator const_iterator;
+    typedef YCPMapIterator iterator;
+    typedef YCPMapIterator const_iterator;
     typedef YCPValueYCPValueMap::value_type value_type;
     typedef YCPValueYCPValueMap::const_reference const_reference;
     typedef YCPValueYCPValueMap::key_compare key_compare;
@@ -66,9 +122,10 @@ protected:
     /**
      * Cleans up
      */
-    ~YCPMapRep() {}
+    ~YCPMapRep();
 
 public:
+    YCP_POOL_ALLOCATED (YT_MAP)
 
     /**
      * Adds a new key/value pair. If the key is
@@ -116,6 +173,12 @@ public:
      */
     YCPValue value(const YCPValue& key) const;
 
+    /**
+     * Sum of YCPValueRep::hashEntry () over all entries, visited in
+     * storage order. For YCPValueRep::hash ().
+     */
+    unsigned long long entriesHash() const;
+
     /**
      * Returns a bidirectional iterator for the YCPMap that
      * is positioned at the first value pair in the map.
@@ -160,13 +223,48 @@ public:
 };
 
 
-// Only for backwards compatibility. See mail from aschnell on yast-devel on
-// 2009-01-07. http://lists.opensuse.org/yast-devel/2009-01/msg00016.html
-struct YCPMapIterator : public YCPValueYCPValueMap::const_iterator
+// Bidirectional iterator over the key/value pairs of a YCPMap in key
+// order, either a std::map iterator (small maps) or a position in the
+// sorted entries of a trie (large maps).
+//
+// Note: YCPMapIterator used to be derived from
+// YCPValueYCPValueMap::const_iterator. It is a class of its own now,
+// it can't be passed where a std::map iterator is expected and code
+// using it must be rebuilt (see -version-info of libycpvalues).
+class YCPMapIterator
 {
-    YCPMapIterator(YCPValueYCPValueMap::const_iterator it)
-        : YCPValueYCPValueMap::const_iterator(it) {}
+    YCPSmallMap::const_iterator m_it;
 
+    // position in the sorted entries, 0 for a std::map
+    const YCPValueYCPValueMap::value_type * const *m_pos;
+
+public:
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef YCPValueYCPValueMap::value_type value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const value_type * pointer;
+    typedef const value_type & reference;
+
+    YCPMapIterator()
+	: m_pos(0) {}
+    YCPMapIterator(YCPSmallMap::const_iterator it)
+	: m_it(it), m_pos(0) {}
+    YCPMapIterator(const value_type * const *pos)
+	: m_pos(pos) {}
+
+    reference operator*() const { return m_pos ? **m_pos : *m_it; }
+    pointer operator->() const { return &**this; }
+
+    YCPMapIterator & operator++() { if (m_pos) ++m_pos; else ++m_it; return *this; }
+    YCPMapIterator operator++(int) { YCPMapIterator it = *this; ++*this; return it; }
+    YCPMapIterator & operator--() { if (m_pos) --m_pos; else --m_it; return *this; }
+    YCPMapIterator operator--(int) { YCPMapIterator it = *this; --*this; return it; }
+
+    bool operator==(const YCPMapIterator &it) const { return m_pos ? m_pos == it.m_pos : m_it == it.m_it; }
+    bool operator!=(const YCPMapIterator &it) const { return !(*this == it); }
+
+    // Only for backwards compatibility. See mail from aschnell on yast-devel on
+    // 2009-01-07. http://lists.opensuse.org/yast-devel/2009-01/msg00016.html
     YCPValue key() const __attribute__ ((deprecated)) { return (*this)->first; }
     YCPValue value() const __attribute__ ((deprecated)) { return (*this)->second; }
 };
@@ -203,6 +301,7 @@ public:
     long size() const { return CONST_ELEMENT-> size (); }
     bool hasKey(const YCPValue& key) const { return CONST_ELEMENT->hasKey(key); }
     YCPValue value(const YCPValue& key) const { return CONST_ELEMENT-> value (key); }
+    unsigned long long entriesHash() const { return CONST_ELEMENT->entriesHash(); }
     YCPMapIterator begin() const { return CONST_ELEMENT-> begin (); }
     YCPMapIterator end() const { return CONST_ELEMENT-> end (); }
 };
@@ -0,0 +1,79 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCPParallel.h
+
+   Parallel evaluation of the blocks of list and map builtins
+
+/-*/
+// -*- c++ -*-
+
+#ifndef YCPParallel_h
+#define YCPParallel_h
+
+#include <vector>
+
+#include "ycp/YCPCode.h"
+#include "ycp/YCPList.h"
+#include "ycp/YCPMap.h"
+
+/**
+ * Evaluates the block of maplist, filter, listmap and mapmap for
+ * several elements at once.
+ *
+ * Only blocks which are a pure expression (see YCode::isPure), like
+ * { return v > 2; } or { return $[k : size (v)]; }, on a list or map
+ * of at least a few hundred elements are evaluated in parallel. The
+ * loop variables are bound per thread (see SymbolEntry::_bindings)
+ * and the reference counters of values and code are changed
+ * atomically meanwhile (see YCPElementRep::_atomic and Rep::_atomic).
+ *
+ * The worker threads are started on first use and kept, the calling
+ * thread works along. Y2PARALLEL in the environment sets the number
+ * of threads, Y2PARALLEL=1 disables parallel evaluation. The default
+ * is the number of online processors. Parallel evaluation is not
+ * used while the debugger or the profiler is active.
+ *
+ * The builtins keep their serial loop over the results, so the
+ * result, break and error handling stay the same. Only errors
+ * reported by the evaluation itself may be logged out of order.
+ */
+class YCPParallel
+{
+public:
+    /**
+     * Evaluate code for every value of list, with entry bound to the
+     * value. results[i] is the result for the i-th value.
+     *
+     * Returns false without evaluating anything if code or list do not
+     * qualify, the caller then evaluates serially.
+     */
+    static bool evaluate (const YCPCode & code, const YCPList & list,
+			  const SymbolEntryPtr & entry, std::vector<YCPValue> & results);
+
+    /**
+     * Evaluate code for every entry of map, with key and value bound
+     * to keyentry and valueentry. results are in the iteration order
+     * of map.
+     */
+    static bool evaluate (const YCPCode & code, const YCPMap & map,
+			  const SymbolEntryPtr & keyentry, const SymbolEntryPtr & valueentry,
+			  std::vector<YCPValue> & results);
+
+    /**
+     * Number of threads used, including the calling one. 1 if
+     * parallel evaluation is disabled.
+     */
+    static int threads ();
+};
+
+#endif // YCPParallel_h
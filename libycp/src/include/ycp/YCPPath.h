@@ -75,6 +75,7 @@ protected:
      */
     void append(const Component&c);
 public:
+    YCP_POOL_ALLOCATED (YT_PATH)
 
     /**
      * Returns true, if this is a root path.
@@ -0,0 +1,77 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCPPool.h
+
+   Allocator for YCPElementRep and its subclasses
+
+/-*/
+// -*- c++ -*-
+
+#ifndef YCPPool_h
+#define YCPPool_h
+
+#include <stddef.h>
+
+/**
+ * Allocator for the representations of YCP values.
+ *
+ * Objects up to 256 bytes come from per size class (8 byte steps)
+ * free lists, refilled in blocks from the system allocator. The
+ * free lists are thread local, so concurrent evaluation does not need
+ * locking. Larger objects go to the system allocator.
+ *
+ * An object freed by another thread than the one allocating it goes
+ * to the free list of the freeing thread. A free list grown beyond
+ * two blocks passes a block's worth of objects to a shared, locked
+ * list of batches, which refills come from before asking the system,
+ * and an exiting thread passes its free lists there too.
+ *
+ * Configuring with --disable-value-pool (i.e. building without
+ * YCP_VALUE_POOL) uses the system allocator for everything, to
+ * compare both. The counters are kept in either case.
+ *
+ * Live and total objects are counted per value type (the YCPValueType
+ * passed by YCP_POOL_ALLOCATED). dump () writes them to the log, it
+ * is called at exit if Y2POOLSTATS is set in the environment and can
+ * be called from gdb via YCPPoolDump ().
+ */
+class YCPPool
+{
+public:
+    // counter slots, the YCPValueType values and one for the rest
+    enum { types = 32, other = types - 1 };
+
+    static void *allocate (size_t size, int type);
+    static void deallocate (void *ptr, size_t size, int type);
+
+    /**
+     * Number of objects of a value type currently alive
+     */
+    static unsigned long live (int type);
+
+    /**
+     * Write the live and total object counts to the log
+     */
+    static void dump ();
+};
+
+// this makes it easier for gdb.
+void YCPPoolDump ();
+
+// class specific operator new/delete using YCPPool, counting as type
+//   (use in a public section)
+#define YCP_POOL_ALLOCATED(type)						\
+    static void *operator new (size_t size) { return YCPPool::allocate (size, type); }	\
+    static void operator delete (void *ptr, size_t size) { YCPPool::deallocate (ptr, size, type); }
+
+#endif // YCPPool_h
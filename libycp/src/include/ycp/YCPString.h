@@ -42,6 +42,9 @@ class YCPStringRep : public YCPValueRep
     string v;
     bool is_ascii;
 
+    // hash of v, 0 if not computed yet
+    mutable unsigned m_hash;
+
 protected:
 
     friend class YCPString;
@@ -65,6 +68,7 @@ protected:
     YCPStringRep(const wstring& s);
 
 public:
+    YCP_POOL_ALLOCATED (YT_STRING)
 
     /**
      * Returns true iff this string is empty.
@@ -96,6 +100,11 @@ public:
      */
     YCPOrder compare(const YCPString &v, bool rl = false) const;
 
+    /**
+     * Hash of the string, computed once. See @ref YCPValueRep#hash.
+     */
+    unsigned hash() const;
+
     /**
      * Returns the value in form of a C const char * string.
      */
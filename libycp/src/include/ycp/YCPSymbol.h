@@ -55,6 +55,8 @@ protected:
     YCPSymbolRep(string s);
 
 public:
+    YCP_POOL_ALLOCATED (YT_SYMBOL)
+
     /**
      * Returns the symbol's string.
      */
@@ -69,6 +69,8 @@ protected:
     ~YCPTermRep() {}
 
 public:
+    YCP_POOL_ALLOCATED (YT_TERM)
+
     /**
      * Returns the term's name
      */
@@ -262,6 +262,23 @@ public:
      */
     YCPOrder compare(const YCPValue &v, bool rl = false) const;
 
+    /**
+     * Hash of the value, consistent with compare (): values which
+     * compare YO_EQUAL (not locale aware) have the same hash.
+     */
+    unsigned hash() const;
+
+    /**
+     * Hash of len bytes at data, for the hash () of the value types.
+     */
+    static unsigned hashBytes(const void *data, size_t len);
+
+    /**
+     * Hash of a map entry from the hashes of its key and value, for
+     * the hash () of maps.
+     */
+    static unsigned hashEntry(unsigned key, unsigned value);
+
     virtual std::ostream & toXml (std::ostream & str, int indent ) const = 0;
 };
 
@@ -42,6 +42,8 @@ protected:
     YCPVoidRep();
     
 public:
+    YCP_POOL_ALLOCATED (YT_VOID)
+
     /**
      * Gives the ASCII representation of this value, i.e.
      * "nil"
@@ -42,6 +42,7 @@ using std::string;
 // MemUsage.h defines/undefines D_MEMUSAGE
 #include <y2util/MemUsage.h>
 #include "ycp/YCodePtr.h"
+#include "ycp/YCodeArena.h"
 
 #include "ycp/YCPValue.h"
 #include "ycp/YCPString.h"
@@ -59,6 +60,7 @@ struct ycodelist {
     struct ycodelist *next;
     YCodePtr code;
     constTypePtr type;
+    YCODE_ARENA_ALLOCATED
 };
 typedef struct ycodelist ycodelist_t;
 
@@ -79,6 +81,9 @@ class YCode : public Rep
 {
     REP_BODY(YCode);
 public:
+    // nodes are allocated in the arena of the module being loaded
+    YCODE_ARENA_ALLOCATED
+
     enum ykind {
 	yxError = 0,
 	// [1] Constants	(-> YCPValue, except(!) term -> yeLocale)
@@ -235,6 +240,17 @@ public:
      */
     virtual bool isReferenceable () const;
 
+    /**
+     * Is evaluating this code free of side effects? True for
+     * expressions which only read variables, build values and call
+     * builtins declared DECL_PURE, several threads may evaluate
+     * those at once (see YCPParallel). Blocks, assignments, function
+     * calls and everything else are not pure.
+     *
+     * \return true if the \ref YCode represents a pure expression
+     */
+    virtual bool isPure () const;
+
     /**
      * Execute YCP code to get the resulting \ref YCPValue. Every inherited class of YCode should reimplement
      * this method.
@@ -244,6 +260,23 @@ public:
      */
     virtual YCPValue evaluate (bool cse = false);
 
+    /**
+     * Compile time optimization (constant folding, dead code removal).
+     * The children are optimized and replaced in place, the default
+     * implementation leaves the code as it is.
+     *
+     * \param removed  incremented by the number of nodes optimized away
+     * \return the code replacing this one (usually 'this'), 0 if this
+     *    is a statement without any effect which can be dropped
+     */
+    virtual YCodePtr optimize (int & removed);
+
+    /**
+     * Optimize 'code' in place (if non-NULL), see \ref optimize. A statement
+     * which wants to be dropped is kept as it is.
+     */
+    static void optimizeChild (YCodePtr & code, int & removed);
+
    /**
     * Return type of this YCP code (interesting mostly for function calls).
     *
@@ -274,8 +307,16 @@ public:
     std::ostream & toXml (std::ostream & str, int indent ) const;
     /** yes */
     virtual bool isConstant () const { return true; }
+    /** yes */
+    virtual bool isPure () const { return true; }
     YCPValue evaluate (bool cse = false);
     constTypePtr type() const;
+
+    /**
+     * Create a constant for a (parse time) computed value.
+     * Returns 0 if the value has no constant representation.
+     */
+    static YCodePtr create (const YCPValue & value);
 };
 
 // bother, 4.3 requires -std=c++0x
@@ -297,6 +338,7 @@ public:
  */
 
 class YELocale;
+class LazyDefinition;
 
 class YLocale : public YCode
 {
@@ -311,9 +353,21 @@ class YLocale : public YCode
 	}
     };
 
+    // hash<const char*> of C++0x hashes the pointer, not the string
+    struct hashstr
+    {
+	size_t operator()(const char* s) const
+	{
+	    size_t h = 0;
+	    for ( ; *s; ++s)
+		h = 5 * h + *s;
+	    return h;
+	}
+    };
+
 public:
 #ifdef HAVE_CXX0X
-    typedef unordered_map<const char*, bool, hash<const char*>, eqstr> t_uniquedomains;
+    typedef unordered_map<const char*, bool, hashstr, eqstr> t_uniquedomains;
 #else
     typedef __gnu_cxx::hash_map<const char*, bool, __gnu_cxx::hash<const char*>, eqstr> t_uniquedomains;
 #endif
@@ -364,10 +418,15 @@ class YFunction : public YCode
     YBlockPtr m_declaration;
 
     // the function definition ('body') is the block defining this function
-    YCodePtr m_definition;
+    mutable YCodePtr m_definition;
+
+    // the definition while not read yet from bytecode, see definition()
+    mutable LazyDefinition *m_lazy;
 
     bool m_is_global;
 
+    void readDefinition () const;
+
 public:
     YFunction (YBlockPtr parameterblock, const SymbolEntryPtr entry = 0);
     YFunction (bytecodeistream & str);
@@ -380,7 +439,10 @@ public:
     SymbolEntryPtr parameter (unsigned int position) const;
 
     // access to definition block (= 0 if declaration only)
+    //   reads it from bytecode on first access
     YCodePtr definition () const;
+    // is there a definition (which may not be read yet)?
+    bool hasDefinition () const { return m_definition != 0 || m_lazy != 0; }
     void setDefinition (YBlockPtr body);
     void setDefinition (YBreakpointPtr body);
     // read definition from stream
@@ -393,6 +455,7 @@ public:
     std::ostream & toStream (std::ostream & str ) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     virtual YCPValue evaluate (bool cse = false);
+    virtual YCodePtr optimize (int & removed);
     constTypePtr type() const;
 };
 
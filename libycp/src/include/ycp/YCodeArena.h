@@ -0,0 +1,98 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YCodeArena.h
+
+   Arena allocation for the code trees of one bytecode or source file
+
+/-*/
+// -*- c++ -*-
+
+#ifndef YCodeArena_h
+#define YCodeArena_h
+
+#include <stddef.h>
+#include <string>
+
+/**
+ * Memory arena for the YCode nodes, ycodelist_t and stmtlist_t links
+ * and Points of one module.
+ *
+ * While a YCodeArena::Scope is active (i.e. while reading one .ybc
+ * file or parsing one source file) these objects are carved from the
+ * chunks of its arena, contiguously and in load order. Outside of any
+ * scope they come from the system allocator as before.
+ *
+ * Deleting a single object does not give its memory back, the arena
+ * is freed as a whole once its scope ended and the last of its
+ * objects is gone. Modules usually stay loaded until exit, so in
+ * practice arenas live forever.
+ */
+class YCodeArena
+{
+    struct Chunk
+    {
+	Chunk *next;
+	size_t size;
+	size_t used;
+    };
+
+    Chunk *m_chunks;
+    size_t m_live;		// objects allocated and not yet deleted
+    size_t m_count;		// objects allocated in total
+    size_t m_bytes;		// bytes allocated in total
+    bool m_open;		// still the target of a Scope
+    std::string m_name;
+
+    // the arena new objects of this thread are allocated from, 0 for
+    //  the heap (code evaluated by other threads meanwhile must not
+    //  allocate from the arena of a module being loaded)
+    static __thread YCodeArena *_current;
+
+    YCodeArena (const std::string & name);
+    ~YCodeArena ();
+
+    void *alloc (size_t size);
+    void close ();
+
+public:
+    /**
+     * Allocate from a new arena until the scope is left. Nested
+     * scopes (modules imported while loading) get their own arena.
+     */
+    class Scope
+    {
+	YCodeArena *m_arena;
+	YCodeArena *m_previous;
+    public:
+	Scope (const std::string & name);
+	~Scope ();
+    };
+
+    /**
+     * Allocate size bytes from the current arena (or the heap)
+     */
+    static void *allocate (size_t size);
+
+    /**
+     * Release memory obtained by allocate ()
+     */
+    static void deallocate (void *ptr);
+};
+
+// class specific operator new/delete, allocating from the current YCodeArena
+//   (use in a public section)
+#define YCODE_ARENA_ALLOCATED							\
+    static void *operator new (size_t size) { return YCodeArena::allocate (size); }	\
+    static void operator delete (void *ptr) { YCodeArena::deallocate (ptr); }
+
+#endif // YCodeArena_h
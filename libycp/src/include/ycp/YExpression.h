@@ -70,6 +70,7 @@ public:
     string toString () const;
     /** yes */
     virtual bool isReferenceable () const { return true; }
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
@@ -114,7 +115,9 @@ public:
     constTypePtr attachParameter (YCodePtr code, constTypePtr dummy = Type::Unspec);
     string toString () const;
     const char *name () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return Type::Term; }
@@ -127,6 +130,7 @@ public:
 class YECompare : public YCode
 {
     REP_BODY(YECompare);
+    friend class YProgram;		// lowers it, see YProgram.h
 public:
     enum cmp_op { C_NOT = 1, C_EQ = 2, C_LT = 4,	// base operations
 		  C_NEQ = C_NOT|C_EQ,
@@ -145,7 +149,9 @@ public:
     ~YECompare ();
     virtual ykind kind () const { return yeCompare; }
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return Type::Boolean; }
@@ -169,6 +175,7 @@ public:
     virtual ykind kind () const { return yeLocale; }
     string toString () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return Type::Locale; }
@@ -190,7 +197,9 @@ public:
     void attach (YCodePtr element);
 //    YCodePtr code () const;
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const;
@@ -216,7 +225,9 @@ public:
 //    YCodePtr key () const;
 //    YCodePtr value () const;
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const;
@@ -239,7 +250,9 @@ public:
     virtual ykind kind () const { return yePropagate; }
     string toString () const;
     bool canPropagate(const YCPValue& value, constTypePtr to_type) const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return m_to; }
@@ -252,6 +265,7 @@ public:
 class YEUnary : public YCode
 {
     REP_BODY(YEUnary);
+    friend class YProgram;		// lowers it, see YProgram.h
     declaration_t *m_decl;
     YCodePtr m_arg;		// argument
 public:
@@ -262,7 +276,9 @@ public:
     declaration_t *decl () const;
 //    YCodePtr arg () const;
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return ((constFunctionTypePtr)m_decl->type)->returnType (); }
@@ -284,10 +300,12 @@ public:
     ~YEBinary ();
     virtual ykind kind () const { return yeBinary; }
     declaration_t *decl ();
-//    YCodePtr arg1 () const;
-//    YCodePtr arg2 () const;
+    YCodePtr arg1 () const;
+    YCodePtr arg2 () const;
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const;
@@ -300,6 +318,7 @@ public:
 class YETriple : public YCode
 {
     REP_BODY(YETriple);
+    friend class YProgram;		// lowers it, see YProgram.h
     YCodePtr m_expr;		// bool expr
     YCodePtr m_true;		// true value
     YCodePtr m_false;		// false value
@@ -312,7 +331,9 @@ public:
 //    YCodePtr iftrue () const;
 //    YCodePtr iffalse () const;
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return m_true->type ()->commontype (m_false->type ()); }
@@ -333,7 +354,9 @@ public:
     ~YEIs ();
     virtual ykind kind () const { return yeIs; }
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return Type::Boolean; }
@@ -353,7 +376,9 @@ public:
     ~YEReturn ();
     virtual ykind kind () const { return yeReturn; }
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return m_expr->type(); }
@@ -376,7 +401,9 @@ public:
     ~YEBracket ();
     virtual ykind kind () const { return yeBracket; }
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type() const { return m_resultType; }
@@ -397,12 +424,25 @@ class YEBuiltin : public YCode
     YBlockPtr m_parameterblock;
 
     ycodelist_t *m_parameters;
+
+    // call dispatch, resolved from m_decl once (see resolveCall ()),
+    //  argc is the number of arguments actually passed
+    typedef YCPValue (*thunk_t) (const declaration_t *decl, int argc, YCPValue args[]);
+    thunk_t m_thunk;
+    int m_argcount;		// declared parameter count
+    int m_wildcard;		// position of '...' in the declared parameters, -1 if none
+    bool m_noeval;		// DECL_NOEVAL, pass parameters unevaluated
+    bool m_nilok;		// DECL_NIL, nil parameters allowed
+    bool m_handler;		// namespace has a DECL_CALL_HANDLER
+    void resolveCall ();
 public:
     YEBuiltin (declaration_t *decl, YBlockPtr parameterblock = 0, constTypePtr type = 0);
     YEBuiltin (bytecodeistream & str);
     ~YEBuiltin ();
     virtual ykind kind () const { return yeBuiltin; }
     declaration_t *decl () const;
+    // the actual parameters
+    ycodelist_t *parameters () const;
     /**
      * 'close' function, perform final parameter check
      * if ok, return 0
@@ -419,7 +459,9 @@ public:
     // attach symbolic variable parameter to function, return created TableEntry
     constTypePtr attachSymVariable (const char *name, constTypePtr type, unsigned int line, TableEntry *&tentry);
     string toString () const;
+    bool isPure () const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     constTypePtr type () const;
@@ -464,6 +506,7 @@ public:
      *   reported in attachParameter()
      */
     virtual constTypePtr finalize ();
+    YCodePtr optimize (int & removed);
     string toString () const;
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
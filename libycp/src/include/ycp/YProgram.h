@@ -0,0 +1,84 @@
+/*---------------------------------------------------------------------\
+|                                                                      |
+|                      __   __    ____ _____ ____                      |
+|                      \ \ / /_ _/ ___|_   _|___ \                     |
+|                       \ V / _` \___ \ | |   __) |                    |
+|                        | | (_| |___) || |  / __/                     |
+|                        |_|\__,_|____/ |_| |_____|                    |
+|                                                                      |
+|                               core system                            |
+|                                                        (C) SuSE GmbH |
+\----------------------------------------------------------------------/
+
+   File:	YProgram.h
+
+   The statements of a block lowered to register code
+
+/-*/
+// -*- c++ -*-
+
+#ifndef YProgram_h
+#define YProgram_h
+
+#include <vector>
+
+#include "ycp/YCPValue.h"
+
+class YBlock;
+
+/**
+ * The statements of a YBlock lowered to a flat array of instructions
+ * on registers, run by a dispatch loop instead of the recursive
+ * evaluate () of the tree.
+ *
+ * Assignments, if, loops, break, continue and return are lowered, as
+ * are the expressions on variables and constants: integer arithmetic,
+ * comparison, the boolean operators and ?:. Integers and booleans stay
+ * unboxed in the registers, a YCPValue is only created when a value is
+ * stored or passed on. The statements of nested blocks are inlined.
+ * Anything else, e.g. a call of a builtin or a function, is one
+ * instruction evaluating its node of the tree, so the results, errors
+ * and warnings are the same as with the tree.
+ *
+ * A block is lowered on its first evaluation (see YBlock::evaluate).
+ * Programs are not used while the debugger is active. Y2VM=0 in the
+ * environment evaluates the tree instead, for comparison.
+ */
+class YProgram
+{
+public:
+    /**
+     * Lower the statements of block.
+     */
+    YProgram (YBlock *block);
+    ~YProgram ();
+
+    /**
+     * Run the statements like YBlock::evaluate does: returns the
+     * value of the statement ending the block (break, continue or
+     * return), YCPNull if all statements ran. The caller pushes the
+     * frame of the block and sets the file name.
+     */
+    YCPValue run () const;
+
+    /**
+     * Are blocks run as programs? Read from Y2VM once.
+     */
+    static bool enabled ();
+
+    struct Insn;
+    class Compiler;
+
+private:
+    Insn *m_code;
+    unsigned int m_size;
+    unsigned int m_registers;
+
+    // constants loaded by the instructions
+    std::vector<YCPValue> m_constants;
+
+    YProgram (const YProgram &);
+    YProgram & operator= (const YProgram &);
+};
+
+#endif // YProgram_h
@@ -137,6 +137,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -149,6 +150,7 @@ public:
 class YSBlock : public YStatement
 {
     REP_BODY(YSBlock);
+    friend class YProgram;		// lowers it, see YProgram.h
     YBlockPtr m_block;
 public:
     YSBlock (YBlockPtr block, int line = 0);
@@ -159,6 +161,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -171,6 +174,7 @@ public:
 class YSReturn : public YStatement
 {
     REP_BODY(YSReturn);
+    friend class YProgram;		// lowers it, see YProgram.h
     YCodePtr m_value;
 public:
     YSReturn (YCodePtr value, int line = 0);
@@ -184,6 +188,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -238,6 +243,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -251,9 +257,19 @@ public:
 class YSAssign : public YStatement
 {
     REP_BODY(YSAssign);
+    friend class YProgram;		// lowers it, see YProgram.h
 protected:
     SymbolEntryPtr m_entry;
     YCodePtr m_code;
+
+    // <m_entry> = add (<m_entry>, <m_extendvalue>) (or prepend, or +)
+    // is done in place, see resolveExtend ()
+    enum { extend_unknown, extend_none, extend_append, extend_prepend } m_extend;
+    declaration_t *m_extenddecl;
+    YCodePtr m_extendvalue;
+
+    void resolveExtend ();
+    bool evaluateExtend ();
 public:
     YSAssign (SymbolEntryPtr entry, YCodePtr code, int line = 0);
     YSAssign (bytecodeistream & str);
@@ -263,6 +279,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
 };
 
 
@@ -305,9 +322,11 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     // recursively extract list arg at idx, get value from current at idx
-    // and replace with value. re-generating the list/map/term during unwind
-    YCPValue commit (YCPValue current, int idx, YCPList arg, YCPValue value);
+    // and replace with value. unshared levels are updated in place,
+    // returns false (and leaves current untouched) on error
+    bool commit (YCPValue & current, int idx, const YCPList & arg, const YCPValue & value);
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -320,6 +339,7 @@ public:
 class YSIf : public YStatement
 {
     REP_BODY(YSIf);
+    friend class YProgram;		// lowers it, see YProgram.h
     YCodePtr m_condition;		// bool expr
     YCodePtr m_true;		// true statement/block
     YCodePtr m_false;		// false statement/block
@@ -332,6 +352,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -344,6 +365,7 @@ public:
 class YSWhile : public YStatement
 {
     REP_BODY(YSWhile);
+    friend class YProgram;		// lowers it, see YProgram.h
     YCodePtr m_condition;		// bool expr
     YCodePtr m_loop;		// loop statement
 
@@ -356,6 +378,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -368,6 +391,7 @@ public:
 class YSRepeat : public YStatement
 {
     REP_BODY(YSRepeat);
+    friend class YProgram;		// lowers it, see YProgram.h
     YCodePtr m_loop;		// loop statement
     YCodePtr m_condition;		// bool expr
 
@@ -380,6 +404,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -392,6 +417,7 @@ public:
 class YSDo : public YStatement
 {
     REP_BODY(YSDo);
+    friend class YProgram;		// lowers it, see YProgram.h
     YCodePtr m_loop;		// loop statement
     YCodePtr m_condition;		// bool expr
 
@@ -404,6 +430,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
 };
 
@@ -528,6 +555,7 @@ public:
     std::ostream & toStream (std::ostream & str) const;
     std::ostream & toXml (std::ostream & str, int indent ) const;
     YCPValue evaluate (bool cse = false);
+    YCodePtr optimize (int & removed);
     constTypePtr type () const { return Type::Void; };
     constTypePtr conditionType () const { return m_condition->type (); };
     bool setCase (YCPValue value);
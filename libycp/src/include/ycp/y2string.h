@@ -57,4 +57,57 @@ bool
 wchar2utf8 (const std::wstring& in, std::string* out);
 
 
+/**
+ *  A set of bytes for scanning strings, e.g. the delimiters of
+ *  splitstring or the characters of filterchars and deletechars.
+ *
+ *  Membership is a lookup in a 256 entry table, so scanning is
+ *  linear in the length of the string whatever the size of the set
+ *  (std::string::find_first_of compares every byte against every
+ *  member). A set of a single byte is searched with memchr, which
+ *  the C library implements with vector instructions.
+ *
+ *  Only meaningful for byte strings, i.e. ASCII or a set of ASCII
+ *  characters in UTF-8.
+ */
+class ByteSet
+{
+public:
+
+    ByteSet (const std::string& bytes);
+
+    bool contains (unsigned char c) const { return m_table[c]; }
+
+    /**
+     *  Position of the first byte at or after pos that is (not) in
+     *  the set, std::string::npos if there is none.
+     */
+    std::string::size_type findFirstOf (const std::string& s, std::string::size_type pos = 0) const;
+    std::string::size_type findFirstNotOf (const std::string& s, std::string::size_type pos = 0) const;
+
+    /**
+     *  Position of the last byte that is (not) in the set,
+     *  std::string::npos if there is none.
+     */
+    std::string::size_type findLastOf (const std::string& s) const;
+    std::string::size_type findLastNotOf (const std::string& s) const;
+
+    /**
+     *  Remove all bytes of s that are in the set (keep false) or
+     *  that are not in the set (keep true), in a single pass.
+     */
+    void filter (std::string& s, bool keep) const;
+
+private:
+
+    bool m_table[256];
+
+    // number of distinct bytes in the set
+    int m_count;
+
+    // the byte if m_count is 1
+    unsigned char m_single;
+};
+
+
 #endif
@@ -24,6 +24,15 @@
 
 #include "YCPValue.h"
 
+// see YCode.h
+#ifdef HAVE_CXX0X
+#include <unordered_set>
+#include <unordered_map>
+#else
+#include <ext/hash_set>
+#include <ext/hash_map>
+#endif
+
 
 /*
  * Global comparison functor usable as generic ordering operator for
@@ -101,4 +110,36 @@ private:
 };
 
 
+/*
+ * Global hash functor for hashed STL-containers of YCPValues.
+ *
+ * Values that are equal according to ycp_equal_to() (not respecting the
+ * locale) have the same hash, see YCPValueRep::hash().
+ */
+class ycp_hash : public std::unary_function<YCPValue, size_t>
+{
+
+public:
+
+    size_t operator()(const YCPValue& x) const
+    {
+	return x->hash();
+    }
+
+};
+
+
+/*
+ * Hash set of YCPValues and hash map counting YCPValues, e.g. for
+ * removing duplicates or intersecting lists in linear time.
+ */
+#ifdef HAVE_CXX0X
+typedef std::unordered_set<YCPValue, ycp_hash, ycp_equal_to> YCPValueHashSet;
+typedef std::unordered_map<YCPValue, int, ycp_hash, ycp_equal_to> YCPValueCountMap;
+#else
+typedef __gnu_cxx::hash_set<YCPValue, ycp_hash, ycp_equal_to> YCPValueHashSet;
+typedef __gnu_cxx::hash_map<YCPValue, int, ycp_hash, ycp_equal_to> YCPValueCountMap;
+#endif
+
+
 #endif   // ycpless_h
@@ -6,6 +6,7 @@
 
 
 #include <errno.h>
+#include <string.h>
 
 #include "y2log.h"
 #include "y2string.h"
@@ -108,7 +109,8 @@ recode (iconv_t cd, const std::wstring& in, std::wstring* out)
 bool
 utf82wchar (const std::string& in, std::wstring* out)
 {
-    static iconv_t cd = (iconv_t)(-1);
+    // one per thread, a conversion descriptor has state
+    static __thread iconv_t cd = (iconv_t)(-1);
 
     if (cd == (iconv_t)(-1))
     {
@@ -136,7 +138,8 @@ utf82wchar (const std::string& in, std::wstring* out)
 bool
 wchar2utf8 (const std::wstring& in, std::string* out)
 {
-    static iconv_t cd = (iconv_t)(-1);
+    // one per thread, a conversion descriptor has state
+    static __thread iconv_t cd = (iconv_t)(-1);
 
     if (cd == (iconv_t)(-1))
     {
@@ -159,3 +162,104 @@ wchar2utf8 (const std::wstring& in, std::string* out)
 
     return recode (cd, in, out);
 }
+
+
+ByteSet::ByteSet (const std::string& bytes)
+    : m_count (0)
+    , m_single (0)
+{
+    memset (m_table, 0, sizeof (m_table));
+
+    for (std::string::const_iterator it = bytes.begin (); it != bytes.end (); ++it)
+    {
+	unsigned char c = *it;
+	if (!m_table[c])
+	{
+	    m_table[c] = true;
+	    m_single = c;
+	    m_count++;
+	}
+    }
+}
+
+
+std::string::size_type
+ByteSet::findFirstOf (const std::string& s, std::string::size_type pos) const
+{
+    if (pos >= s.size () || m_count == 0)
+	return std::string::npos;
+
+    const unsigned char* data = (const unsigned char*) s.data ();
+    const unsigned char* end = data + s.size ();
+
+    if (m_count == 1)
+    {
+	const void* p = memchr (data + pos, m_single, end - data - pos);
+	return p ? (const unsigned char*) p - data : std::string::npos;
+    }
+
+    for (const unsigned char* p = data + pos; p != end; ++p)
+	if (m_table[*p])
+	    return p - data;
+
+    return std::string::npos;
+}
+
+
+std::string::size_type
+ByteSet::findFirstNotOf (const std::string& s, std::string::size_type pos) const
+{
+    const unsigned char* data = (const unsigned char*) s.data ();
+    const unsigned char* end = data + s.size ();
+
+    for (const unsigned char* p = data + pos; p < end; ++p)
+	if (!m_table[*p])
+	    return p - data;
+
+    return std::string::npos;
+}
+
+
+std::string::size_type
+ByteSet::findLastOf (const std::string& s) const
+{
+    if (m_count == 1)
+	return s.rfind ((char) m_single);
+
+    const unsigned char* data = (const unsigned char*) s.data ();
+
+    for (std::string::size_type i = s.size (); i > 0; --i)
+	if (m_table[data[i - 1]])
+	    return i - 1;
+
+    return std::string::npos;
+}
+
+
+std::string::size_type
+ByteSet::findLastNotOf (const std::string& s) const
+{
+    const unsigned char* data = (const unsigned char*) s.data ();
+
+    for (std::string::size_type i = s.size (); i > 0; --i)
+	if (!m_table[data[i - 1]])
+	    return i - 1;
+
+    return std::string::npos;
+}
+
+
+void
+ByteSet::filter (std::string& s, bool keep) const
+{
+    std::string::size_type w = 0;
+
+    for (std::string::size_type r = 0; r < s.size (); ++r)
+    {
+	unsigned char c = s[r];
+	if (m_table[c] == keep)
+	    s[w++] = c;
+    }
+
+    s.resize (w);
+}
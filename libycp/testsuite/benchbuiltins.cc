@@ -0,0 +1,104 @@
+/*
+    benchbuiltins.cc
+
+    times calls of frequently used builtins (size, haskey, add,
+    issubstring) through the YEBuiltin dispatch, each benchmark makes
+    10000 calls per evaluation
+
+    usage: benchbuiltins [iterations]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <ycp/YCode.h>
+#include <ycp/Parser.h>
+#include <ycp/y2log.h>
+#include <ycp/ExecutionEnvironment.h>
+
+extern ExecutionEnvironment ee;
+
+// calls of the builtin per evaluation
+#define CALLS 10000
+
+// the loop without a builtin call, subtracted from the others
+static const char *baseline =
+    "{ integer n = 0; integer i = 0; while (i < 10000) { n = n + 1; i = i + 1; } return n; }";
+
+static const char *benchmarks[][2] = {
+    { "size",
+      "{ list l = [1, 2, 3]; integer n = 0; integer i = 0; while (i < 10000) { n = n + size (l); i = i + 1; } return n; }" },
+    { "haskey",
+      "{ map m = $[\"a\":1, \"b\":2, \"c\":3]; integer n = 0; integer i = 0; while (i < 10000) { if (haskey (m, \"b\")) n = n + 1; i = i + 1; } return n; }" },
+    { "add",
+      "{ list l = [1, 2, 3]; integer n = 0; integer i = 0; while (i < 10000) { n = n + size (add (l, i)); i = i + 1; } return n; }" },
+    { "issubstring",
+      "{ string s = \"/usr/lib/YaST2/modules\"; integer n = 0; integer i = 0; while (i < 10000) { if (issubstring (s, \"YaST\")) n = n + 1; i = i + 1; } return n; }" },
+    { 0, 0 }
+};
+
+
+static double
+now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// seconds for iterations evaluations of code, -1 on a parse error
+static double
+run (const char *name, const char *code, int iterations)
+{
+    Parser parser;
+    parser.setInput (code);
+    parser.setBuffered ();
+    YCodePtr c = parser.parse ();
+    if (c == 0)
+    {
+	fprintf (stderr, "%s: parse error\n", name);
+	return -1;
+    }
+
+    double start = now ();
+    for (int i = 0; i < iterations; i++)
+    {
+	c->evaluate ();
+    }
+    return now () - start;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi (argv[1]) : 100;
+    if (iterations <= 0)
+    {
+	fprintf (stderr, "usage: %s [iterations]\n", argv[0]);
+	return 1;
+    }
+
+    ee.setFilename ("benchbuiltins");
+
+    double loop = run ("loop", baseline, iterations);
+    if (loop < 0)
+	return 1;
+
+    printf ("%-12s %10s %14s\n", "builtin", "seconds", "ns per call");
+    printf ("%-12s %10.3f %14s\n", "(loop)", loop, "");
+
+    for (int b = 0; benchmarks[b][0] != 0; b++)
+    {
+	double seconds = run (benchmarks[b][0], benchmarks[b][1], iterations);
+	if (seconds < 0)
+	    return 1;
+
+	printf ("%-12s %10.3f %14.1f\n", benchmarks[b][0], seconds,
+		(seconds - loop) * 1e9 / ((double) iterations * CALLS));
+    }
+
+    return 0;
+}
@@ -0,0 +1,192 @@
+/*
+    benchbytecode.cc
+
+    times loading .ybc files with Bytecode::readFile, cold (the file
+    dropped from the page cache before, as far as the kernel permits)
+    and warm (best of several loads), and how many of the function
+    definitions found were read (by loading, they are read on first
+    use), and the growth of the resident memory by the cold loads (the
+    code read is kept until exit)
+
+    Modules imported by the files are looked up in the module path and
+    loaded once, by the first file importing them. To time the full
+    module set pass all of it, e.g.
+
+    usage: benchbytecode [-M module-path] [-n loads] file.ybc ...
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <vector>
+
+#include <ycp/YCode.h>
+#include <ycp/YBlock.h>
+#include <ycp/Bytecode.h>
+#include <ycp/ModulePrefetch.h>
+#include <ycp/pathsearch.h>
+#include <ycp/y2log.h>
+
+#include <y2/Y2Component.h>
+#include <y2/Y2ComponentCreator.h>
+
+class BenchY2Component : public Y2Component {
+    virtual Y2Namespace *import (const char* name)
+    {
+	YBlockPtr block = (YBlockPtr)Bytecode::readModule (name);
+	if (block == 0)
+	{
+	    return NULL;
+	}
+	return block->nameSpace();
+    }
+    virtual string name () const { return "bench"; }
+} BenchComponent;
+
+
+class BenchY2CC : public Y2ComponentCreator
+{
+public:
+    BenchY2CC() : Y2ComponentCreator(Y2ComponentBroker::SCRIPT) {}
+    virtual Y2Component *provideNamespace(const char *name) { return &BenchComponent; }
+    virtual bool isServerCreator () const { return true; }
+} cc;
+
+
+static double
+now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+// drop the cached pages of file
+static void
+evict (const char *file)
+{
+    int fd = open (file, O_RDONLY);
+    if (fd >= 0)
+    {
+	posix_fadvise (fd, 0, 0, POSIX_FADV_DONTNEED);
+	close (fd);
+    }
+}
+
+
+// resident memory of the process in kB, 0 if unknown
+static long
+rss ()
+{
+    FILE *f = fopen ("/proc/self/status", "r");
+    if (f == 0)
+	return 0;
+
+    char line[256];
+    long kb = 0;
+    while (fgets (line, sizeof (line), f))
+    {
+	if (strncmp (line, "VmRSS:", 6) == 0)
+	{
+	    kb = atol (line + 6);
+	    break;
+	}
+    }
+    fclose (f);
+    return kb;
+}
+
+
+static double
+load (const char *file, YCodePtr & code)
+{
+    double start = now ();
+    code = Bytecode::readFile (file);
+    return now () - start;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    int loads = 5;
+    int argp = 1;
+
+    YCPPathSearch::initialize ();
+
+    while (argp < argc && argv[argp][0] == '-')
+    {
+	if (strcmp (argv[argp], "-M") == 0 && argp + 1 < argc)
+	{
+	    YCPPathSearch::addPath (YCPPathSearch::Module, argv[argp + 1]);
+	    argp += 2;
+	}
+	else if (strcmp (argv[argp], "-n") == 0 && argp + 1 < argc)
+	{
+	    loads = atoi (argv[argp + 1]);
+	    argp += 2;
+	}
+	else
+	{
+	    break;
+	}
+    }
+
+    if (argp == argc || loads <= 0)
+    {
+	fprintf (stderr, "usage: %s [-M module-path] [-n loads] file.ybc ...\n", argv[0]);
+	return 1;
+    }
+
+    printf ("%-40s %10s %10s\n", "file", "cold", "warm");
+
+    double cold_total = 0, warm_total = 0;
+    int failed = 0;
+
+    // all cold loads first, their code is kept to see the memory it takes
+    std::vector<YCodePtr> code (argc);
+    std::vector<double> cold (argc);
+    long rss_before = rss ();
+
+    for (int i = argp; i < argc; i++)
+    {
+	evict (argv[i]);
+	cold[i] = load (argv[i], code[i]);
+    }
+
+    long rss_loaded = rss ();
+
+    for (int i = argp; i < argc; i++)
+    {
+	if (code[i] == 0)
+	{
+	    fprintf (stderr, "%s: cannot load\n", argv[i]);
+	    failed++;
+	    continue;
+	}
+
+	double warm = cold[i];
+	for (int l = 0; l < loads; l++)
+	{
+	    YCodePtr again;
+	    double t = load (argv[i], again);
+	    if (t < warm)
+		warm = t;
+	}
+
+	printf ("%-40s %10.6f %10.6f\n", argv[i], cold[i], warm);
+	cold_total += cold[i];
+	warm_total += warm;
+    }
+
+    printf ("%-40s %10.6f %10.6f\n", "total", cold_total, warm_total);
+    printf ("resident memory: %ld kB more after the cold loads\n", rss_loaded - rss_before);
+    printf ("function definitions read: %u of %u\n", LazyDefinition::loaded (), LazyDefinition::available ());
+    printf ("modules prefetched: %u\n", ModulePrefetch::used ());
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/*
+    benchmaps.cc
+
+    times building, looking up and iterating maps with string keys,
+    YCPMap (hash trie for large maps) against a std::map ordered by
+    ycp_less (how YCPMap kept all maps before)
+
+    usage: benchmaps [entries ...]	(default: 10000 100000 1000000)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <vector>
+
+#include <ycp/YCPMap.h>
+#include <ycp/YCPString.h>
+#include <ycp/YCPInteger.h>
+
+// lookups per entry
+#define LOOKUPS 10
+
+
+static double
+now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+static YCPValue
+key (long i)
+{
+    char buf[32];
+    snprintf (buf, sizeof (buf), "key-%ld", i);
+    return YCPString (buf);
+}
+
+
+static void
+bench (long entries)
+{
+    std::vector<YCPValue> keys;
+    keys.reserve (entries);
+    for (long i = 0; i < entries; i++)
+    {
+	// not in key order
+	keys.push_back (key ((i * 7919) % entries));
+    }
+
+    YCPMap map;
+    YCPValueYCPValueMap stl_map;
+    double t[2];
+    long found[2];
+
+    // build
+    t[0] = now ();
+    for (long i = 0; i < entries; i++)
+	map->add (keys[i], YCPInteger (i));
+    t[0] = now () - t[0];
+
+    t[1] = now ();
+    for (long i = 0; i < entries; i++)
+	stl_map.insert (YCPValueYCPValueMap::value_type (keys[i], YCPInteger (i)));
+    t[1] = now () - t[1];
+
+    printf ("%10ld %-24s %10.3f %10.3f\n", entries, "build", t[0], t[1]);
+
+    // lookup of existing key values (like constant keys in code)
+    found[0] = found[1] = 0;
+    t[0] = now ();
+    for (long i = 0; i < LOOKUPS * entries; i++)
+	found[0] += !map->value (keys[(i * 31) % entries]).isNull ();
+    t[0] = now () - t[0];
+
+    t[1] = now ();
+    for (long i = 0; i < LOOKUPS * entries; i++)
+	found[1] += stl_map.find (keys[(i * 31) % entries]) != stl_map.end ();
+    t[1] = now () - t[1];
+
+    printf ("%10ld %-24s %10.3f %10.3f\n", entries, "lookup", t[0], t[1]);
+
+    // lookup of new key values, half of them missing
+    t[0] = now ();
+    for (long i = 0; i < entries; i++)
+	found[0] += map->hasKey (key (i * 2));
+    t[0] = now () - t[0];
+
+    t[1] = now ();
+    for (long i = 0; i < entries; i++)
+	found[1] += stl_map.find (key (i * 2)) != stl_map.end ();
+    t[1] = now () - t[1];
+
+    printf ("%10ld %-24s %10.3f %10.3f\n", entries, "lookup new keys", t[0], t[1]);
+
+    if (found[0] != found[1])
+	fprintf (stderr, "lookups differ: %ld != %ld\n", found[0], found[1]);
+
+    // copy and change (like add (m, k, v))
+    t[0] = now ();
+    for (long i = 0; i < 100; i++)
+    {
+	YCPMap copy = map->functionalAdd (keys[i % entries], YCPInteger (0LL));
+    }
+    t[0] = now () - t[0];
+
+    t[1] = now ();
+    for (long i = 0; i < 100; i++)
+    {
+	YCPValueYCPValueMap copy (stl_map);
+	copy[keys[i % entries]] = YCPInteger (0LL);
+    }
+    t[1] = now () - t[1];
+
+    printf ("%10ld %-24s %10.3f %10.3f\n", entries, "100 functional adds", t[0], t[1]);
+
+    // iterate, the first pass sorts a hashed map
+    for (int pass = 1; pass <= 2; pass++)
+    {
+	long n = 0;
+	t[0] = now ();
+	for (YCPMap::const_iterator it = map->begin (); it != map->end (); ++it)
+	    n += !it->second.isNull ();
+	t[0] = now () - t[0];
+
+	t[1] = now ();
+	for (YCPValueYCPValueMap::const_iterator it = stl_map.begin (); it != stl_map.end (); ++it)
+	    n -= !it->second.isNull ();
+	t[1] = now () - t[1];
+
+	printf ("%10ld %-24s %10.3f %10.3f\n", entries, pass == 1 ? "iterate (first)" : "iterate (again)", t[0], t[1]);
+    }
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    printf ("%10s %-24s %10s %10s\n", "entries", "operation", "YCPMap", "std::map");
+
+    if (argc == 1)
+    {
+	bench (10000);
+	bench (100000);
+	bench (1000000);
+	return 0;
+    }
+
+    for (int i = 1; i < argc; i++)
+    {
+	long entries = atol (argv[i]);
+	if (entries <= 0)
+	{
+	    fprintf (stderr, "usage: %s [entries ...]\n", argv[0]);
+	    return 1;
+	}
+	bench (entries);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+/*
+    benchvalues.cc
+
+    counts the YCPElementRep allocations done while evaluating
+    some typical YCP expressions (loop counters, arithmetic,
+    comparisons, size (), building lists with add () and prepend ())
+
+    usage: benchvalues [iterations]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <ycp/YCode.h>
+#include <ycp/Parser.h>
+#include <ycp/y2log.h>
+#include <ycp/YCPElement.h>
+#include <ycp/ExecutionEnvironment.h>
+
+extern ExecutionEnvironment ee;
+
+static const char *benchmarks[][2] = {
+    { "loop counter",
+      "{ integer i = 0; while (i < 1000) { i = i + 1; } return i; }" },
+    { "arithmetic",
+      "{ integer s = 0; integer i = 0; while (i < 1000) { s = s + (i * 3) % 7 - 2; i = i + 1; } return s; }" },
+    { "comparison",
+      "{ integer n = 0; integer i = 0; while (i < 1000) { if (i >= 500 && i != 700) n = n + 1; i = i + 1; } return n; }" },
+    { "size",
+      "{ list l = [1, 2, 3]; map m = $[1:2]; integer n = 0; integer i = 0; while (i < 1000) { n = n + size (l) + size (m); i = i + 1; } return n; }" },
+    { "list add",
+      "{ list l = []; integer i = 0; while (i < 100000) { l = add (l, i); i = i + 1; } return size (l); }" },
+    { "list prepend",
+      "{ list l = []; integer i = 0; while (i < 100000) { l = prepend (l, i); i = i + 1; } return size (l); }" },
+    { 0, 0 }
+};
+
+
+static double
+now ()
+{
+    struct timeval tv;
+    gettimeofday (&tv, 0);
+    return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    int iterations = (argc > 1) ? atoi (argv[1]) : 100;
+    if (iterations <= 0)
+    {
+	fprintf (stderr, "usage: %s [iterations]\n", argv[0]);
+	return 1;
+    }
+
+    ee.setFilename ("benchvalues");
+
+    printf ("%-14s %12s %14s %10s\n", "benchmark", "allocations", "per evaluation", "seconds");
+
+    for (int b = 0; benchmarks[b][0] != 0; b++)
+    {
+	Parser parser;
+	parser.setInput (benchmarks[b][1]);
+	parser.setBuffered ();
+	YCodePtr code = parser.parse ();
+	if (code == 0)
+	{
+	    fprintf (stderr, "%s: parse error\n", benchmarks[b][0]);
+	    return 1;
+	}
+
+	unsigned long long before = YCPElementRep::allocated ();
+	double start = now ();
+	for (int i = 0; i < iterations; i++)
+	{
+	    code->evaluate ();
+	}
+	double seconds = now () - start;
+	unsigned long long allocations = YCPElementRep::allocated () - before;
+
+	printf ("%-14s %12llu %14.1f %10.3f\n", benchmarks[b][0], allocations,
+		(double) allocations / iterations, seconds);
+    }
+
+    return 0;
+}
@@ -70,6 +70,7 @@ static int parse = 0;		// just parse source code
 static int print = 0;		// just read and print bytecode
 static int compile = 0;		// just compile source to bytecode
 static int run = 0;		// just read and print bytecode
+static int optimize = 0;	// optimize before compiling, see ycpc -O
 
 /**
  * Process one file
@@ -188,6 +189,17 @@ processfile (const char *infname, char *outfname)
     }
     else if (compile)
     {
+	if (optimize)
+	{
+	    int removed = 0;
+	    YCodePtr optimized = c->optimize (removed);
+	    if (optimized != 0)
+	    {
+		c = optimized;
+	    }
+	    // always printed, the testsuite checks it
+	    printf ("%d nodes removed\n", removed);
+	}
 	if (!quiet) printf ("saving ...\n");
 	Bytecode::writeFile (c, string (outfname));
     }
@@ -293,7 +305,7 @@ void print_help (const char *name)
     printf ("Usage:\n");
     printf ("  %s [-h] [--help]\n", name);
     printf ("  %s [-v] [--version]\n", name);
-    printf ("  %s [-q] [-R] {-I include-path} {-M module-path} {-l logfile} {-c|-E|-p} {-o output} <filename>\n", name);
+    printf ("  %s [-q] [-R] {-I include-path} {-M module-path} {-l logfile} {-c [-O0|-O1]|-E|-p} {-o output} <filename>\n", name);
 }
 
 /**
@@ -329,12 +341,13 @@ int main (int argc, char *argv[])
 	    {"fsyntax-only", 0, 0, 'E'},		// parse only
 	    {"output", 1, 0, 'o'},			// output file
 	    {"compile", 0, 0, 'c'},			// compile to bytecode
+	    {"optimize", 1, 0, 'O'},			// optimization level
 	    {"print", 0, 0, 'p'},			// print bytecode
 	    {"logfile", 1, 0, 'l'},			// print bytecode
 	    {0, 0, 0, 0}
 	};
 
-	int c = getopt_long (argc, argv, "h?vVpqrREcI:M:o:l:", options, &option_index);
+	int c = getopt_long (argc, argv, "h?vVpqrREcI:M:o:O:l:", options, &option_index);
 	if (c == EOF) break;
 
 	switch (c)
@@ -378,6 +391,15 @@ int main (int argc, char *argv[])
 		    exit (1);
 		}
 		break;
+	    case 'O':
+		if ((optarg[0] != '0' && optarg[0] != '1')
+		    || optarg[1] != 0)
+		{
+		    fprintf (stderr, "Bad optimization level '%s', use -O0 or -O1\n", optarg);
+		    exit (1);
+		}
+		optimize = optarg[0] - '0';
+		break;
 	    case 'I':
 		YCPPathSearch::addPath (YCPPathSearch::Include, optarg);
 		break;
@@ -6,6 +6,8 @@ unset Y2DEBUGGER
 
 export EF_ALLOW_MALLOC_0=1
 export Y2SILENTSEARCH=1
+# parallel builtins use threads even on a single cpu
+export Y2PARALLEL=4
 # for float::tolstring
 export LC_NUMERIC=cs_CZ.UTF8
 
@@ -0,0 +1,152 @@
+/*
+    stresscontexts.cc
+
+    evaluates the same module on several threads at once, each in its
+    own interpreter context, and checks that every thread gets the
+    results of a serial evaluation (module state, recursion, blocks of
+    list builtins)
+
+    usage: stresscontexts [threads [rounds]]	(default: 8 200)
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <vector>
+
+#include <ycp/YCode.h>
+#include <ycp/YBlock.h>
+#include <ycp/Parser.h>
+#include <ycp/y2log.h>
+#include <ycp/YCPInteger.h>
+#include <ycp/YCPInterpreterContext.h>
+#include <ycp/ExecutionEnvironment.h>
+#include <y2/Y2Function.h>
+
+extern ExecutionEnvironment ee;
+
+static const char *module_source =
+    "{\n"
+    "    module \"Stress\";\n"
+    "\n"
+    "    integer calls = 0;\n"
+    "    list<integer> history = [];\n"
+    "\n"
+    "    global define integer fib (integer n) {\n"
+    "        if (n < 2)\n"
+    "            return n;\n"
+    "        return fib (n - 1) + fib (n - 2);\n"
+    "    }\n"
+    "\n"
+    "    global define integer work (integer seed) {\n"
+    "        calls = calls + 1;\n"
+    "        list<integer> l = maplist (integer i, [1, 2, 3, 4, 5, 6, 7, 8], { return i * seed + calls; });\n"
+    "        l = filter (integer i, l, { return i % 3 != 0; });\n"
+    "        integer sum = 0;\n"
+    "        foreach (integer i, l, { sum = sum + i; });\n"
+    "        history = add (history, sum);\n"
+    "        return sum + fib (10 + seed % 5) + size (history);\n"
+    "    }\n"
+    "}\n";
+
+static YBlockPtr module;
+static int rounds = 200;
+static std::vector<long long> expected;
+static int failures = 0;
+
+
+// the results of one context evaluating the module for all rounds
+static bool
+run (std::vector<long long> & results)
+{
+    YCPInterpreterContext context;
+    YCPInterpreterContext::Scope scope (&context);
+
+    module->initialize ();
+
+    for (int round = 0; round < rounds; round++)
+    {
+	Y2Function *function = module->createFunctionCall ("work", 0);
+	if (function == 0)
+	{
+	    return false;
+	}
+	function->attachParameter (YCPInteger ((long long) round), 0);
+	YCPValue value = function->evaluateCall ();
+	delete function;
+
+	if (value.isNull () || !value->isInteger ())
+	{
+	    return false;
+	}
+	results.push_back (value->asInteger ()->value ());
+    }
+
+    return true;
+}
+
+
+static void *
+worker (void *)
+{
+    std::vector<long long> results;
+    if (!run (results) || results != expected)
+    {
+	__sync_fetch_and_add (&failures, 1);
+    }
+    return 0;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+    int threads = (argc > 1) ? atoi (argv[1]) : 8;
+    if (argc > 2)
+    {
+	rounds = atoi (argv[2]);
+    }
+    if (threads <= 0 || rounds <= 0)
+    {
+	fprintf (stderr, "usage: %s [threads [rounds]]\n", argv[0]);
+	return 1;
+    }
+
+    ee.setFilename ("stresscontexts");
+
+    Parser parser;
+    parser.setInput (module_source);
+    parser.setBuffered ();
+    YCodePtr code = parser.parse ();
+    if (code == 0 || !code->isBlock ())
+    {
+	fprintf (stderr, "parse error\n");
+	return 1;
+    }
+    module = (YBlockPtr) code;
+
+    // the reference, serially
+    if (!run (expected))
+    {
+	fprintf (stderr, "serial evaluation failed\n");
+	return 1;
+    }
+
+    std::vector<pthread_t> ids (threads);
+    for (int t = 0; t < threads; t++)
+    {
+	if (pthread_create (&ids[t], 0, worker, 0) != 0)
+	{
+	    fprintf (stderr, "cannot start thread %d\n", t);
+	    return 1;
+	}
+    }
+    for (int t = 0; t < threads; t++)
+    {
+	pthread_join (ids[t], 0);
+    }
+
+    printf ("%d threads, %d rounds: %d failed\n", threads, rounds, failures);
+    return failures == 0 ? 0 : 1;
+}